@@ -0,0 +1,61 @@
+/**
+ * @file arena.h
+ * @brief Arena-backed, per-thread block pools for filter state and sample buffers.
+ *
+ * Every plan, delay line, coefficient table and block buffer of the filter
+ * subsystem is allocated here instead of with malloc(). Memory comes from
+ * the system in large chunks (the arena), optionally backed by huge pages,
+ * and is carved into 64-byte-aligned blocks of a few size classes, four per
+ * power of two. A freed block goes onto its class's free list in the
+ * calling thread's pool and is handed out again by the next allocation of
+ * that class on the thread, so once a workload has run once, creating and
+ * destroying plans and buffers of the same sizes maps nothing new.
+ *
+ * Pools are per thread and lock-free. When a thread exits its pool, with
+ * its free lists and the rest of its chunk, is kept and adopted by the next
+ * new thread, so short-lived workers (batch threads) do not grow the arena.
+ * Chunks are never returned to the system.
+ *
+ * The counters show where allocations came from: a steady state has
+ * `chunks` constant and every allocation `reused`.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ARENA_ALIGNMENT   64U
+#define ARENA_CHUNK_SIZE  (2U << 20)  /* bytes mapped at a time: one 2 MiB huge page */
+#define ARENA_CLASSES     128U        /* four size classes per power of two, up to 2^39 bytes */
+
+typedef struct {
+    bool     huge_pages;  /* map chunks with MAP_HUGETLB, else ask for transparent huge pages */
+    uint32_t chunk_size;  /* 0 = ARENA_CHUNK_SIZE; rounded up to 2 MiB with huge pages */
+} FIR_arena_config_t;
+
+typedef struct {
+    uint64_t chunks;       /* chunks mapped from the system */
+    uint64_t chunk_bytes;
+    uint64_t huge_chunks;  /* chunks backed by explicit huge pages */
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t reused;       /* allocations served from a free list */
+    uint64_t carved;       /* allocations carved from fresh chunk space */
+    uint64_t live_bytes;   /* bytes in blocks allocated and not yet freed */
+    uint64_t pools;        /* thread pools created */
+} FIR_arena_stats_t;
+
+bool configure_arena(const FIR_arena_config_t *p_config);
+
+void *arena_alloc(size_t p_size);
+void *arena_calloc(size_t p_count, size_t p_size);
+void *arena_realloc(void *p_ptr, size_t p_size);
+void arena_free(void *p_ptr);
+
+void read_arena_stats(FIR_arena_stats_t *p_stats);
+void print_arena_stats(const char *p_label, const FIR_arena_stats_t *p_stats);
+
+#endif  /* ARENA_H_ */
@@ -0,0 +1,71 @@
+/**
+ * @file batch.h
+ * @brief Batch filtering of many signal files on a work-stealing thread pool.
+ *
+ * A manifest lists one job per line:
+ *
+ *     <input file> <filter name> <output file>
+ *
+ * Blank lines and lines starting with '#' are ignored. Filter names refer
+ * to the filter bank passed in by the caller. Inputs may be binary sample
+ * files (any sample type, filtered in that type) or CSV files as written by
+ * record_output; the output is written in the same format as the input.
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+#include "plan.h"
+
+#define BATCH_PATH_MAX  512U
+
+typedef struct {
+    const char   *name;
+    FIR_filter_t *filter;
+} FIR_bank_entry_t;
+
+typedef struct {
+    char     input[BATCH_PATH_MAX];
+    char     output[BATCH_PATH_MAX];
+    uint32_t filter_index;
+    uint64_t cost;          /* input bytes x taps, used to deal the longest jobs first */
+    uint64_t buffer_bytes;  /* signal buffer the input can need (signal_buffer_bound) */
+    uint64_t sample_count;  /* set when the job has run */
+    uint64_t latency_ns;    /* time from picking the job up to its output being written */
+    bool     ok;
+} FIR_batch_job_t;
+
+typedef struct {
+    FIR_batch_job_t *jobs;
+    uint32_t         job_count;
+} FIR_batch_t;
+
+typedef struct {
+    uint32_t        thread_count;  /* 0 = one per online CPU */
+    uint32_t        block_len;     /* plan block length */
+    FIR_plan_mode_t plan_mode;
+} FIR_batch_config_t;
+
+typedef struct {
+    uint32_t jobs_ok;
+    uint32_t jobs_failed;
+    uint32_t thread_count;
+    uint64_t samples;
+    uint64_t steals;
+    double   wall_s;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_max_ns;
+} FIR_batch_report_t;
+
+bool load_batch_manifest(const char *p_filename, const FIR_bank_entry_t *p_bank, uint32_t p_bank_len,
+                         FIR_batch_t *p_batch);
+void free_batch(FIR_batch_t *p_batch);
+bool run_batch(FIR_batch_t *p_batch, const FIR_bank_entry_t *p_bank, uint32_t p_bank_len,
+               const FIR_batch_config_t *p_config, FIR_batch_report_t *p_report);
+void print_batch_report(const FIR_batch_report_t *p_report);
+
+#endif  /* BATCH_H_ */
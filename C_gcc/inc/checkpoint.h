@@ -0,0 +1,79 @@
+/**
+ * @file checkpoint.h
+ * @brief Versioned checkpoints of streaming filter state, for a restart without a start-up transient.
+ *
+ * A restarted filter either starts from zero history, which gives a new
+ * start-up transient, or has to re-read a window of input to rebuild it.
+ * A checkpoint holds all the state a stream needs to go on as if it had
+ * never stopped: the history of every plan (coeff_len - 1 samples), the
+ * kernel it chose (and its fast FIR factors), which a measured plan might
+ * not choose again, and the statistics accumulated so far, together with
+ * the caller's stream position.
+ *
+ * The filter thread registers its plans and accumulators once, then calls
+ * capture_checkpoint() between blocks. A capture copies the state into one
+ * of two snapshot buffers, well under a microsecond per channel, and
+ * returns; a writer thread checksums the snapshot, saves it to a temporary
+ * file, syncs it and renames it over the checkpoint, so the file on disk
+ * is always complete. The writer never holds the lock while writing; if it
+ * is still busy when the next capture comes, the newer snapshot replaces
+ * the one still waiting.
+ *
+ * On start-up, restore_checkpoint() maps the file, checks its version,
+ * size and checksum and that every registered plan has a record with the
+ * same coefficients, and only then copies the state in. Filtering resumes
+ * from the returned position and the output is bit-identical to an
+ * uninterrupted run.
+ *
+ * File layout, all fields in host byte order:
+ *
+ * | Part    | Size                  | Contents                                            |
+ * |---------|-----------------------|-----------------------------------------------------|
+ * | header  | 48                    | magic "FIRK", version, sequence, position, records, |
+ * |         |                       | payload bytes, FNV-1a checksum of the payload       |
+ * | records | 40 + payload each     | name, kind, payload bytes, then a plan or the stats |
+ *
+ * A plan record holds the coefficient count, block length, kernel name,
+ * fast FIR factors, a hash of the coefficients and the history; a stats
+ * record an FIR_pipeline_stats_t accumulator.
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "plan.h"
+#include "pipeline.h"
+
+#define CHECKPOINT_MAGIC        "FIRK"
+#define CHECKPOINT_VERSION      1U
+#define CHECKPOINT_NAME_MAX     32U
+#define CHECKPOINT_MAX_ENTRIES  4096U
+
+typedef struct FIR_checkpoint FIR_checkpoint_t;
+
+typedef struct {
+    uint32_t entries;
+    uint64_t bytes;           /* size of one checkpoint file */
+    uint64_t captures;
+    uint64_t superseded;      /* snapshots replaced by a newer one before the writer got to them */
+    uint64_t written;
+    uint64_t failed;
+    uint64_t last_sequence;   /* sequence of the last checkpoint written */
+    uint64_t capture_ns_sum;  /* time the filter thread spent in captures */
+    uint64_t capture_ns_max;
+    uint64_t write_ns_max;    /* longest write, sync and rename */
+} FIR_checkpoint_report_t;
+
+FIR_checkpoint_t *create_checkpoint(const char *p_filename);
+bool checkpoint_track_plan(FIR_checkpoint_t *p_checkpoint, const char *p_name, FIR_plan_t *p_plan);
+bool checkpoint_track_stats(FIR_checkpoint_t *p_checkpoint, const char *p_name, FIR_pipeline_stats_t *p_stats);
+bool capture_checkpoint(FIR_checkpoint_t *p_checkpoint, uint64_t p_position);
+bool flush_checkpoint(FIR_checkpoint_t *p_checkpoint);
+bool restore_checkpoint(FIR_checkpoint_t *p_checkpoint, uint64_t *p_position);
+void read_checkpoint_report(FIR_checkpoint_t *p_checkpoint, FIR_checkpoint_report_t *p_report);
+void print_checkpoint_report(const FIR_checkpoint_report_t *p_report);
+void destroy_checkpoint(FIR_checkpoint_t *p_checkpoint);
+
+#endif  /* CHECKPOINT_H_ */
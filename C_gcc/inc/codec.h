@@ -0,0 +1,68 @@
+/**
+ * @file codec.h
+ * @brief Compressed, block-seekable files of filtered float32 signals.
+ *
+ * Samples are coded in independent blocks. Each sample is turned into an
+ * integer: its float32 bit pattern, mapped so that integer order follows
+ * float order (lossless), or the nearest multiple of a step of twice the
+ * allowed error (lossy). Each integer is predicted from the previous ones
+ * with a polynomial predictor of order 0 to 3, whichever suits the block
+ * best. The zigzag-coded residuals are bit-packed in groups of
+ * CODEC_GROUP, each group at the width of its largest residual. A smooth
+ * band-limited signal has small residuals, so it needs far fewer than
+ * 32 bits per sample.
+ *
+ * A lossy block is only used if every sample decodes within the allowed
+ * error. Otherwise the block, and any block with non-finite samples, is
+ * coded losslessly, so the error bound always holds. A block that would
+ * not shrink, e.g. noise-like or near-Nyquist content, is stored as raw
+ * float32, so a file never grows by more than its headers and index.
+ *
+ * File layout, all fields in host byte order:
+ *
+ * | Part    | Size                 | Contents                                         |
+ * |---------|----------------------|--------------------------------------------------|
+ * | header  | 32                   | magic "FIRZ", version, block length, step, samples |
+ * | blocks  | 12 + payload each    | samples, payload bytes, mode, predictor order    |
+ * | index   | 8 per block          | file offset of every block                       |
+ * | footer  | 24                   | index offset, block count, magic "FIRZ"          |
+ *
+ * Writers and readers stream one block at a time. Readers use the index
+ * to seek to any sample without decoding the blocks before it.
+ */
+
+#ifndef CODEC_H_
+#define CODEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+
+#define CODEC_MAGIC          "FIRZ"
+#define CODEC_VERSION        1U
+#define CODEC_DEFAULT_BLOCK  4096U  /* samples per block, the unit of seeking */
+#define CODEC_GROUP          64U    /* samples sharing one bit width */
+
+typedef struct FIR_codec_writer FIR_codec_writer_t;
+typedef struct FIR_codec_reader FIR_codec_reader_t;
+
+typedef struct {
+    uint64_t samples;
+    uint64_t blocks;
+    uint64_t lossy_blocks;  /* blocks quantised; the others are lossless or raw */
+    uint64_t bytes;         /* file size */
+} FIR_codec_report_t;
+
+FIR_codec_writer_t *open_codec_writer(const char *p_filename, float32_t p_max_error, uint32_t p_block_len);
+bool write_codec_samples(FIR_codec_writer_t *p_writer, const float32_t *p_samples, uint64_t p_count);
+bool close_codec_writer(FIR_codec_writer_t *p_writer, FIR_codec_report_t *p_report);
+
+FIR_codec_reader_t *open_codec_reader(const char *p_filename);
+uint64_t codec_sample_count(const FIR_codec_reader_t *p_reader);
+bool seek_codec_reader(FIR_codec_reader_t *p_reader, uint64_t p_sample);
+uint64_t read_codec_samples(FIR_codec_reader_t *p_reader, float32_t *p_samples, uint64_t p_count);
+void close_codec_reader(FIR_codec_reader_t *p_reader);
+
+void print_codec_report(const char *p_label, const FIR_codec_report_t *p_report);
+
+#endif  /* CODEC_H_ */
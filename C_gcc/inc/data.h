@@ -158,4 +158,153 @@ float Filter_2_b_fir[] = {
 #define Filter_2_N_FIR_A 1
 float Filter_2_a_fir[] = {1.0000000f};
 
+// x1 filter, coefficients quantised to sfix16
+#define Filter_1_Fixed_N_FIR_B 359
+float Filter_1_Fixed_b_fir[] = {
+    0.0037231f,  0.0065308f,  -0.0051575f, 0.0024719f,  0.0015564f,
+    0.0027771f,  0.0015259f,  0.0002747f,  -0.0011292f, -0.0017700f,
+    -0.0016479f, -0.0007935f, 0.0002747f,  0.0010986f,  0.0013428f,
+    0.0009766f,  0.0002441f,  -0.0004883f, -0.0009155f, -0.0009155f,
+    -0.0004883f, 0.0000610f,  0.0004883f,  0.0006104f,  0.0004578f,
+    0.0001526f,  -0.0001221f, -0.0002441f, -0.0001831f, -0.0000610f,
+    0.0000000f,  -0.0000610f, -0.0001831f, -0.0002747f, -0.0001831f,
+    0.0001221f,  0.0004883f,  0.0007324f,  0.0006409f,  0.0001526f,
+    -0.0005493f, -0.0010986f, -0.0012207f, -0.0007324f, 0.0001831f,
+    0.0011597f,  0.0017090f,  0.0014954f,  0.0005188f,  -0.0007935f,
+    -0.0018616f, -0.0021057f, -0.0013733f, 0.0000305f,  0.0015259f,
+    0.0023499f,  0.0021362f,  0.0009155f,  -0.0007324f, -0.0020752f,
+    -0.0024414f, -0.0017395f, -0.0002441f, 0.0013123f,  0.0022278f,
+    0.0020752f,  0.0010376f,  -0.0003967f, -0.0014954f, -0.0018311f,
+    -0.0013428f, -0.0003357f, 0.0006409f,  0.0011292f,  0.0009766f,
+    0.0004883f,  -0.0000305f, -0.0002747f, -0.0001526f, 0.0000916f,
+    0.0001221f,  -0.0002136f, -0.0007629f, -0.0011597f, -0.0009460f,
+    -0.0000610f, 0.0012207f,  0.0022583f,  0.0023804f,  0.0012512f,
+    -0.0007935f, -0.0028381f, -0.0038147f, -0.0030518f, -0.0006714f,
+    0.0023499f,  0.0046082f,  0.0048523f,  0.0028076f,  -0.0007629f,
+    -0.0042419f, -0.0060120f, -0.0050354f, -0.0016479f, 0.0026245f,
+    0.0058899f,  0.0065002f,  0.0041504f,  -0.0001526f, -0.0043640f,
+    -0.0066223f, -0.0058289f, -0.0024414f, 0.0019531f,  0.0052795f,
+    0.0060730f,  0.0041199f,  0.0005188f,  -0.0029602f, -0.0047607f,
+    -0.0042725f, -0.0019836f, 0.0007324f,  0.0025330f,  0.0027466f,
+    0.0017090f,  0.0003357f,  -0.0004578f, -0.0003052f, 0.0003662f,
+    0.0006409f,  -0.0001526f, -0.0018616f, -0.0034790f, -0.0036621f,
+    -0.0016479f, 0.0021973f,  0.0061340f,  0.0079041f,  0.0059204f,
+    0.0003357f,  -0.0066833f, -0.0117188f, -0.0117798f, -0.0059204f,
+    0.0038147f,  0.0131226f,  0.0173035f,  0.0136108f,  0.0028381f,
+    -0.0105591f, -0.0203247f, -0.0213623f, -0.0122986f, 0.0034485f,
+    0.0189209f,  0.0266724f,  0.0224304f,  0.0073547f,  -0.0122070f,
+    -0.0272827f, -0.0305176f, -0.0196838f, 0.0008850f,  0.0220032f,
+    0.0338745f,  0.0305786f,  0.0130005f,  -0.0111694f, -0.0309753f,
+    -0.0371094f, -0.0263672f, -0.0032959f, 0.0217285f,  0.0372314f,
+    0.0359802f,  0.0183411f,  -0.0078125f, -0.0305481f, 0.9605103f,
+    -0.0305481f, -0.0078125f, 0.0183411f,  0.0359802f,  0.0372314f,
+    0.0217285f,  -0.0032959f, -0.0263672f, -0.0371094f, -0.0309753f,
+    -0.0111694f, 0.0130005f,  0.0305786f,  0.0338745f,  0.0220032f,
+    0.0008850f,  -0.0196838f, -0.0305176f, -0.0272827f, -0.0122070f,
+    0.0073547f,  0.0224304f,  0.0266724f,  0.0189209f,  0.0034485f,
+    -0.0122986f, -0.0213623f, -0.0203247f, -0.0105591f, 0.0028381f,
+    0.0136108f,  0.0173035f,  0.0131226f,  0.0038147f,  -0.0059204f,
+    -0.0117798f, -0.0117188f, -0.0066833f, 0.0003357f,  0.0059204f,
+    0.0079041f,  0.0061340f,  0.0021973f,  -0.0016479f, -0.0036621f,
+    -0.0034790f, -0.0018616f, -0.0001526f, 0.0006409f,  0.0003662f,
+    -0.0003052f, -0.0004578f, 0.0003357f,  0.0017090f,  0.0027466f,
+    0.0025330f,  0.0007324f,  -0.0019836f, -0.0042725f, -0.0047607f,
+    -0.0029602f, 0.0005188f,  0.0041199f,  0.0060730f,  0.0052795f,
+    0.0019531f,  -0.0024414f, -0.0058289f, -0.0066223f, -0.0043640f,
+    -0.0001526f, 0.0041504f,  0.0065002f,  0.0058899f,  0.0026245f,
+    -0.0016479f, -0.0050354f, -0.0060120f, -0.0042419f, -0.0007629f,
+    0.0028076f,  0.0048523f,  0.0046082f,  0.0023499f,  -0.0006714f,
+    -0.0030518f, -0.0038147f, -0.0028381f, -0.0007935f, 0.0012512f,
+    0.0023804f,  0.0022583f,  0.0012207f,  -0.0000610f, -0.0009460f,
+    -0.0011597f, -0.0007629f, -0.0002136f, 0.0001221f,  0.0000916f,
+    -0.0001526f, -0.0002747f, -0.0000305f, 0.0004883f,  0.0009766f,
+    0.0011292f,  0.0006409f,  -0.0003357f, -0.0013428f, -0.0018311f,
+    -0.0014954f, -0.0003967f, 0.0010376f,  0.0020752f,  0.0022278f,
+    0.0013123f,  -0.0002441f, -0.0017395f, -0.0024414f, -0.0020752f,
+    -0.0007324f, 0.0009155f,  0.0021362f,  0.0023499f,  0.0015259f,
+    0.0000305f,  -0.0013733f, -0.0021057f, -0.0018616f, -0.0007935f,
+    0.0005188f,  0.0014954f,  0.0017090f,  0.0011597f,  0.0001831f,
+    -0.0007324f, -0.0012207f, -0.0010986f, -0.0005493f, 0.0001526f,
+    0.0006409f,  0.0007324f,  0.0004883f,  0.0001221f,  -0.0001831f,
+    -0.0002747f, -0.0001831f, -0.0000610f, 0.0000000f,  -0.0000610f,
+    -0.0001831f, -0.0002441f, -0.0001221f, 0.0001526f,  0.0004578f,
+    0.0006104f,  0.0004883f,  0.0000610f,  -0.0004883f, -0.0009155f,
+    -0.0009155f, -0.0004883f, 0.0002441f,  0.0009766f,  0.0013428f,
+    0.0010986f,  0.0002747f,  -0.0007935f, -0.0016479f, -0.0017700f,
+    -0.0011292f, 0.0002747f,  0.0015259f,  0.0027771f,  0.0015564f,
+    0.0024719f,  -0.0051575f, 0.0065308f,  0.0037231f};
+
+#define Filter_1_Fixed_N_FIR_A 1
+float Filter_1_Fixed_a_fir[] = {1.0000000f};
+
+// x2 filter, coefficients quantised to sfix16
+#define Filter_2_Fixed_N_FIR_B 315
+float Filter_2_Fixed_b_fir[] = {
+    0.0001831f,  -0.0118713f, 0.0001831f,  -0.0017090f, -0.0009460f,
+    0.0012817f,  0.0013733f,  -0.0007629f, -0.0016174f, 0.0001526f,
+    0.0016785f,  0.0004272f,  -0.0015259f, -0.0009766f, 0.0011902f,
+    0.0014343f,  -0.0006714f, -0.0017090f, 0.0000610f,  0.0017700f,
+    0.0005798f,  -0.0015869f, -0.0011597f, 0.0011902f,  0.0015869f,
+    -0.0006104f, -0.0018005f, -0.0000305f, 0.0017700f,  0.0006714f,
+    -0.0014954f, -0.0011597f, 0.0010071f,  0.0014648f,  -0.0004578f,
+    -0.0014954f, -0.0001221f, 0.0013123f,  0.0005493f,  -0.0009460f,
+    -0.0007629f, 0.0005188f,  0.0007629f,  -0.0001526f, -0.0005493f,
+    -0.0000610f, 0.0002136f,  0.0000305f,  0.0000916f,  0.0002136f,
+    -0.0002441f, -0.0006409f, 0.0001526f,  0.0010681f,  0.0002441f,
+    -0.0014038f, -0.0009155f, 0.0014343f,  0.0017090f,  -0.0010681f,
+    -0.0025024f, 0.0003052f,  0.0030518f,  0.0008240f,  -0.0031738f,
+    -0.0021362f, 0.0027161f,  0.0034180f,  -0.0017090f, -0.0043640f,
+    0.0002136f,  0.0047913f,  0.0015259f,  -0.0044861f, -0.0032654f,
+    0.0035095f,  0.0046997f,  -0.0018921f, -0.0054932f, -0.0000610f,
+    0.0055542f,  0.0020752f,  -0.0047913f, -0.0037537f, 0.0033569f,
+    0.0048218f,  -0.0015259f, -0.0051270f, -0.0003357f, 0.0046692f,
+    0.0019226f,  -0.0035706f, -0.0028992f, 0.0021057f,  0.0031433f,
+    -0.0007019f, -0.0026855f, -0.0003052f, 0.0017700f,  0.0006409f,
+    -0.0007019f, -0.0002747f, -0.0000916f, -0.0007324f, 0.0002441f,
+    0.0020142f,  0.0004883f,  -0.0031128f, -0.0021057f, 0.0035400f,
+    0.0043640f,  -0.0028687f, -0.0067444f, 0.0008850f,  0.0086670f,
+    0.0023193f,  -0.0093994f, -0.0064087f, 0.0084839f,  0.0106812f,
+    -0.0056152f, -0.0143127f, 0.0008545f,  0.0163574f,  0.0052490f,
+    -0.0161438f, -0.0119019f, 0.0132446f,  0.0179443f,  -0.0076599f,
+    -0.0223083f, -0.0000916f, 0.0239258f,  0.0090027f,  -0.0221558f,
+    -0.0177917f, 0.0168762f,  0.0250244f,  -0.0085144f, -0.0293884f,
+    -0.0018921f, 0.0299683f,  0.0129700f,  -0.0263367f, -0.0230713f,
+    0.0187378f,  0.0306091f,  -0.0080872f, -0.0342712f, -0.0042114f,
+    0.0333862f,  0.0164185f,  -0.0279236f, -0.0267334f, 0.0185242f,
+    0.0335999f,  -0.0064697f, 0.9639893f,  -0.0064697f, 0.0335999f,
+    0.0185242f,  -0.0267334f, -0.0279236f, 0.0164185f,  0.0333862f,
+    -0.0042114f, -0.0342712f, -0.0080872f, 0.0306091f,  0.0187378f,
+    -0.0230713f, -0.0263367f, 0.0129700f,  0.0299683f,  -0.0018921f,
+    -0.0293884f, -0.0085144f, 0.0250244f,  0.0168762f,  -0.0177917f,
+    -0.0221558f, 0.0090027f,  0.0239258f,  -0.0000916f, -0.0223083f,
+    -0.0076599f, 0.0179443f,  0.0132446f,  -0.0119019f, -0.0161438f,
+    0.0052490f,  0.0163574f,  0.0008545f,  -0.0143127f, -0.0056152f,
+    0.0106812f,  0.0084839f,  -0.0064087f, -0.0093994f, 0.0023193f,
+    0.0086670f,  0.0008850f,  -0.0067444f, -0.0028687f, 0.0043640f,
+    0.0035400f,  -0.0021057f, -0.0031128f, 0.0004883f,  0.0020142f,
+    0.0002441f,  -0.0007324f, -0.0000916f, -0.0002747f, -0.0007019f,
+    0.0006409f,  0.0017700f,  -0.0003052f, -0.0026855f, -0.0007019f,
+    0.0031433f,  0.0021057f,  -0.0028992f, -0.0035706f, 0.0019226f,
+    0.0046692f,  -0.0003357f, -0.0051270f, -0.0015259f, 0.0048218f,
+    0.0033569f,  -0.0037537f, -0.0047913f, 0.0020752f,  0.0055542f,
+    -0.0000610f, -0.0054932f, -0.0018921f, 0.0046997f,  0.0035095f,
+    -0.0032654f, -0.0044861f, 0.0015259f,  0.0047913f,  0.0002136f,
+    -0.0043640f, -0.0017090f, 0.0034180f,  0.0027161f,  -0.0021362f,
+    -0.0031738f, 0.0008240f,  0.0030518f,  0.0003052f,  -0.0025024f,
+    -0.0010681f, 0.0017090f,  0.0014343f,  -0.0009155f, -0.0014038f,
+    0.0002441f,  0.0010681f,  0.0001526f,  -0.0006409f, -0.0002441f,
+    0.0002136f,  0.0000916f,  0.0000305f,  0.0002136f,  -0.0000610f,
+    -0.0005493f, -0.0001526f, 0.0007629f,  0.0005188f,  -0.0007629f,
+    -0.0009460f, 0.0005493f,  0.0013123f,  -0.0001221f, -0.0014954f,
+    -0.0004578f, 0.0014648f,  0.0010071f,  -0.0011597f, -0.0014954f,
+    0.0006714f,  0.0017700f,  -0.0000305f, -0.0018005f, -0.0006104f,
+    0.0015869f,  0.0011902f,  -0.0011597f, -0.0015869f, 0.0005798f,
+    0.0017700f,  0.0000610f,  -0.0017090f, -0.0006714f, 0.0014343f,
+    0.0011902f,  -0.0009766f, -0.0015259f, 0.0004272f,  0.0016785f,
+    0.0001526f,  -0.0016174f, -0.0007629f, 0.0013733f,  0.0012817f,
+    -0.0009460f, -0.0017090f, 0.0001831f,  -0.0118713f, 0.0001831f};
+
+#define Filter_2_Fixed_N_FIR_A 1
+float Filter_2_Fixed_a_fir[] = {1.0000000f};
+
 #endif  /* DATA_H_ */
@@ -0,0 +1,64 @@
+/**
+ * @file ffa.h
+ * @brief Fast FIR algorithms: parallel FFA decompositions with fewer multiplies.
+ *
+ * The signal and the taps are split into L polyphase components,
+ * x_i[k] = x[kL + i] and h_i[k] = h[kL + i], so that output phase j is a
+ * sum of short sub-filter products h_a * x_b with a + b = j or j + L (the
+ * latter delayed by one decimated sample). Computed naively that is L^2
+ * sub-filters of N/L taps, i.e. N multiplies per output as in direct form.
+ *
+ * A fast FIR algorithm forms the same sums from fewer products, the way
+ * Karatsuba multiplies polynomials:
+ *
+ *     L = 2:  H0 X0, H1 X1, (H0+H1)(X0+X1)                     3 products
+ *     L = 3:  H0 X0, H1 X1, H2 X2, (H0+H1)(X0+X1),
+ *             (H1+H2)(X1+X2), (H0+H1+H2)(X0+X1+X2)              6 products
+ *
+ * and the outputs are recovered with a few additions, e.g. for L = 2
+ * Y0 = H0 X0 + z^-2 H1 X1 and Y1 = (H0+H1)(X0+X1) - H0 X0 - H1 X1. Each
+ * product is a sub-filter of N/L taps run over a pre-added decimated
+ * stream, so a 2-parallel level costs 3/4 and a 3-parallel level 2/3 of the
+ * direct multiplies. Levels nest: a 2x3 decomposition (L = 6) runs 18
+ * sub-filters of N/6 taps, N/2 multiplies per output, and 3x3 (L = 9)
+ * 36 of N/9, 4N/9. The savings are paid for in pre- and post-additions
+ * and in a fixed cost per product (a pass to pre-add its stream, a row of
+ * outputs to write and read back), which grow with the depth, so the cost
+ * model counts them too and stops at two or three levels.
+ *
+ * Everything stays in the time domain: a block of p_len outputs needs no
+ * more than the p_len inputs and the history, so unlike FFT convolution
+ * there is no extra latency. The sums are reordered, so the output is not
+ * bit-identical to the direct form: terms that cancel in exact arithmetic
+ * cancel only to rounding here, which leaves an error a little larger than
+ * that of the folded kernels (`main -f` prints both).
+ */
+
+#ifndef FFA_H_
+#define FFA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+
+#define FFA_MAX_LEVELS    3U
+#define FFA_MAX_PARALLEL  12U  /* L: product of the factors of all levels */
+#define FFA_MAX_PRODUCTS  54U  /* M: sub-filters of the largest decomposition, 2x2x3 */
+#define FFA_SLACK         16U  /* samples read before the coeff_len-1 history, at least FFA_MAX_PARALLEL */
+
+typedef struct FIR_ffa FIR_ffa_t;
+
+uint32_t ffa_cost(uint32_t p_coeff_len, const uint32_t *p_factors, uint32_t p_levels);
+uint32_t choose_ffa_factors(uint32_t p_coeff_len, uint32_t *p_factors);
+
+FIR_ffa_t *create_ffa(const float32_t *p_coeffs, uint32_t p_coeff_len, uint32_t p_block_len,
+                      const uint32_t *p_factors, uint32_t p_levels);
+uint32_t ffa_parallelism(const FIR_ffa_t *p_ffa);
+uint32_t ffa_factors(const FIR_ffa_t *p_ffa, uint32_t *p_factors);
+uint32_t ffa_multiplies(const FIR_ffa_t *p_ffa);
+uint32_t ffa_plan_cost(const FIR_ffa_t *p_ffa);
+void describe_ffa(const FIR_ffa_t *p_ffa, char *p_text, uint32_t p_text_len);
+uint32_t run_ffa(FIR_ffa_t *p_ffa, const float32_t *p_x, uint32_t p_len, float32_t *p_y);
+void destroy_ffa(FIR_ffa_t *p_ffa);
+
+#endif  /* FFA_H_ */
@@ -24,8 +24,19 @@ void generate_signal(uint32_t *p_input, uint32_t p_input_len, float32_t *p_outpu
 void calculate_mean(uint32_t *p_input, uint32_t p_input_len, float32_t *p_output);
 void filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output);
 void symm_filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output);
+void filter_signal_inplace(float32_t *p_signal, uint32_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history);
+void symm_filter_signal_inplace(float32_t *p_signal, uint32_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history);
+void filter_channels_inplace(float32_t *p_frames, uint32_t p_frame_count, uint32_t p_channel_count, FIR_filter_t *p_filter, float32_t *p_history);
 void print_statistics(float32_t *p_y1, float32_t *p_y2, uint32_t p_y_len, uint32_t p_print_start, uint32_t p_print_end);
 void record_output(float32_t *p_output, uint32_t p_output_len, const char *p_filename);
 
+/* 64-bit length entry points for signals of 4G samples or more */
+void filter_signal64(float32_t *p_input, uint64_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output);
+void symm_filter_signal64(float32_t *p_input, uint64_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output);
+void filter_signal_inplace64(float32_t *p_signal, uint64_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history);
+void symm_filter_signal_inplace64(float32_t *p_signal, uint64_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history);
+void filter_channels_inplace64(float32_t *p_frames, uint64_t p_frame_count, uint32_t p_channel_count, FIR_filter_t *p_filter, float32_t *p_history);
+bool record_output64(float32_t *p_output, uint64_t p_output_len, const char *p_filename);
+
 
 #endif  /* FILTER_H_ */
@@ -0,0 +1,25 @@
+/**
+ * @file fir_target.h
+ * @brief Per-ISA function multiversioning for the hot filter kernels.
+ *
+ * Functions marked FIR_MULTIVERSION are compiled once per x86-64
+ * micro-architecture level and the best clone is picked by the dynamic
+ * loader (IFUNC) on first call. Define FIR_NO_MULTIVERSION, or build for
+ * a non-x86-64 target, to get a single portable version instead.
+ */
+
+#ifndef FIR_TARGET_H_
+#define FIR_TARGET_H_
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__) \
+    && !defined(FIR_NO_MULTIVERSION)
+#define FIR_MULTIVERSION \
+    __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3", "arch=x86-64-v4")))
+#else
+#define FIR_MULTIVERSION
+#endif
+
+/* Outputs computed together by the tiled kernels; one AVX-512 register of floats */
+#define FIR_TILE 16U
+
+#endif  /* FIR_TARGET_H_ */
@@ -0,0 +1,20 @@
+/**
+ * @file hash.h
+ * @brief FNV-1a hash over raw bytes.
+ *
+ * Used wherever bit patterns must be compared across runs, builds and
+ * machines: the coefficient keys in wisdom files and checkpoints, the
+ * checkpoint payload checksum and the output checksums of the self-test.
+ */
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <stdint.h>
+
+#define FNV1A_OFFSET_BASIS  14695981039346656037ULL
+#define FNV1A_PRIME         1099511628211ULL
+
+uint64_t fnv1a(const void *p_bytes, uint64_t p_len);
+
+#endif  /* HASH_H_ */
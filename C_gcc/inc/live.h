@@ -0,0 +1,36 @@
+/**
+ * @file live.h
+ * @brief Streaming filter whose coefficients can be replaced while it runs.
+ *
+ * A live filter owns the input history, so a new coefficient set picks up
+ * exactly where the old one left off. New coefficients are planned on the
+ * control thread and published through an atomic pointer; the data thread
+ * adopts them at its next block boundary and, if asked to, crossfades from
+ * the old output to the new one over a number of samples. Replaced plans go
+ * back to the control thread through a second atomic pointer and are freed
+ * there, so the data thread never takes a lock, allocates or frees.
+ *
+ * Threading: execute_live_filter() is called from one data thread;
+ * publish_live_filter() and reclaim_live_filter() from one control thread.
+ */
+
+#ifndef LIVE_H_
+#define LIVE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+#include "plan.h"
+
+typedef struct FIR_live_filter FIR_live_filter_t;
+
+FIR_live_filter_t *create_live_filter(FIR_filter_t *p_filter, uint32_t p_max_taps, uint32_t p_block_len,
+                                      uint32_t p_crossfade_len, FIR_plan_mode_t p_mode);
+bool publish_live_filter(FIR_live_filter_t *p_live, FIR_filter_t *p_filter, FIR_plan_mode_t p_mode);
+void reclaim_live_filter(FIR_live_filter_t *p_live);
+void execute_live_filter(FIR_live_filter_t *p_live, const float32_t *p_input, uint64_t p_input_len,
+                         float32_t *p_output);
+uint64_t live_filter_swaps(FIR_live_filter_t *p_live);
+void destroy_live_filter(FIR_live_filter_t *p_live);
+
+#endif  /* LIVE_H_ */
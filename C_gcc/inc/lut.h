@@ -0,0 +1,68 @@
+/**
+ * @file lut.h
+ * @brief Table-lookup FIR engine for integer inputs with a small alphabet.
+ *
+ * Inputs are integer codes of a few bits (ADC codes, the digits behind
+ * generate_signal) mapped to sample values by a table. With b-bit codes,
+ * g = 8 / b consecutive codes fit in one byte, so the taps are split into
+ * groups of g and, for each group, the partial sum of its taps over every
+ * possible byte is precomputed:
+ *
+ *     T_j[w] = sum_{i<g} h[j*g + i] * value(code i of w)
+ *
+ * A running byte window w[n] holds codes n, n-1, .., n-g+1, and the output
+ * is one table read per group instead of g multiplies:
+ *
+ *     y[n] = sum_j T_j[w[n - j*g]]
+ *
+ * Before the first sample the history holds the first code whose value is
+ * 0, so a spare code mapped to 0 gives the zero history of filter_signal.
+ *
+ * The engine is picked automatically from the code width: the table engine
+ * when its reads are cheaper than the multiplies of the best plan kernel,
+ * otherwise the codes are widened to float32 and filtered by the plan.
+ */
+
+#ifndef LUT_H_
+#define LUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+#include "plan.h"
+
+#define LUT_INDEX_BITS  8U  /* bits of packed codes indexing one table */
+
+typedef enum {
+    FIR_INT_ENGINE_MAC = 0,  /* widen codes to float32, run the plan's kernel */
+    FIR_INT_ENGINE_LUT,      /* partial-sum tables over groups of taps */
+    FIR_INT_ENGINE_COUNT
+} FIR_int_engine_t;
+
+typedef struct {
+    FIR_int_engine_t engine;
+    uint32_t         bits;         /* bits per input code, 1 .. LUT_INDEX_BITS */
+    uint32_t         block_len;
+    float32_t        values[1U << LUT_INDEX_BITS];  /* sample value of each code */
+    uint32_t         rest_code;    /* code the history is filled with; the first of value 0 */
+    FIR_plan_t      *plan;         /* MAC engine, also used to rank the engines */
+    uint32_t         group_len;    /* taps per table, LUT_INDEX_BITS / bits */
+    uint32_t         group_count;
+    uint32_t         table_len;    /* 1 << (group_len * bits) */
+    float32_t       *tables;       /* group_count tables of table_len partial sums */
+    uint8_t         *windows;      /* (group_count-1)*group_len history windows, then block_len */
+    uint32_t         window;       /* packed window ending at the latest code */
+} FIR_int_plan_t;
+
+const char *int_engine_name(FIR_int_engine_t p_engine);
+
+FIR_int_plan_t *create_int_filter_plan(FIR_filter_t *p_filter, uint32_t p_bits, const float32_t *p_values,
+                                       uint32_t p_block_len, FIR_plan_mode_t p_mode);
+FIR_int_plan_t *create_int_filter_plan_with_engine(FIR_filter_t *p_filter, uint32_t p_bits, const float32_t *p_values,
+                                                   uint32_t p_block_len, FIR_int_engine_t p_engine);
+void execute_int_filter_plan(FIR_int_plan_t *p_plan, const uint8_t *p_codes, uint64_t p_len, float32_t *p_output);
+double benchmark_int_filter_plan(FIR_int_plan_t *p_plan, const uint8_t *p_codes, uint64_t p_len, float32_t *p_output);
+void reset_int_filter_plan(FIR_int_plan_t *p_plan);
+void destroy_int_filter_plan(FIR_int_plan_t *p_plan);
+
+#endif  /* LUT_H_ */
@@ -0,0 +1,43 @@
+/**
+ * @file multi.h
+ * @brief Filter bank: K coefficient sets applied to one input in a single sweep.
+ *
+ * Comparing filter variants on the same signal (a design and its quantised
+ * counterpart, several notch candidates) would otherwise take one pass over
+ * the input per variant. A multi-filter plan stages each block of input
+ * once and runs every filter over it while it is still in cache. Filters
+ * are processed in groups of MULTI_GROUP whose taps are interleaved, so each
+ * input load feeds MULTI_GROUP multiplies instead of one.
+ *
+ * Every output accumulates its taps in ascending order, as kernel_direct
+ * does, so each of the K outputs is bit-identical to a direct-form plan of
+ * the same filter. Filters shorter than the longest are padded with zero
+ * taps at the end, which leaves their sums unchanged.
+ */
+
+#ifndef MULTI_H_
+#define MULTI_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+
+#define MULTI_GROUP  4U  /* filters sharing each input load */
+
+typedef struct {
+    uint32_t   filter_count;
+    uint32_t   group_count;    /* filter_count / MULTI_GROUP rounded up; the last group may be padded */
+    uint32_t   coeff_len;      /* taps of the longest filter */
+    uint32_t   block_len;
+    float32_t *coeffs;         /* per group, coeff_len rows of MULTI_GROUP interleaved taps */
+    float32_t *work;           /* coeff_len-1 history samples followed by block_len samples */
+} FIR_multi_plan_t;
+
+FIR_multi_plan_t *create_multi_filter_plan(FIR_filter_t *const *p_filters, uint32_t p_filter_count,
+                                           uint32_t p_block_len);
+void execute_multi_filter_plan(FIR_multi_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len,
+                               float32_t *const *p_outputs);
+void reset_multi_filter_plan(FIR_multi_plan_t *p_plan);
+void destroy_multi_filter_plan(FIR_multi_plan_t *p_plan);
+
+#endif  /* MULTI_H_ */
@@ -0,0 +1,88 @@
+/**
+ * @file pipeline.h
+ * @brief Block-by-block processing chains without intermediate signal arrays.
+ *
+ * A pipeline is a chain of stages: one source (a generate_signal-style
+ * generator, a caller array or a sample file), then any number of FIR and
+ * IIR filters, gains, statistics taps and sinks, in the order added. It is
+ * run one block at a time: the source fills a block buffer and every stage
+ * transforms it in place, so each block goes through the whole chain while
+ * it is still in L1 and no stage ever holds the full signal.
+ *
+ * Runs of consecutive elementwise stages (gain, statistics) are fused into
+ * one loop over the block, FIR_TILE samples at a time, so a sample stays in
+ * registers from the first stage of the run to the last. A run right after
+ * a FIR stage is fused into the FIR's output: it is applied to each tile
+ * the kernel stores (execute_filter_plan_fused()), not in a pass of its own.
+ *
+ * A chain can also be declared as text, stages separated by commas:
+ *
+ *     gen:<digits>:<len>   repeat the mean-centred digits for len samples
+ *     read:<file>          samples of a sample file, widened to float32
+ *     unzip:<file>         samples of a compressed signal file (codec.h)
+ *     fir:<filter>         bank filter, run through a plan
+ *     iir:<filter>         bank filter, b and a coefficients in direct form II transposed
+ *     gain:<g>[:<offset>]  y = g * x + offset
+ *     stats:<label>        count, mean, RMS, min and max of the samples passing
+ *     text:<file>          comma separated text, as written by record_output
+ *     write:<file>         float32 sample file
+ *     zip:<file>[:<err>]   compressed signal file, lossless or within err of the input
+ *
+ * e.g. "gen:202118874:900,fir:filter1,stats:y1,text:data1.txt".
+ */
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+#include "plan.h"
+#include "batch.h"
+
+#define PIPELINE_MAX_STAGES   32U
+#define PIPELINE_LABEL_MAX    32U
+#define PIPELINE_DEFAULT_BLOCK  256U  /* samples; one block and the FIR history fit in L1 */
+
+typedef struct FIR_pipeline FIR_pipeline_t;
+
+typedef struct {
+    char      label[PIPELINE_LABEL_MAX];
+    uint64_t  count;
+    double    sum;
+    double    sum_sq;
+    float32_t min;
+    float32_t max;
+} FIR_pipeline_stats_t;
+
+typedef struct {
+    uint64_t samples;
+    uint64_t blocks;
+    uint32_t stages;
+    uint32_t passes;   /* loops over each block: stages after fusing elementwise runs */
+    double   wall_s;
+} FIR_pipeline_report_t;
+
+FIR_pipeline_t *create_pipeline(uint32_t p_block_len);
+bool pipeline_add_generator(FIR_pipeline_t *p_pipeline, const uint32_t *p_digits, uint32_t p_digit_len,
+                            uint64_t p_len);
+bool pipeline_add_source(FIR_pipeline_t *p_pipeline, const float32_t *p_samples, uint64_t p_len);
+bool pipeline_add_file_source(FIR_pipeline_t *p_pipeline, const char *p_filename);
+bool pipeline_add_codec_source(FIR_pipeline_t *p_pipeline, const char *p_filename);
+bool pipeline_add_fir(FIR_pipeline_t *p_pipeline, FIR_filter_t *p_filter, FIR_plan_mode_t p_mode);
+bool pipeline_add_iir(FIR_pipeline_t *p_pipeline, FIR_filter_t *p_filter);
+bool pipeline_add_gain(FIR_pipeline_t *p_pipeline, float32_t p_gain, float32_t p_offset);
+bool pipeline_add_stats(FIR_pipeline_t *p_pipeline, const char *p_label);
+bool pipeline_add_array_sink(FIR_pipeline_t *p_pipeline, float32_t *p_samples, uint64_t p_capacity);
+bool pipeline_add_text_sink(FIR_pipeline_t *p_pipeline, const char *p_filename);
+bool pipeline_add_file_sink(FIR_pipeline_t *p_pipeline, const char *p_filename);
+bool pipeline_add_codec_sink(FIR_pipeline_t *p_pipeline, const char *p_filename, float32_t p_max_error);
+
+FIR_pipeline_t *parse_pipeline(const char *p_spec, const FIR_bank_entry_t *p_bank, uint32_t p_bank_len,
+                               uint32_t p_block_len, FIR_plan_mode_t p_mode);
+bool run_pipeline(FIR_pipeline_t *p_pipeline, FIR_pipeline_report_t *p_report);
+const FIR_pipeline_stats_t *pipeline_stats(const FIR_pipeline_t *p_pipeline, uint32_t p_index);
+void print_pipeline_report(const FIR_pipeline_t *p_pipeline, const FIR_pipeline_report_t *p_report);
+void destroy_pipeline(FIR_pipeline_t *p_pipeline);
+
+#endif  /* PIPELINE_H_ */
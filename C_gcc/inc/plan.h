@@ -0,0 +1,113 @@
+/**
+ * @file plan.h
+ * @brief FIR filter plans: coefficient analysis, kernel selection and wisdom.
+ *
+ * A plan inspects the coefficients of a filter once, picks the kernel best
+ * suited to them (by estimate or by timing the candidates on this machine)
+ * and owns the history needed to stream blocks through it. Measured choices
+ * are kept as "wisdom" that can be saved to and loaded from disk, so the
+ * benchmark only runs once per filter and block size.
+ *
+ * Every kernel vectorises across consecutive outputs, never across taps:
+ * each output sums its taps in the kernel's own fixed order, so a kernel
+ * gives the same bits in every ISA clone and however the signal is split
+ * between blocks or threads (the Makefile's -ffp-contract=off keeps FMA
+ * contraction out of the wider clones). What can change between machines
+ * is the kernel: a measured plan, or any plan given wisdom, takes the
+ * fastest kernel on the machine that timed it, and the folded kernels sum
+ * in a different order than the direct one. FIR_PLAN_REPRODUCIBLE chooses
+ * from the coefficients alone, like FIR_PLAN_ESTIMATE, and ignores wisdom,
+ * so its output is bit-identical everywhere: to filter_signal() for the
+ * direct kernel and to symm_filter_signal() for the symmetric one. It
+ * never picks the fast FIR kernel (ffa.h), which has no scalar reference.
+ *
+ * The fixed order costs little because the SIMD lanes already hold
+ * independent outputs. On an AVX-512 machine, reproducible plans of the
+ * bank filters run at 50-60 Msamples/s, about 20x the scalar loops. Builds
+ * with FMA contraction or -ffast-math, which give up bit-identity, were no
+ * faster (`main -d` prints the comparison and an output checksum).
+ */
+
+#ifndef PLAN_H_
+#define PLAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+#include "telemetry.h"
+#include "ffa.h"
+
+/* Coefficient properties reported by analyse_coefficients() */
+#define FIR_COEFF_SYMMETRIC      (1U << 0)  /* h[k] ==  h[N-1-k] */
+#define FIR_COEFF_ANTISYMMETRIC  (1U << 1)  /* h[k] == -h[N-1-k] */
+#define FIR_COEFF_SPARSE         (1U << 2)  /* at most half the taps are non-zero */
+#define FIR_COEFF_HALFBAND       (1U << 3)  /* symmetric, every other tap zero but the centre */
+
+typedef enum {
+    FIR_KERNEL_DIRECT = 0,
+    FIR_KERNEL_SYMMETRIC,
+    FIR_KERNEL_ANTISYMMETRIC,
+    FIR_KERNEL_SPARSE,
+    FIR_KERNEL_HALFBAND,
+    FIR_KERNEL_FFA,
+    FIR_KERNEL_COUNT
+} FIR_kernel_t;
+
+typedef enum {
+    FIR_PLAN_ESTIMATE = 0,  /* pick the kernel from its multiply count */
+    FIR_PLAN_MEASURE,       /* time every valid kernel and keep the fastest */
+    FIR_PLAN_REPRODUCIBLE   /* as estimate, never from wisdom: the same bits on every machine */
+} FIR_plan_mode_t;
+
+typedef struct FIR_plan FIR_plan_t;
+
+typedef void (*FIR_kernel_fn)(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y);
+
+/* Applied in place to each run of outputs right after the kernel stores it (execute_filter_plan_fused) */
+typedef void (*FIR_epilogue_fn)(void *p_context, float32_t *p_y, uint32_t p_len);
+
+/**
+ * Kernels read p_x[-(coeff_len-1)] .. p_x[p_len-1]; the samples before p_x[0]
+ * are the history carried in the work buffer. The work buffer is preceded by
+ * FFA_SLACK zeros for the zero-padded taps of the fast FIR kernel.
+ */
+struct FIR_plan {
+    uint32_t      coeff_len;
+    float32_t    *coeffs;
+    uint32_t      properties;
+    FIR_kernel_t  kernel;
+    FIR_kernel_fn kernel_fn;
+    uint32_t      block_len;
+    float32_t    *work;          /* coeff_len-1 history samples followed by block_len samples */
+    float32_t    *scratch;       /* block_len samples of kernel output when staging */
+    uint32_t      nonzero_count;
+    uint32_t     *nonzero_idx;
+    float32_t    *nonzero_val;
+    FIR_telemetry_t *telemetry;  /* NULL unless attach_plan_telemetry() was called */
+    FIR_ffa_t    *ffa;           /* decomposition of the ffa kernel, NULL for the others */
+};
+
+uint32_t analyse_coefficients(const float32_t *p_coeffs, uint32_t p_coeff_len);
+bool kernel_supported(FIR_kernel_t p_kernel, uint32_t p_properties);
+const char *filter_kernel_name(FIR_kernel_t p_kernel);
+uint32_t filter_plan_cost(const FIR_plan_t *p_plan);
+
+FIR_plan_t *create_filter_plan(FIR_filter_t *p_filter, uint32_t p_block_len, FIR_plan_mode_t p_mode);
+FIR_plan_t *create_filter_plan_with_kernel(FIR_filter_t *p_filter, uint32_t p_block_len, FIR_kernel_t p_kernel);
+FIR_plan_t *create_filter_plan_with_ffa(FIR_filter_t *p_filter, uint32_t p_block_len, const uint32_t *p_factors,
+                                        uint32_t p_levels);
+bool set_filter_plan_kernel(FIR_plan_t *p_plan, FIR_kernel_t p_kernel, FIR_ffa_t *p_ffa);
+void execute_filter_plan(FIR_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len, float32_t *p_output);
+void execute_filter_plan_fused(FIR_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len,
+                               float32_t *p_output, FIR_epilogue_fn p_epilogue, void *p_context);
+void reset_filter_plan(FIR_plan_t *p_plan);
+void attach_plan_telemetry(FIR_plan_t *p_plan, FIR_telemetry_t *p_telemetry);
+void report_plan_telemetry(const FIR_plan_t *p_plan, uint64_t p_blocks, uint64_t p_samples, uint64_t p_start_ns,
+                           const float32_t *p_last_block, uint32_t p_last_len);
+void destroy_filter_plan(FIR_plan_t *p_plan);
+
+bool load_filter_wisdom(const char *p_filename);
+bool save_filter_wisdom(const char *p_filename);
+void forget_filter_wisdom(void);
+
+#endif  /* PLAN_H_ */
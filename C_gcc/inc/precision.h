@@ -0,0 +1,52 @@
+/**
+ * @file precision.h
+ * @brief Reduced-precision (fp16 / bf16) sample storage with fp32 arithmetic.
+ *
+ * Samples may be stored as IEEE half precision (fp16) or bfloat16 to halve
+ * memory and I/O traffic. Arithmetic always happens in float32: narrow data
+ * is widened a block at a time into the plan's work buffer, filtered by the
+ * usual kernels and narrowed again on the way out. Coefficients stay float32
+ * in the plan, a few hundred taps that live in L1 anyway; round_samples()
+ * gives them the values a narrow store would hold, to measure that error.
+ * Conversions use F16C and AVX-512 BF16 instructions when the CPU has them.
+ */
+
+#ifndef PRECISION_H_
+#define PRECISION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+#include "plan.h"
+
+typedef uint16_t float16_t;   /* IEEE 754 binary16 bit pattern */
+typedef uint16_t bfloat16_t;  /* upper half of a float32 bit pattern */
+
+typedef enum {
+    FIR_SAMPLE_F32 = 0,
+    FIR_SAMPLE_F16,
+    FIR_SAMPLE_BF16,
+    FIR_SAMPLE_TYPE_COUNT
+} FIR_sample_type_t;
+
+typedef struct {
+    float32_t max_abs_error;
+    float32_t rms_error;
+    float32_t snr_db;
+} FIR_precision_error_t;
+
+size_t sample_type_size(FIR_sample_type_t p_type);
+const char *sample_type_name(FIR_sample_type_t p_type);
+
+void narrow_samples(const float32_t *p_input, uint64_t p_count, FIR_sample_type_t p_type, void *p_output);
+void widen_samples(const void *p_input, uint64_t p_count, FIR_sample_type_t p_type, float32_t *p_output);
+void round_samples(const float32_t *p_input, uint64_t p_count, FIR_sample_type_t p_type, float32_t *p_output);
+
+void execute_filter_plan_narrow(FIR_plan_t *p_plan, FIR_sample_type_t p_type, const void *p_input,
+                                uint64_t p_input_len, void *p_output);
+
+FIR_precision_error_t measure_precision_error(const float32_t *p_reference, const float32_t *p_test, uint64_t p_len);
+void print_precision_error(const char *p_label, FIR_precision_error_t p_error);
+
+#endif  /* PRECISION_H_ */
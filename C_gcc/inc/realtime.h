@@ -0,0 +1,82 @@
+/**
+ * @file realtime.h
+ * @brief Real-time execution mode for filter threads: pinning, SCHED_FIFO, locked and prefaulted memory.
+ *
+ * Once the kernels are vectorised, the tail latency of a filtering loop is
+ * set less by the arithmetic than by what the system does around it: a
+ * page fault the first time a buffer is written, a migration to another
+ * core with cold caches, a preemption by a normal-priority task. The
+ * real-time mode removes those causes where the process is allowed to:
+ *
+ *     lock_memory    mlockall(MCL_CURRENT | MCL_FUTURE): nothing is paged
+ *                    out, and later mappings are populated when mapped
+ *     prefault       every page of the delay lines and block buffers of a
+ *                    plan, decomposition, live filter or pipeline is
+ *                    touched when it is created, not in its first block
+ *     first_cpu      filter thread w is pinned to CPU first_cpu + w, which
+ *                    must be in the thread's affinity mask
+ *     fifo_priority  filter threads run under SCHED_FIFO at that priority
+ *
+ * configure_realtime() sets the mode for the process and enter_realtime_thread()
+ * applies it to the calling filter thread (batch workers call it themselves).
+ * Without privileges (CAP_SYS_NICE, CAP_IPC_LOCK or a large enough
+ * RLIMIT_MEMLOCK) the corresponding step falls back to normal behaviour and
+ * is counted as such, the rest still applies: prefaulting and pinning need
+ * no privilege. print_realtime_stats() shows what took effect.
+ *
+ * measure_plan_jitter() times every block of a filtering loop and counts
+ * the page faults, context switches and CPU changes it suffered; `main -J`
+ * compares the loop in normal and in real-time mode.
+ */
+
+#ifndef REALTIME_H_
+#define REALTIME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "plan.h"
+#include "tick.h"
+
+#define REALTIME_STACK_PREFAULT  (64U << 10)  /* stack bytes touched by enter_realtime_thread() */
+
+typedef struct {
+    int32_t first_cpu;      /* -1 = no pinning */
+    int32_t fifo_priority;  /* 1-99 for SCHED_FIFO, 0 = normal scheduling */
+    bool    lock_memory;
+    bool    prefault;
+} FIR_realtime_config_t;
+
+typedef struct {
+    bool     enabled;
+    bool     memory_locked;    /* false with lock_memory set: mlockall() was refused */
+    uint32_t threads_entered;
+    uint32_t threads_pinned;
+    uint32_t pin_fallbacks;    /* affinity refused or the CPU is not available */
+    uint32_t threads_fifo;
+    uint32_t fifo_fallbacks;   /* SCHED_FIFO refused, normal scheduling kept */
+    uint64_t prefaulted_bytes;
+} FIR_realtime_stats_t;
+
+typedef struct {
+    FIR_latency_histogram_t histogram;  /* ns per block */
+    uint64_t blocks;
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t involuntary_switches;
+    uint64_t cpu_changes;               /* blocks that ran on another CPU than the one before */
+} FIR_jitter_report_t;
+
+bool configure_realtime(const FIR_realtime_config_t *p_config);
+bool realtime_enabled(void);
+bool enter_realtime_thread(uint32_t p_thread_index);
+void leave_realtime_thread(void);
+void prefault_memory(void *p_ptr, size_t p_bytes);
+
+void read_realtime_stats(FIR_realtime_stats_t *p_stats);
+void print_realtime_stats(const FIR_realtime_stats_t *p_stats);
+
+bool measure_plan_jitter(FIR_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len,
+                         float32_t *p_output, FIR_jitter_report_t *p_report);
+
+#endif  /* REALTIME_H_ */
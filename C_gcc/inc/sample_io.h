@@ -0,0 +1,47 @@
+/**
+ * @file sample_io.h
+ * @brief Binary sample files carrying float32, fp16 or bf16 samples.
+ *
+ * A sample file is a 16 byte header followed by the raw samples in the
+ * host byte order:
+ *
+ * | Offset | Size | Field                          |
+ * |--------|------|--------------------------------|
+ * | 0      | 4    | magic "FIRS"                   |
+ * | 4      | 2    | format version (1)             |
+ * | 6      | 2    | sample type (FIR_sample_type_t)|
+ * | 8      | 8    | number of samples              |
+ */
+
+#ifndef SAMPLE_IO_H_
+#define SAMPLE_IO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "precision.h"
+
+#define SAMPLE_FILE_MAGIC    "FIRS"
+#define SAMPLE_FILE_VERSION  1U
+
+typedef enum {
+    FIR_FORMAT_SAMPLES = 0,  /* binary sample file, any sample type */
+    FIR_FORMAT_CSV           /* comma separated float32 text, as written by record_output */
+} FIR_file_format_t;
+
+typedef struct {
+    char     magic[4];
+    uint16_t version;
+    uint16_t sample_type;
+    uint64_t sample_count;
+} FIR_sample_header_t;
+
+bool write_sample_file(const char *p_filename, FIR_sample_type_t p_type, const void *p_samples, uint64_t p_sample_count);
+void *read_sample_file(const char *p_filename, FIR_sample_type_t *p_type, uint64_t *p_sample_count);
+bool load_signal_into(const char *p_filename, void **p_buffer, uint64_t *p_capacity, FIR_sample_type_t *p_type,
+                      uint64_t *p_sample_count, FIR_file_format_t *p_format);
+bool reserve_signal_buffer(void **p_buffer, uint64_t *p_capacity, uint64_t p_bytes);
+uint64_t signal_buffer_bound(const char *p_filename);
+bool check_sample_header(const FIR_sample_header_t *p_header, const char *p_filename);
+bool check_sample_count(const FIR_sample_header_t *p_header, uint64_t p_file_len, const char *p_filename);
+
+#endif  /* SAMPLE_IO_H_ */
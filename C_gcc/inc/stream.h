@@ -0,0 +1,57 @@
+/**
+ * @file stream.h
+ * @brief Out-of-core filtering of sample files larger than memory.
+ *
+ * The input sample file is filtered window by window: it is either mapped
+ * and walked with madvise() read-ahead and release hints, or read with
+ * pread() and posix_fadvise(). The output is written one window at a time
+ * and flushed behind the writer, so the resident set stays at a few windows
+ * whatever the file size.
+ *
+ * A stream reader gives the same input path to callers that consume a file
+ * in their own small steps, e.g. a pipeline source taking one block at a
+ * time: each read widens the next samples to float32, and the file is
+ * prefetched ahead of and released behind the reader STREAM_READER_CHUNK
+ * bytes at a time.
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "plan.h"
+#include "precision.h"
+
+#define STREAM_DEFAULT_WINDOW     (1U << 20)
+#define STREAM_DEFAULT_READAHEAD  2U
+#define STREAM_READER_CHUNK       (256U << 10)  /* bytes a reader prefetches and releases at a time */
+
+typedef struct FIR_stream_reader FIR_stream_reader_t;
+
+typedef struct {
+    uint32_t window_len;  /* samples filtered per window, 0 = STREAM_DEFAULT_WINDOW */
+    uint32_t readahead;   /* windows requested ahead of the one being filtered */
+    bool     use_mmap;    /* map the input; pread() is used if false or if mapping fails */
+} FIR_stream_config_t;
+
+typedef struct {
+    FIR_sample_type_t type;
+    uint64_t          samples;
+    uint64_t          windows;
+    bool              mapped;       /* input was memory-mapped */
+    double            wall_s;
+    uint64_t          peak_rss_kb;  /* peak resident set of the process */
+} FIR_stream_report_t;
+
+bool stream_filter_file(FIR_plan_t *p_plan, const char *p_input, const char *p_output,
+                        const FIR_stream_config_t *p_config, FIR_stream_report_t *p_report);
+void print_stream_report(const FIR_stream_report_t *p_report);
+
+FIR_stream_reader_t *open_stream_reader(const char *p_filename, uint32_t p_max_read, bool p_use_mmap);
+FIR_sample_type_t stream_reader_type(const FIR_stream_reader_t *p_reader);
+uint64_t stream_reader_samples(const FIR_stream_reader_t *p_reader);
+bool read_stream_samples(FIR_stream_reader_t *p_reader, float32_t *p_output, uint32_t p_len);
+void close_stream_reader(FIR_stream_reader_t *p_reader);
+
+#endif  /* STREAM_H_ */
@@ -0,0 +1,51 @@
+/**
+ * @file telemetry.h
+ * @brief Live counters and gauges for running filters, exported as Prometheus text.
+ *
+ * Each filter instance registers under a name and gets counters for samples,
+ * busy time, blocks and dropped blocks, and gauges for queue occupancy, the
+ * RMS of its latest output block and its selected kernel. Counters are kept
+ * in per-thread shards of relaxed atomics on their own cache lines, so the
+ * threads filtering never contend; each shard is exported as its own thread
+ * series. All functions taking an instance accept NULL and do nothing, so
+ * callers need not check whether telemetry is enabled.
+ *
+ * The exporter thread periodically rewrites a text file (for the node
+ * exporter textfile collector or a sidecar) and/or answers HTTP scrapes on
+ * a loopback TCP port, both in the Prometheus text exposition format.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define TELEMETRY_MAX_INSTANCES  32U
+#define TELEMETRY_SHARDS         16U  /* threads beyond this share shards */
+#define TELEMETRY_NAME_MAX       32U
+#define TELEMETRY_DEFAULT_PERIOD_MS  1000U
+
+typedef struct FIR_telemetry FIR_telemetry_t;
+
+typedef struct {
+    const char *file;       /* exposition file rewritten every period, or NULL */
+    uint16_t    port;       /* loopback TCP port answering scrapes, 0 for none */
+    uint32_t    period_ms;  /* file rewrite period, 0 = TELEMETRY_DEFAULT_PERIOD_MS */
+} FIR_telemetry_config_t;
+
+FIR_telemetry_t *register_telemetry(const char *p_name);
+
+uint64_t telemetry_now_ns(void);
+void telemetry_record_blocks(FIR_telemetry_t *p_telemetry, uint64_t p_blocks, uint64_t p_samples,
+                             uint64_t p_busy_ns, float p_output_rms);
+void telemetry_drop_blocks(FIR_telemetry_t *p_telemetry, uint64_t p_blocks);
+void telemetry_set_occupancy(FIR_telemetry_t *p_telemetry, uint64_t p_used, uint64_t p_capacity);
+void telemetry_set_kernel(FIR_telemetry_t *p_telemetry, const char *p_kernel);
+
+void write_telemetry(FILE *p_file);
+bool start_telemetry_exporter(const FIR_telemetry_config_t *p_config);
+void stop_telemetry_exporter(void);
+
+#endif  /* TELEMETRY_H_ */
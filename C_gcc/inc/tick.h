@@ -0,0 +1,80 @@
+/**
+ * @file tick.h
+ * @brief Sample-by-sample filtering for control loops: one sample in, one out.
+ *
+ * filter_signal() starts every call from zero history, and the block plans
+ * hold samples back until a block is full. A tick filter keeps its own delay
+ * line and returns the output of each sample as it is pushed, with the same
+ * fixed work for every sample: no allocation, no system call and no branch
+ * on the data, so its worst-case latency is bounded by its taps.
+ *
+ * The delay line has twice the filter length. Every sample is written at
+ * pos and at pos + P (P is the padded length), and pos steps down with
+ * wrap-around, so line[pos] .. line[pos+P-1] always holds the last P inputs,
+ * newest first, as one contiguous window: the dot product never wraps and
+ * needs no modulo arithmetic.
+ *
+ * Forms:
+ *
+ *     direct       y = sum h[k] * line[pos+k]
+ *     symmetric    the same with h[k] == h[N-1-k] folded, N/2 multiplies
+ *     transposed   y = h[0] * x + s[0], then s[k] = s[k+1] + h[k+1] * x;
+ *                  the output needs one multiply-add after the input
+ *                  arrives, the rest updates the state for the next one
+ *
+ * The dot products run over FIR_TILE lanes that are summed in a fixed order
+ * at the end, so the output is the same in every ISA clone but not
+ * bit-identical to filter_signal(), which sums one tap at a time.
+ *
+ * A latency histogram times every push and reports percentiles with a
+ * resolution of 1 ns below 64 ns and 1/32 of the value above.
+ */
+
+#ifndef TICK_H_
+#define TICK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filter.h"
+
+#define TICK_EXACT_NS       64U    /* latencies below this get a bucket each */
+#define TICK_SUB_BUCKETS    32U    /* buckets per power of two above TICK_EXACT_NS */
+#define TICK_BUCKETS        (TICK_EXACT_NS + 40U * TICK_SUB_BUCKETS)
+
+typedef enum {
+    FIR_TICK_DIRECT = 0,
+    FIR_TICK_SYMMETRIC,
+    FIR_TICK_TRANSPOSED,
+    FIR_TICK_FORM_COUNT
+} FIR_tick_form_t;
+
+typedef struct {
+    FIR_tick_form_t form;
+    uint32_t   coeff_len;
+    uint32_t   padded_len;  /* P: coeff_len rounded up to FIR_TILE */
+    uint32_t   folded_len;  /* symmetric form: coeff_len/2 rounded up to FIR_TILE */
+    float32_t *coeffs;      /* P taps, zero-padded; the first folded_len of them for the symmetric form */
+    float32_t *line;        /* 2P delay line (direct), two of them (symmetric) or P partial sums (transposed) */
+    uint32_t   pos;         /* newest sample at line[pos] and line[pos+P] */
+} FIR_tick_filter_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[TICK_BUCKETS];
+} FIR_latency_histogram_t;
+
+const char *tick_form_name(FIR_tick_form_t p_form);
+
+FIR_tick_filter_t *create_tick_filter(FIR_filter_t *p_filter, FIR_tick_form_t p_form);
+float32_t push_tick_sample(FIR_tick_filter_t *p_tick, float32_t p_sample);
+void reset_tick_filter(FIR_tick_filter_t *p_tick);
+void destroy_tick_filter(FIR_tick_filter_t *p_tick);
+
+void record_latency(FIR_latency_histogram_t *p_histogram, uint64_t p_ns);
+uint64_t latency_percentile(const FIR_latency_histogram_t *p_histogram, double p_percent);
+void measure_tick_latency(FIR_tick_filter_t *p_tick, const float32_t *p_input, uint64_t p_input_len,
+                          float32_t *p_output, FIR_latency_histogram_t *p_histogram);
+
+#endif  /* TICK_H_ */
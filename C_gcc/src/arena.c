@@ -0,0 +1,419 @@
+/**
+ * @file arena.c
+ * @brief Arena chunks carved into per-thread pools of 64-byte-aligned blocks.
+ */
+
+#define _GNU_SOURCE
+
+#include "arena.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define ARENA_MAGIC      0x46495241U  /* "FIRA" */
+#define ARENA_HUGE_PAGE  (2U << 20)
+#define ARENA_PAGE       4096U
+
+/* Header of every block, one alignment unit before the memory handed out */
+typedef struct arena_block {
+    uint32_t            magic;
+    uint32_t            size_class;
+    struct arena_block *next;  /* next free block of the class, while on a free list */
+} __attribute__((aligned(ARENA_ALIGNMENT))) arena_block_t;
+
+/*
+ * Counters are only written by the owning thread; they are relaxed atomics
+ * so read_arena_stats() can sum them from any thread.
+ */
+typedef struct arena_pool {
+    arena_block_t     *free[ARENA_CLASSES];
+    uint8_t           *cursor;  /* unused space of the current chunk */
+    uint8_t           *end;
+    _Atomic uint64_t   chunks;
+    _Atomic uint64_t   chunk_bytes;
+    _Atomic uint64_t   huge_chunks;
+    _Atomic uint64_t   allocs;
+    _Atomic uint64_t   frees;
+    _Atomic uint64_t   reused;
+    _Atomic uint64_t   carved;
+    _Atomic uint64_t   live_bytes;  /* wraps below zero on a pool that frees other pools' blocks */
+    struct arena_pool *next_pool;     /* every pool ever created */
+    struct arena_pool *next_retired;  /* pools of exited threads, waiting to be adopted */
+} __attribute__((aligned(ARENA_ALIGNMENT))) arena_pool_t;
+
+static FIR_arena_config_t g_config = { false, ARENA_CHUNK_SIZE };
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static arena_pool_t *g_pools = NULL;
+static arena_pool_t *g_retired = NULL;
+static uint64_t g_pool_count = 0;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_pool_key;
+
+static _Thread_local arena_pool_t *t_pool = NULL;
+
+
+/* ------------------------------------------------------------------------- */
+/* Size classes                                                              */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Sizes are counted in ARENA_ALIGNMENT units, header included. Classes 0-3
+ * are 1-4 units; above that each power of two is split into four classes,
+ * so a block wastes at most a quarter of its size.
+ */
+static uint32_t class_of(uint64_t p_units)
+{
+    if (p_units <= 4)
+        return (uint32_t)(p_units ? p_units - 1 : 0);
+
+    uint32_t e = 63U - (uint32_t)__builtin_clzll(p_units - 1);
+    uint64_t l_step_shift = e - 2;
+    uint64_t k = (p_units - (1ULL << e) + (1ULL << l_step_shift) - 1) >> l_step_shift;
+    return 4U + 4U * (e - 2U) + (uint32_t)k - 1U;
+}
+
+static uint64_t class_units(uint32_t p_class)
+{
+    if (p_class < 4)
+        return p_class + 1;
+
+    uint32_t e = (p_class - 4) / 4 + 2;
+    uint64_t k = (p_class - 4) % 4 + 1;
+    return (1ULL << e) + (k << (e - 2));
+}
+
+static inline void bump(_Atomic uint64_t *p_counter, uint64_t p_delta)
+{
+    atomic_store_explicit(p_counter, atomic_load_explicit(p_counter, memory_order_relaxed) + p_delta,
+                          memory_order_relaxed);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Chunks and pools                                                          */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Maps a chunk of at least p_size bytes from the system.
+ *
+ * With huge pages requested, MAP_HUGETLB is tried first; if no huge pages
+ * are reserved the chunk is mapped normally and transparent huge pages are
+ * requested for it instead.
+ *
+ * @param[out] p_mapped Bytes actually mapped.
+ * @param[out] p_huge Whether the chunk is backed by explicit huge pages.
+ */
+static uint8_t *map_chunk(size_t p_size, size_t *p_mapped, bool *p_huge)
+{
+    void *l_chunk = MAP_FAILED;
+    *p_huge = false;
+
+    if (g_config.huge_pages)
+    {
+        *p_mapped = (p_size + ARENA_HUGE_PAGE - 1) & ~(size_t)(ARENA_HUGE_PAGE - 1);
+        l_chunk = mmap(NULL, *p_mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        *p_huge = (l_chunk != MAP_FAILED);
+    }
+    if (l_chunk == MAP_FAILED)
+    {
+        *p_mapped = (p_size + ARENA_PAGE - 1) & ~(size_t)(ARENA_PAGE - 1);
+        l_chunk = mmap(NULL, *p_mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (l_chunk != MAP_FAILED && g_config.huge_pages)
+            madvise(l_chunk, *p_mapped, MADV_HUGEPAGE);
+    }
+
+    return (l_chunk == MAP_FAILED) ? NULL : l_chunk;
+}
+
+static uint8_t *pool_map_chunk(arena_pool_t *p_pool, size_t p_size, size_t *p_mapped)
+{
+    bool l_huge;
+    uint8_t *l_chunk = map_chunk(p_size, p_mapped, &l_huge);
+    if (l_chunk == NULL)
+        return NULL;
+
+    bump(&p_pool->chunks, 1);
+    bump(&p_pool->chunk_bytes, *p_mapped);
+    if (l_huge)
+        bump(&p_pool->huge_chunks, 1);
+    return l_chunk;
+}
+
+/**
+ * @brief Takes p_bytes of fresh space from the pool's chunk, mapping a new chunk if needed.
+ *
+ * Blocks larger than a quarter of a chunk get a chunk of their own, so the
+ * current chunk is not abandoned for them.
+ */
+static uint8_t *carve(arena_pool_t *p_pool, size_t p_bytes)
+{
+    size_t l_mapped;
+
+    if ((size_t)(p_pool->end - p_pool->cursor) >= p_bytes)
+    {
+        uint8_t *l_block = p_pool->cursor;
+        p_pool->cursor += p_bytes;
+        return l_block;
+    }
+    if (p_bytes > g_config.chunk_size / 4)
+        return pool_map_chunk(p_pool, p_bytes, &l_mapped);
+
+    uint8_t *l_chunk = pool_map_chunk(p_pool, g_config.chunk_size, &l_mapped);
+    if (l_chunk == NULL)
+        return NULL;
+    p_pool->cursor = l_chunk + p_bytes;
+    p_pool->end = l_chunk + l_mapped;
+    return l_chunk;
+}
+
+/* Thread exit: the pool waits, free lists and all, for the next new thread */
+static void retire_pool(void *p_pool)
+{
+    arena_pool_t *l_pool = p_pool;
+
+    pthread_mutex_lock(&g_pool_lock);
+    l_pool->next_retired = g_retired;
+    g_retired = l_pool;
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+static void create_pool_key(void)
+{
+    pthread_key_create(&g_pool_key, retire_pool);
+}
+
+static arena_pool_t *thread_pool(void)
+{
+    if (t_pool != NULL)
+        return t_pool;
+
+    pthread_once(&g_key_once, create_pool_key);
+    pthread_mutex_lock(&g_pool_lock);
+
+    arena_pool_t *l_pool = g_retired;
+    if (l_pool != NULL)
+    {
+        g_retired = l_pool->next_retired;
+    }
+    else
+    {
+        // The pool lives at the start of its first chunk
+        size_t l_mapped;
+        bool l_huge;
+        uint8_t *l_chunk = map_chunk(g_config.chunk_size, &l_mapped, &l_huge);
+        if (l_chunk != NULL)
+        {
+            l_pool = (arena_pool_t *)l_chunk;
+            memset(l_pool, 0, sizeof(arena_pool_t));
+            l_pool->cursor = l_chunk + sizeof(arena_pool_t);
+            l_pool->end = l_chunk + l_mapped;
+            bump(&l_pool->chunks, 1);
+            bump(&l_pool->chunk_bytes, l_mapped);
+            if (l_huge)
+                bump(&l_pool->huge_chunks, 1);
+            l_pool->next_pool = g_pools;
+            g_pools = l_pool;
+            g_pool_count++;
+        }
+    }
+
+    pthread_mutex_unlock(&g_pool_lock);
+
+    if (l_pool == NULL)
+    {
+        printf("Error. Not able to map an arena chunk of %u bytes.\n", g_config.chunk_size);
+        return NULL;
+    }
+    pthread_setspecific(g_pool_key, l_pool);
+    t_pool = l_pool;
+    return l_pool;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Allocation                                                                */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Sets the chunk size and huge page backing of the arena.
+ *
+ * @return false if a pool already exists, since chunks already mapped
+ *         cannot change; call it before the first allocation.
+ */
+bool configure_arena(const FIR_arena_config_t *p_config)
+{
+    bool l_ok;
+
+    pthread_mutex_lock(&g_pool_lock);
+    l_ok = (g_pools == NULL);
+    if (l_ok)
+    {
+        g_config = *p_config;
+        if (g_config.chunk_size == 0)
+            g_config.chunk_size = ARENA_CHUNK_SIZE;
+        if (g_config.chunk_size < 4 * sizeof(arena_pool_t))
+            g_config.chunk_size = 4 * sizeof(arena_pool_t);
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    if (!l_ok)
+        printf("Error. The arena must be configured before its first allocation.\n");
+    return l_ok;
+}
+
+/**
+ * @brief Allocates p_size bytes aligned to ARENA_ALIGNMENT from the calling thread's pool.
+ *
+ * @return The block, or NULL on failure. Release it with arena_free().
+ */
+void *arena_alloc(size_t p_size)
+{
+    uint64_t l_units = (p_size + sizeof(arena_block_t) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT;
+    if (p_size > SIZE_MAX / 2 || l_units > class_units(ARENA_CLASSES - 1))
+    {
+        printf("Error. %zu bytes is larger than the largest arena block.\n", p_size);
+        return NULL;
+    }
+
+    arena_pool_t *l_pool = thread_pool();
+    if (l_pool == NULL)
+        return NULL;
+
+    uint32_t l_class = class_of(l_units);
+    size_t l_bytes = class_units(l_class) * ARENA_ALIGNMENT;
+    arena_block_t *l_block = l_pool->free[l_class];
+
+    if (l_block != NULL)
+    {
+        l_pool->free[l_class] = l_block->next;
+        bump(&l_pool->reused, 1);
+    }
+    else
+    {
+        l_block = (arena_block_t *)carve(l_pool, l_bytes);
+        if (l_block == NULL)
+        {
+            printf("Error. Not able to map arena space for %zu bytes.\n", p_size);
+            return NULL;
+        }
+        bump(&l_pool->carved, 1);
+    }
+
+    l_block->magic = ARENA_MAGIC;
+    l_block->size_class = l_class;
+    l_block->next = NULL;
+    bump(&l_pool->allocs, 1);
+    bump(&l_pool->live_bytes, l_bytes);
+    return l_block + 1;
+}
+
+/**
+ * @brief As arena_alloc(), for p_count zeroed elements of p_size bytes.
+ */
+void *arena_calloc(size_t p_count, size_t p_size)
+{
+    if (p_size != 0 && p_count > SIZE_MAX / p_size)
+    {
+        printf("Error. %zu elements of %zu bytes overflow an arena block.\n", p_count, p_size);
+        return NULL;
+    }
+
+    void *l_ptr = arena_alloc(p_count * p_size);
+    if (l_ptr != NULL)
+        memset(l_ptr, 0, p_count * p_size);
+    return l_ptr;
+}
+
+/**
+ * @brief Resizes a block, moving it only if its size class no longer fits.
+ *
+ * @return The block, or NULL on failure with p_ptr left allocated.
+ */
+void *arena_realloc(void *p_ptr, size_t p_size)
+{
+    if (p_ptr == NULL)
+        return arena_alloc(p_size);
+
+    arena_block_t *l_block = (arena_block_t *)p_ptr - 1;
+    size_t l_capacity = class_units(l_block->size_class) * ARENA_ALIGNMENT - sizeof(arena_block_t);
+    if (p_size <= l_capacity)
+        return p_ptr;
+
+    void *l_ptr = arena_alloc(p_size);
+    if (l_ptr == NULL)
+        return NULL;
+    memcpy(l_ptr, p_ptr, l_capacity);
+    arena_free(p_ptr);
+    return l_ptr;
+}
+
+/**
+ * @brief Returns a block to the calling thread's pool. Accepts NULL.
+ *
+ * A block may be freed by any thread; it then joins that thread's pool.
+ */
+void arena_free(void *p_ptr)
+{
+    if (p_ptr == NULL)
+        return;
+
+    arena_block_t *l_block = (arena_block_t *)p_ptr - 1;
+    if (l_block->magic != ARENA_MAGIC || l_block->size_class >= ARENA_CLASSES)
+    {
+        printf("Error. %p was not allocated by the arena, or was freed twice.\n", p_ptr);
+        return;
+    }
+
+    arena_pool_t *l_pool = thread_pool();
+    if (l_pool == NULL)
+        return;
+
+    uint32_t l_class = l_block->size_class;
+    l_block->magic = 0;
+    l_block->next = l_pool->free[l_class];
+    l_pool->free[l_class] = l_block;
+    bump(&l_pool->frees, 1);
+    bump(&l_pool->live_bytes, 0 - class_units(l_class) * ARENA_ALIGNMENT);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Counters                                                                  */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Sums the counters of every pool, live or retired.
+ */
+void read_arena_stats(FIR_arena_stats_t *p_stats)
+{
+    memset(p_stats, 0, sizeof(FIR_arena_stats_t));
+
+    pthread_mutex_lock(&g_pool_lock);
+    for (arena_pool_t *l_pool = g_pools; l_pool != NULL; l_pool = l_pool->next_pool)
+    {
+        p_stats->chunks += atomic_load_explicit(&l_pool->chunks, memory_order_relaxed);
+        p_stats->chunk_bytes += atomic_load_explicit(&l_pool->chunk_bytes, memory_order_relaxed);
+        p_stats->huge_chunks += atomic_load_explicit(&l_pool->huge_chunks, memory_order_relaxed);
+        p_stats->allocs += atomic_load_explicit(&l_pool->allocs, memory_order_relaxed);
+        p_stats->frees += atomic_load_explicit(&l_pool->frees, memory_order_relaxed);
+        p_stats->reused += atomic_load_explicit(&l_pool->reused, memory_order_relaxed);
+        p_stats->carved += atomic_load_explicit(&l_pool->carved, memory_order_relaxed);
+        p_stats->live_bytes += atomic_load_explicit(&l_pool->live_bytes, memory_order_relaxed);
+    }
+    p_stats->pools = g_pool_count;
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+/**
+ * @brief Prints arena counters as one table row, typically the difference between two reads.
+ */
+void print_arena_stats(const char *p_label, const FIR_arena_stats_t *p_stats)
+{
+    printf("| %-14s | %6llu | %10.1f | %4llu | %9llu | %9llu | %7llu | %9llu | %10.1f |\n", p_label,
+           (unsigned long long)p_stats->chunks, (double)p_stats->chunk_bytes / (1024.0 * 1024.0),
+           (unsigned long long)p_stats->huge_chunks, (unsigned long long)p_stats->allocs,
+           (unsigned long long)p_stats->reused, (unsigned long long)p_stats->carved,
+           (unsigned long long)p_stats->frees, (double)(int64_t)p_stats->live_bytes / 1024.0);
+}
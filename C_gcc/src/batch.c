@@ -0,0 +1,558 @@
+/**
+ * @file batch.c
+ * @brief Manifest parsing and the work-stealing batch runner.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+#include "telemetry.h"
+#include "precision.h"
+#include "sample_io.h"
+#include "arena.h"
+#include "realtime.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Each worker owns a deque of job indices, dealt largest job first. The
+ * owner takes jobs from the head; idle workers steal from the tail of
+ * other deques, so the owner keeps working through its long jobs while
+ * thieves pick off the short ones at the other end.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t       *slots;
+    uint32_t        head;
+    uint32_t        tail;
+} job_deque_t;
+
+typedef struct batch_pool batch_pool_t;
+
+typedef struct {
+    batch_pool_t *pool;
+    uint32_t      id;
+    pthread_t     thread;
+    FIR_plan_t  **plans;     /* one per bank entry, created on first use and reused */
+    void         *buffer;    /* signal buffer, grown to the largest job seen */
+    uint64_t      capacity;
+    uint64_t      steals;
+} batch_worker_t;
+
+struct batch_pool {
+    FIR_batch_t              *batch;
+    const FIR_bank_entry_t   *bank;
+    uint32_t                  bank_len;
+    const FIR_batch_config_t *config;
+    job_deque_t              *deques;
+    batch_worker_t           *workers;
+    uint32_t                  worker_count;
+    bool                     *filter_used;  /* per bank entry: some job of the batch uses it */
+    pthread_mutex_t           gate_lock;    /* workers wait until all of them have reserved their state */
+    pthread_cond_t            gate;
+    uint32_t                  reserved;     /* workers past reserve_worker_state() */
+    uint32_t                  started;      /* worker threads created, UINT32_MAX until known */
+    uint64_t                  buffer_bytes; /* largest signal buffer a job of the batch can need */
+    _Atomic uint32_t          jobs_queued;  /* jobs not yet picked up, for telemetry */
+    FIR_telemetry_t          *telemetry;    /* "batch": queue occupancy and failed jobs */
+};
+
+/* Planning touches global wisdom, so plan creation is serialised */
+static pthread_mutex_t g_planner_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* ------------------------------------------------------------------------- */
+/* Manifest                                                                  */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Reads a batch manifest and resolves its filter names against the bank.
+ *
+ * @param[in] p_filename Path of the manifest.
+ * @param[in] p_bank Filters that jobs may refer to by name.
+ * @param[in] p_bank_len Number of entries in p_bank.
+ * @param[out] p_batch Filled with the parsed jobs; release with free_batch().
+ *
+ * @return true on success, false if the manifest could not be read or names
+ *         an unknown filter.
+ */
+bool load_batch_manifest(const char *p_filename, const FIR_bank_entry_t *p_bank, uint32_t p_bank_len,
+                         FIR_batch_t *p_batch)
+{
+    FILE *l_file = fopen(p_filename, "r");
+
+    p_batch->jobs = NULL;
+    p_batch->job_count = 0;
+
+    if (l_file == NULL)
+    {
+        printf("Error. Not able to open file %s for reading.\n", p_filename);
+        return false;
+    }
+
+    uint32_t l_capacity = 0;
+    uint32_t l_line_no = 0;
+    char l_line[3 * BATCH_PATH_MAX];
+    bool l_ok = true;
+
+    while (l_ok && fgets(l_line, sizeof(l_line), l_file) != NULL)
+    {
+        char l_input[BATCH_PATH_MAX], l_name[64], l_output[BATCH_PATH_MAX];
+        l_line_no++;
+
+        char *l_start = l_line + strspn(l_line, " \t");
+        if (*l_start == '#' || *l_start == '\n' || *l_start == '\0')
+            continue;
+
+        if (sscanf(l_start, "%511s %63s %511s", l_input, l_name, l_output) != 3)
+        {
+            printf("Error. %s:%u: expected '<input> <filter> <output>'.\n", p_filename, l_line_no);
+            l_ok = false;
+            break;
+        }
+
+        uint32_t l_index = p_bank_len;
+        for (uint32_t i = 0; i < p_bank_len; i++)
+        {
+            if (strcmp(p_bank[i].name, l_name) == 0)
+                l_index = i;
+        }
+        if (l_index == p_bank_len)
+        {
+            printf("Error. %s:%u: unknown filter '%s'.\n", p_filename, l_line_no, l_name);
+            l_ok = false;
+            break;
+        }
+
+        if (p_batch->job_count == l_capacity)
+        {
+            l_capacity = l_capacity ? 2 * l_capacity : 64;
+            FIR_batch_job_t *l_jobs = arena_realloc(p_batch->jobs, l_capacity * sizeof(FIR_batch_job_t));
+            if (l_jobs == NULL)
+            {
+                l_ok = false;
+                break;
+            }
+            p_batch->jobs = l_jobs;
+        }
+
+        FIR_batch_job_t *l_job = &p_batch->jobs[p_batch->job_count++];
+        memset(l_job, 0, sizeof(*l_job));
+        strcpy(l_job->input, l_input);
+        strcpy(l_job->output, l_output);
+        l_job->filter_index = l_index;
+
+        struct stat l_stat;
+        uint64_t l_bytes = (stat(l_input, &l_stat) == 0) ? (uint64_t)l_stat.st_size : 0;
+        l_job->cost = l_bytes * p_bank[l_index].filter->coeff_b_len;
+        l_job->buffer_bytes = signal_buffer_bound(l_input);
+    }
+
+    fclose(l_file);
+    if (!l_ok)
+        free_batch(p_batch);
+    return l_ok;
+}
+
+/**
+ * @brief Releases the jobs of a batch.
+ */
+void free_batch(FIR_batch_t *p_batch)
+{
+    arena_free(p_batch->jobs);
+    p_batch->jobs = NULL;
+    p_batch->job_count = 0;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Workers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static bool take_own_job(batch_worker_t *p_worker, uint32_t *p_job)
+{
+    job_deque_t *l_deque = &p_worker->pool->deques[p_worker->id];
+    bool l_found = false;
+
+    pthread_mutex_lock(&l_deque->lock);
+    if (l_deque->head < l_deque->tail)
+    {
+        *p_job = l_deque->slots[l_deque->head++];
+        l_found = true;
+    }
+    pthread_mutex_unlock(&l_deque->lock);
+
+    return l_found;
+}
+
+static bool steal_job(batch_worker_t *p_worker, uint32_t *p_job)
+{
+    batch_pool_t *l_pool = p_worker->pool;
+
+    for (uint32_t i = 1; i < l_pool->worker_count; i++)
+    {
+        job_deque_t *l_victim = &l_pool->deques[(p_worker->id + i) % l_pool->worker_count];
+        bool l_found = false;
+
+        pthread_mutex_lock(&l_victim->lock);
+        if (l_victim->head < l_victim->tail)
+        {
+            *p_job = l_victim->slots[--l_victim->tail];
+            l_found = true;
+        }
+        pthread_mutex_unlock(&l_victim->lock);
+
+        if (l_found)
+        {
+            p_worker->steals++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static FIR_plan_t *worker_plan(batch_worker_t *p_worker, uint32_t p_filter_index)
+{
+    batch_pool_t *l_pool = p_worker->pool;
+    FIR_plan_t *l_plan = p_worker->plans[p_filter_index];
+
+    if (l_plan == NULL)
+    {
+        pthread_mutex_lock(&g_planner_lock);
+        l_plan = create_filter_plan(l_pool->bank[p_filter_index].filter, l_pool->config->block_len,
+                                    l_pool->config->plan_mode);
+        pthread_mutex_unlock(&g_planner_lock);
+        p_worker->plans[p_filter_index] = l_plan;
+        if (l_plan != NULL)
+            attach_plan_telemetry(l_plan, register_telemetry(l_pool->bank[p_filter_index].name));
+    }
+    else
+    {
+        reset_filter_plan(l_plan);
+    }
+
+    return l_plan;
+}
+
+/**
+ * @brief Loads, filters (in place, in the stored sample type) and writes one job.
+ */
+static void run_job(batch_worker_t *p_worker, FIR_batch_job_t *p_job)
+{
+    uint64_t l_start = telemetry_now_ns();
+    FIR_sample_type_t l_type;
+    FIR_file_format_t l_format;
+    uint64_t l_count = 0;
+
+    p_job->ok = false;
+
+    if (!load_signal_into(p_job->input, &p_worker->buffer, &p_worker->capacity, &l_type, &l_count, &l_format))
+        return;
+
+    FIR_plan_t *l_plan = worker_plan(p_worker, p_job->filter_index);
+    if (l_plan == NULL)
+        return;
+
+    uint8_t *l_samples = p_worker->buffer;
+
+    if (l_type == FIR_SAMPLE_F32)
+        execute_filter_plan(l_plan, (float32_t *)l_samples, l_count, (float32_t *)l_samples);
+    else
+        execute_filter_plan_narrow(l_plan, l_type, l_samples, l_count, l_samples);
+
+    if (l_format == FIR_FORMAT_CSV)
+        p_job->ok = record_output64(p_worker->buffer, l_count, p_job->output);
+    else
+        p_job->ok = write_sample_file(p_job->output, l_type, p_worker->buffer, l_count);
+
+    p_job->sample_count = l_count;
+    p_job->latency_ns = telemetry_now_ns() - l_start;
+}
+
+/*
+ * Creates the plans of every filter the batch uses and sizes the buffer for
+ * its largest input before the first job, then waits for the other
+ * workers to do the same. What a worker allocates then does not depend on
+ * which jobs it ends up running, and every worker holds a pool of its own
+ * even if another has no jobs left by the time it starts, so every batch
+ * retires the same pools with the same blocks, and whichever pool a worker
+ * of the next batch adopts, it reuses them all and carves nothing.
+ */
+static void reserve_worker_state(batch_worker_t *p_worker)
+{
+    batch_pool_t *l_pool = p_worker->pool;
+
+    for (uint32_t f = 0; f < l_pool->bank_len; f++)
+    {
+        if (l_pool->filter_used[f])
+            worker_plan(p_worker, f);
+    }
+    reserve_signal_buffer(&p_worker->buffer, &p_worker->capacity, l_pool->buffer_bytes);
+
+    // No worker exits, retiring its pool for a later one of this batch to adopt, before all hold a pool
+    pthread_mutex_lock(&l_pool->gate_lock);
+    l_pool->reserved++;
+    pthread_cond_broadcast(&l_pool->gate);
+    while (l_pool->reserved < l_pool->started)
+        pthread_cond_wait(&l_pool->gate, &l_pool->gate_lock);
+    pthread_mutex_unlock(&l_pool->gate_lock);
+}
+
+/*
+ * Plans and the buffer were allocated on the worker's thread, so they are
+ * freed there too: the blocks go back to the worker's own arena pool, which
+ * the next batch's workers adopt, instead of to the thread that joins it.
+ */
+static void release_worker_state(batch_worker_t *p_worker)
+{
+    for (uint32_t f = 0; f < p_worker->pool->bank_len; f++)
+    {
+        destroy_filter_plan(p_worker->plans[f]);
+        p_worker->plans[f] = NULL;
+    }
+    arena_free(p_worker->buffer);
+    p_worker->buffer = NULL;
+    p_worker->capacity = 0;
+}
+
+static void *worker_main(void *p_arg)
+{
+    batch_worker_t *l_worker = p_arg;
+    FIR_batch_t *l_batch = l_worker->pool->batch;
+    uint32_t l_job;
+
+    enter_realtime_thread(l_worker->id);
+    reserve_worker_state(l_worker);
+    while (take_own_job(l_worker, &l_job) || steal_job(l_worker, &l_job))
+    {
+        batch_pool_t *l_pool = l_worker->pool;
+        uint32_t l_queued = atomic_fetch_sub_explicit(&l_pool->jobs_queued, 1, memory_order_relaxed) - 1;
+        telemetry_set_occupancy(l_pool->telemetry, l_queued, l_batch->job_count);
+
+        run_job(l_worker, &l_batch->jobs[l_job]);
+        if (!l_batch->jobs[l_job].ok)
+            telemetry_drop_blocks(l_pool->telemetry, 1);
+    }
+
+    release_worker_state(l_worker);
+    return NULL;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Pool                                                                      */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    uint64_t cost;
+    uint32_t job;
+} job_order_t;
+
+static int compare_job_cost(const void *p_a, const void *p_b)
+{
+    uint64_t l_a = ((const job_order_t *)p_a)->cost;
+    uint64_t l_b = ((const job_order_t *)p_b)->cost;
+    return (l_a < l_b) - (l_a > l_b);
+}
+
+static int compare_u64(const void *p_a, const void *p_b)
+{
+    uint64_t l_a = *(const uint64_t *)p_a;
+    uint64_t l_b = *(const uint64_t *)p_b;
+    return (l_a > l_b) - (l_a < l_b);
+}
+
+static void summarise_batch(const FIR_batch_t *p_batch, FIR_batch_report_t *p_report)
+{
+    uint64_t *l_latencies = arena_alloc((p_batch->job_count + 1) * sizeof(uint64_t));
+    uint32_t l_count = 0;
+
+    for (uint32_t i = 0; i < p_batch->job_count; i++)
+    {
+        const FIR_batch_job_t *l_job = &p_batch->jobs[i];
+        if (!l_job->ok)
+        {
+            p_report->jobs_failed++;
+            continue;
+        }
+        p_report->jobs_ok++;
+        p_report->samples += l_job->sample_count;
+        if (l_latencies != NULL)
+            l_latencies[l_count++] = l_job->latency_ns;
+    }
+
+    if (l_latencies != NULL && l_count > 0)
+    {
+        qsort(l_latencies, l_count, sizeof(uint64_t), compare_u64);
+        // Nearest-rank percentiles
+        p_report->latency_p50_ns = l_latencies[(l_count * 50 + 99) / 100 - 1];
+        p_report->latency_p99_ns = l_latencies[(l_count * 99 + 99) / 100 - 1];
+        p_report->latency_max_ns = l_latencies[l_count - 1];
+    }
+
+    arena_free(l_latencies);
+}
+
+/**
+ * @brief Runs every job of a batch on a work-stealing thread pool.
+ *
+ * Jobs are sorted by estimated cost and dealt round-robin, so each worker
+ * starts on its longest jobs; workers that run dry steal from the others.
+ * Each worker creates one plan per filter the batch uses and one signal
+ * buffer for its largest input when it starts, and keeps them for the whole
+ * run, so no job allocates, and a batch run again only reuses arena blocks.
+ *
+ * @param[in,out] p_batch Jobs to run; their results and latencies are filled in.
+ * @param[in] p_bank Filters referred to by the jobs.
+ * @param[in] p_bank_len Number of entries in p_bank.
+ * @param[in] p_config Thread count, block length and planning mode.
+ * @param[out] p_report Throughput and latency summary.
+ *
+ * @return true if every job succeeded.
+ */
+bool run_batch(FIR_batch_t *p_batch, const FIR_bank_entry_t *p_bank, uint32_t p_bank_len,
+               const FIR_batch_config_t *p_config, FIR_batch_report_t *p_report)
+{
+    batch_pool_t l_pool = { .batch = p_batch, .bank = p_bank, .bank_len = p_bank_len, .config = p_config,
+                            .gate_lock = PTHREAD_MUTEX_INITIALIZER, .gate = PTHREAD_COND_INITIALIZER,
+                            .started = UINT32_MAX };
+    uint32_t W = p_config->thread_count;
+
+    memset(p_report, 0, sizeof(*p_report));
+
+    if (W == 0)
+    {
+        long l_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        W = (l_cpus > 0) ? (uint32_t)l_cpus : 1U;
+    }
+    if (W > p_batch->job_count && p_batch->job_count > 0)
+        W = p_batch->job_count;
+    if (W == 0)
+        W = 1;
+
+    l_pool.worker_count = W;
+    atomic_init(&l_pool.jobs_queued, p_batch->job_count);
+    l_pool.telemetry = register_telemetry("batch");
+    telemetry_set_occupancy(l_pool.telemetry, p_batch->job_count, p_batch->job_count);
+    l_pool.deques = arena_calloc(W, sizeof(job_deque_t));
+    l_pool.workers = arena_calloc(W, sizeof(batch_worker_t));
+    l_pool.filter_used = arena_calloc(p_bank_len + 1, sizeof(bool));
+    job_order_t *l_order = arena_alloc((p_batch->job_count + 1) * sizeof(job_order_t));
+
+    if (l_pool.deques == NULL || l_pool.workers == NULL || l_pool.filter_used == NULL || l_order == NULL)
+    {
+        printf("Error. Not able to allocate the batch thread pool.\n");
+        arena_free(l_pool.deques);
+        arena_free(l_pool.workers);
+        arena_free(l_pool.filter_used);
+        arena_free(l_order);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < p_batch->job_count; i++)
+    {
+        l_pool.filter_used[p_batch->jobs[i].filter_index] = true;
+        if (p_batch->jobs[i].buffer_bytes > l_pool.buffer_bytes)
+            l_pool.buffer_bytes = p_batch->jobs[i].buffer_bytes;
+    }
+
+    // Deal the jobs largest first, round-robin over the workers
+    for (uint32_t i = 0; i < p_batch->job_count; i++)
+    {
+        l_order[i].cost = p_batch->jobs[i].cost;
+        l_order[i].job = i;
+    }
+    qsort(l_order, p_batch->job_count, sizeof(job_order_t), compare_job_cost);
+
+    bool l_ready = true;
+    for (uint32_t w = 0; w < W; w++)
+    {
+        job_deque_t *l_deque = &l_pool.deques[w];
+        pthread_mutex_init(&l_deque->lock, NULL);
+        l_deque->slots = arena_alloc((p_batch->job_count / W + 1) * sizeof(uint32_t));
+
+        batch_worker_t *l_worker = &l_pool.workers[w];
+        l_worker->pool = &l_pool;
+        l_worker->id = w;
+        l_worker->plans = arena_calloc(p_bank_len + 1, sizeof(FIR_plan_t *));
+
+        if (l_deque->slots == NULL || l_worker->plans == NULL)
+        {
+            l_ready = false;
+            continue;
+        }
+        for (uint32_t i = w; i < p_batch->job_count; i += W)
+            l_deque->slots[l_deque->tail++] = l_order[i].job;
+    }
+
+    if (!l_ready)
+    {
+        printf("Error. Not able to allocate the batch thread pool.\n");
+        for (uint32_t w = 0; w < W; w++)
+            l_pool.deques[w].head = l_pool.deques[w].tail;
+        W = 0;
+    }
+
+    uint64_t l_start = telemetry_now_ns();
+    uint32_t l_started = 0;
+    for (uint32_t w = 0; w < W; w++)
+    {
+        if (pthread_create(&l_pool.workers[w].thread, NULL, worker_main, &l_pool.workers[w]) != 0)
+            break;
+        l_started++;
+    }
+    pthread_mutex_lock(&l_pool.gate_lock);
+    l_pool.started = l_started;
+    pthread_cond_broadcast(&l_pool.gate);
+    pthread_mutex_unlock(&l_pool.gate_lock);
+    if (l_started == 0 && W > 0)
+        worker_main(&l_pool.workers[0]);   // no threads available: run inline
+    for (uint32_t w = 0; w < l_started; w++)
+        pthread_join(l_pool.workers[w].thread, NULL);
+    p_report->wall_s = (double)(telemetry_now_ns() - l_start) * 1e-9;
+
+    for (uint32_t w = 0; w < l_pool.worker_count; w++)
+    {
+        batch_worker_t *l_worker = &l_pool.workers[w];
+        p_report->steals += l_worker->steals;
+        arena_free(l_worker->plans);
+        arena_free(l_pool.deques[w].slots);
+        pthread_mutex_destroy(&l_pool.deques[w].lock);
+    }
+
+    p_report->thread_count = l_pool.worker_count;
+    summarise_batch(p_batch, p_report);
+
+    arena_free(l_pool.deques);
+    arena_free(l_pool.workers);
+    arena_free(l_pool.filter_used);
+    arena_free(l_order);
+    pthread_cond_destroy(&l_pool.gate);
+    pthread_mutex_destroy(&l_pool.gate_lock);
+    return p_report->jobs_failed == 0;
+}
+
+/**
+ * @brief Prints the throughput and job latency summary of a batch run.
+ */
+void print_batch_report(const FIR_batch_report_t *p_report)
+{
+    double l_wall = (p_report->wall_s > 0.0) ? p_report->wall_s : 1e-9;
+
+    printf("Batch Summary:\n");
+    printf("Threads: %u\n", p_report->thread_count);
+    printf("Jobs: %u ok, %u failed\n", p_report->jobs_ok, p_report->jobs_failed);
+    printf("Steals: %llu\n", (unsigned long long)p_report->steals);
+    printf("Wall time: %.3f s\n", p_report->wall_s);
+    printf("Throughput: %.2f Msamples/s, %.1f jobs/s\n", (double)p_report->samples / l_wall * 1e-6,
+           (double)p_report->jobs_ok / l_wall);
+    printf("Job latency p50: %.3f ms\n", (double)p_report->latency_p50_ns * 1e-6);
+    printf("Job latency p99: %.3f ms\n", (double)p_report->latency_p99_ns * 1e-6);
+    printf("Job latency max: %.3f ms\n", (double)p_report->latency_max_ns * 1e-6);
+}
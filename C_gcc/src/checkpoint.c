@@ -0,0 +1,715 @@
+/**
+ * @file checkpoint.c
+ * @brief Checkpoint capture, the background writer and restore from a mapped file.
+ */
+
+#include "checkpoint.h"
+#include "arena.h"
+#include "telemetry.h"
+#include "hash.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECKPOINT_PATH_MAX    512U
+#define CHECKPOINT_KERNEL_MAX  16U
+
+typedef enum {
+    CHECKPOINT_PLAN = 1,
+    CHECKPOINT_STATS = 2
+} checkpoint_kind_t;
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t sequence;
+    uint64_t position;
+    uint32_t records;
+    uint32_t reserved;
+    uint64_t payload_bytes;
+    uint64_t checksum;
+} checkpoint_header_t;
+
+typedef struct {
+    char     name[CHECKPOINT_NAME_MAX];
+    uint32_t kind;
+    uint32_t payload_bytes;
+} record_header_t;
+
+/* Followed by coeff_len - 1 history samples, padded to 8 bytes */
+typedef struct {
+    uint32_t coeff_len;
+    uint32_t block_len;
+    char     kernel[CHECKPOINT_KERNEL_MAX];
+    uint32_t levels;
+    uint32_t factors[FFA_MAX_LEVELS];
+    uint64_t coeff_hash;
+} plan_record_t;
+
+typedef struct {
+    uint64_t  count;
+    double    sum;
+    double    sum_sq;
+    float32_t min;
+    float32_t max;
+} stats_record_t;
+
+typedef struct {
+    char                  name[CHECKPOINT_NAME_MAX];
+    checkpoint_kind_t     kind;
+    FIR_plan_t           *plan;
+    uint64_t              coeff_hash;  /* of the plan's coefficients, hashed once when tracked */
+    FIR_pipeline_stats_t *stats;
+} checkpoint_entry_t;
+
+typedef enum {
+    SNAPSHOT_FREE = 0,
+    SNAPSHOT_FILLING,
+    SNAPSHOT_PENDING,
+    SNAPSHOT_WRITING
+} snapshot_state_t;
+
+typedef struct {
+    uint8_t         *bytes;
+    snapshot_state_t state;
+} snapshot_t;
+
+struct FIR_checkpoint {
+    char                path[CHECKPOINT_PATH_MAX];
+    checkpoint_entry_t *entries;
+    uint32_t            entry_count;
+    uint64_t            bytes;
+    uint64_t            sequence;
+    /* Two snapshots: the writer holds at most one, so a capture always finds the other */
+    snapshot_t          snapshots[2];
+    pthread_mutex_t     lock;
+    pthread_cond_t      wake;    /* a snapshot is pending, or stop */
+    pthread_cond_t      idle;    /* the writer finished a snapshot */
+    pthread_t           writer;
+    bool                writer_started;
+    bool                stop;
+    FIR_checkpoint_report_t report;
+};
+
+static uint32_t plan_payload_bytes(const FIR_plan_t *p_plan)
+{
+    uint32_t l_history = (p_plan->coeff_len - 1) * (uint32_t)sizeof(float32_t);
+    return (uint32_t)sizeof(plan_record_t) + ((l_history + 7U) & ~7U);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Registration                                                              */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Creates an empty checkpoint that will be saved to p_filename.
+ *
+ * @return The checkpoint, or NULL if the path is too long or memory is short.
+ */
+FIR_checkpoint_t *create_checkpoint(const char *p_filename)
+{
+    if (strlen(p_filename) + 5 > CHECKPOINT_PATH_MAX)
+    {
+        printf("Error. The checkpoint path %s is too long.\n", p_filename);
+        return NULL;
+    }
+
+    FIR_checkpoint_t *l_checkpoint = arena_calloc(1, sizeof(FIR_checkpoint_t));
+    if (l_checkpoint == NULL)
+        return NULL;
+
+    l_checkpoint->entries = arena_calloc(CHECKPOINT_MAX_ENTRIES, sizeof(checkpoint_entry_t));
+    if (l_checkpoint->entries == NULL)
+    {
+        printf("Error. Not able to allocate a checkpoint of %u entries.\n", CHECKPOINT_MAX_ENTRIES);
+        arena_free(l_checkpoint);
+        return NULL;
+    }
+
+    snprintf(l_checkpoint->path, sizeof(l_checkpoint->path), "%s", p_filename);
+    l_checkpoint->bytes = sizeof(checkpoint_header_t);
+    pthread_mutex_init(&l_checkpoint->lock, NULL);
+    pthread_cond_init(&l_checkpoint->wake, NULL);
+    pthread_cond_init(&l_checkpoint->idle, NULL);
+    return l_checkpoint;
+}
+
+static checkpoint_entry_t *add_entry(FIR_checkpoint_t *p_checkpoint, const char *p_name, checkpoint_kind_t p_kind)
+{
+    if (p_checkpoint->snapshots[0].bytes != NULL)
+    {
+        printf("Error. Entries must be added to a checkpoint before its first capture.\n");
+        return NULL;
+    }
+    if (p_checkpoint->entry_count == CHECKPOINT_MAX_ENTRIES || strlen(p_name) >= CHECKPOINT_NAME_MAX)
+    {
+        printf("Error. A checkpoint holds up to %u entries with names of up to %u characters.\n",
+               CHECKPOINT_MAX_ENTRIES, CHECKPOINT_NAME_MAX - 1);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < p_checkpoint->entry_count; i++)
+    {
+        if (p_checkpoint->entries[i].kind == p_kind && strcmp(p_checkpoint->entries[i].name, p_name) == 0)
+        {
+            printf("Error. The checkpoint already has an entry named %s.\n", p_name);
+            return NULL;
+        }
+    }
+
+    checkpoint_entry_t *l_entry = &p_checkpoint->entries[p_checkpoint->entry_count++];
+    snprintf(l_entry->name, sizeof(l_entry->name), "%s", p_name);
+    l_entry->kind = p_kind;
+    return l_entry;
+}
+
+/**
+ * @brief Adds a plan whose history and kernel choice are saved under p_name.
+ *
+ * @return false if the name is taken or too long, or the checkpoint is full.
+ */
+bool checkpoint_track_plan(FIR_checkpoint_t *p_checkpoint, const char *p_name, FIR_plan_t *p_plan)
+{
+    checkpoint_entry_t *l_entry = add_entry(p_checkpoint, p_name, CHECKPOINT_PLAN);
+    if (l_entry == NULL)
+        return false;
+
+    l_entry->plan = p_plan;
+    l_entry->coeff_hash = fnv1a(p_plan->coeffs, (uint64_t)p_plan->coeff_len * sizeof(float32_t));
+    p_checkpoint->bytes += sizeof(record_header_t) + plan_payload_bytes(p_plan);
+    return true;
+}
+
+/**
+ * @brief Adds a statistics accumulator saved under p_name; its label is not saved.
+ *
+ * @return false if the name is taken or too long, or the checkpoint is full.
+ */
+bool checkpoint_track_stats(FIR_checkpoint_t *p_checkpoint, const char *p_name, FIR_pipeline_stats_t *p_stats)
+{
+    checkpoint_entry_t *l_entry = add_entry(p_checkpoint, p_name, CHECKPOINT_STATS);
+    if (l_entry == NULL)
+        return false;
+
+    l_entry->stats = p_stats;
+    p_checkpoint->bytes += sizeof(record_header_t) + sizeof(stats_record_t);
+    return true;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Capture and the writer                                                    */
+/* ------------------------------------------------------------------------- */
+
+/* Serialises the tracked state into p_bytes, checkpoint->bytes long */
+static void serialise_state(const FIR_checkpoint_t *p_checkpoint, uint8_t *p_bytes, uint64_t p_sequence,
+                            uint64_t p_position)
+{
+    uint8_t *l_cursor = p_bytes + sizeof(checkpoint_header_t);
+
+    for (uint32_t i = 0; i < p_checkpoint->entry_count; i++)
+    {
+        const checkpoint_entry_t *l_entry = &p_checkpoint->entries[i];
+        record_header_t l_record = { .kind = l_entry->kind };
+        memcpy(l_record.name, l_entry->name, sizeof(l_record.name));
+
+        if (l_entry->kind == CHECKPOINT_PLAN)
+        {
+            const FIR_plan_t *l_plan = l_entry->plan;
+            plan_record_t l_state = { .coeff_len = l_plan->coeff_len, .block_len = l_plan->block_len };
+            snprintf(l_state.kernel, sizeof(l_state.kernel), "%s", filter_kernel_name(l_plan->kernel));
+            if (l_plan->kernel == FIR_KERNEL_FFA && l_plan->ffa != NULL)
+                l_state.levels = ffa_factors(l_plan->ffa, l_state.factors);
+            l_state.coeff_hash = l_entry->coeff_hash;
+
+            l_record.payload_bytes = plan_payload_bytes(l_plan);
+            memcpy(l_cursor, &l_record, sizeof(l_record));
+            memcpy(l_cursor + sizeof(l_record), &l_state, sizeof(l_state));
+            // The history is the first coeff_len - 1 samples of the work buffer between blocks
+            memcpy(l_cursor + sizeof(l_record) + sizeof(l_state), l_plan->work,
+                   (l_plan->coeff_len - 1) * sizeof(float32_t));
+        }
+        else
+        {
+            const FIR_pipeline_stats_t *l_stats = l_entry->stats;
+            stats_record_t l_state = { .count = l_stats->count, .sum = l_stats->sum, .sum_sq = l_stats->sum_sq,
+                                       .min = l_stats->min, .max = l_stats->max };
+
+            l_record.payload_bytes = sizeof(l_state);
+            memcpy(l_cursor, &l_record, sizeof(l_record));
+            memcpy(l_cursor + sizeof(l_record), &l_state, sizeof(l_state));
+        }
+        l_cursor += sizeof(l_record) + l_record.payload_bytes;
+    }
+
+    checkpoint_header_t l_header = { .version = CHECKPOINT_VERSION, .sequence = p_sequence, .position = p_position,
+                                     .records = p_checkpoint->entry_count };
+    memcpy(l_header.magic, CHECKPOINT_MAGIC, sizeof(l_header.magic));
+    l_header.payload_bytes = p_checkpoint->bytes - sizeof(checkpoint_header_t);
+    memcpy(p_bytes, &l_header, sizeof(l_header));
+}
+
+/* Syncs the directory holding p_path, so that a rename into it is durable */
+static bool sync_parent_directory(const char *p_path)
+{
+    char l_dir[CHECKPOINT_PATH_MAX];
+    const char *l_slash = strrchr(p_path, '/');
+
+    if (l_slash == NULL)
+        snprintf(l_dir, sizeof(l_dir), ".");
+    else if (l_slash == p_path)
+        snprintf(l_dir, sizeof(l_dir), "/");
+    else
+        snprintf(l_dir, sizeof(l_dir), "%.*s", (int)(l_slash - p_path), p_path);
+
+    int l_fd = open(l_dir, O_RDONLY | O_DIRECTORY);
+    if (l_fd < 0)
+        return false;
+    bool l_ok = (fsync(l_fd) == 0);
+    return (close(l_fd) == 0) && l_ok;
+}
+
+/*
+ * Completes the header with the checksum, which is left to the writer to
+ * keep it off the filter thread, then writes the snapshot to a temporary
+ * file, syncs it, renames it over the checkpoint and syncs the directory,
+ * without which the rename itself may not survive a crash.
+ */
+static bool write_snapshot(const FIR_checkpoint_t *p_checkpoint, uint8_t *p_bytes)
+{
+    checkpoint_header_t l_header;
+    memcpy(&l_header, p_bytes, sizeof(l_header));
+    l_header.checksum = fnv1a(p_bytes + sizeof(l_header), l_header.payload_bytes);
+    memcpy(p_bytes, &l_header, sizeof(l_header));
+
+    char l_temp[CHECKPOINT_PATH_MAX + 4];
+    snprintf(l_temp, sizeof(l_temp), "%s.tmp", p_checkpoint->path);
+
+    int l_fd = open(l_temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (l_fd < 0)
+    {
+        printf("Error. Not able to write checkpoint %s: %s.\n", l_temp, strerror(errno));
+        return false;
+    }
+
+    uint64_t l_done = 0;
+    while (l_done < p_checkpoint->bytes)
+    {
+        ssize_t l_written = write(l_fd, p_bytes + l_done, p_checkpoint->bytes - l_done);
+        if (l_written < 0 && errno == EINTR)
+            continue;
+        if (l_written <= 0)
+            break;
+        l_done += (uint64_t)l_written;
+    }
+
+    bool l_ok = (l_done == p_checkpoint->bytes) && fsync(l_fd) == 0;
+    l_ok = (close(l_fd) == 0) && l_ok;
+    l_ok = l_ok && rename(l_temp, p_checkpoint->path) == 0;
+    l_ok = l_ok && sync_parent_directory(p_checkpoint->path);
+    if (!l_ok)
+    {
+        printf("Error. Not able to write checkpoint %s: %s.\n", p_checkpoint->path, strerror(errno));
+        unlink(l_temp);
+    }
+    return l_ok;
+}
+
+static void *writer_main(void *p_arg)
+{
+    FIR_checkpoint_t *l_checkpoint = p_arg;
+
+    pthread_mutex_lock(&l_checkpoint->lock);
+    for (;;)
+    {
+        snapshot_t *l_snapshot = NULL;
+        for (uint32_t s = 0; s < 2; s++)
+        {
+            if (l_checkpoint->snapshots[s].state == SNAPSHOT_PENDING)
+                l_snapshot = &l_checkpoint->snapshots[s];
+        }
+        if (l_snapshot == NULL)
+        {
+            if (l_checkpoint->stop)
+                break;
+            pthread_cond_wait(&l_checkpoint->wake, &l_checkpoint->lock);
+            continue;
+        }
+
+        l_snapshot->state = SNAPSHOT_WRITING;
+        pthread_mutex_unlock(&l_checkpoint->lock);
+
+        uint64_t l_start = telemetry_now_ns();
+        bool l_ok = write_snapshot(l_checkpoint, l_snapshot->bytes);
+        uint64_t l_ns = telemetry_now_ns() - l_start;
+
+        pthread_mutex_lock(&l_checkpoint->lock);
+        l_snapshot->state = SNAPSHOT_FREE;
+        if (l_ok)
+        {
+            checkpoint_header_t l_header;
+            memcpy(&l_header, l_snapshot->bytes, sizeof(l_header));
+            l_checkpoint->report.written++;
+            l_checkpoint->report.last_sequence = l_header.sequence;
+        }
+        else
+        {
+            l_checkpoint->report.failed++;
+        }
+        if (l_ns > l_checkpoint->report.write_ns_max)
+            l_checkpoint->report.write_ns_max = l_ns;
+        pthread_cond_broadcast(&l_checkpoint->idle);
+    }
+    pthread_mutex_unlock(&l_checkpoint->lock);
+
+    return NULL;
+}
+
+/* First capture: the snapshot buffers, sized for the entries, and the writer thread */
+static bool start_writer(FIR_checkpoint_t *p_checkpoint)
+{
+    for (uint32_t s = 0; s < 2; s++)
+    {
+        if (p_checkpoint->snapshots[s].bytes == NULL)
+            p_checkpoint->snapshots[s].bytes = arena_calloc(1, p_checkpoint->bytes);  // zero padding
+        if (p_checkpoint->snapshots[s].bytes == NULL)
+        {
+            printf("Error. Not able to allocate checkpoint snapshots of %llu bytes.\n",
+                   (unsigned long long)p_checkpoint->bytes);
+            return false;
+        }
+    }
+
+    if (pthread_create(&p_checkpoint->writer, NULL, writer_main, p_checkpoint) != 0)
+    {
+        printf("Error. Not able to start the checkpoint writer thread.\n");
+        return false;
+    }
+    p_checkpoint->writer_started = true;
+    return true;
+}
+
+/**
+ * @brief Snapshots the tracked state and hands it to the writer thread.
+ *
+ * Call it from the thread running the tracked plans, between blocks. It
+ * copies the state and returns without waiting for the file to be written.
+ *
+ * @param[in,out] p_checkpoint Pointer to the checkpoint.
+ * @param[in] p_position Caller's stream position, e.g. samples consumed,
+ *            returned by restore_checkpoint().
+ *
+ * @return false if the writer could not be started.
+ */
+bool capture_checkpoint(FIR_checkpoint_t *p_checkpoint, uint64_t p_position)
+{
+    uint64_t l_start = telemetry_now_ns();
+
+    if (!p_checkpoint->writer_started && !start_writer(p_checkpoint))
+        return false;
+
+    // The snapshot the writer is not holding; a pending one there is stale and is overwritten
+    pthread_mutex_lock(&p_checkpoint->lock);
+    snapshot_t *l_snapshot = &p_checkpoint->snapshots[0];
+    if (l_snapshot->state == SNAPSHOT_WRITING)
+        l_snapshot = &p_checkpoint->snapshots[1];
+    if (l_snapshot->state == SNAPSHOT_PENDING)
+        p_checkpoint->report.superseded++;
+    l_snapshot->state = SNAPSHOT_FILLING;
+    uint64_t l_sequence = ++p_checkpoint->sequence;
+    pthread_mutex_unlock(&p_checkpoint->lock);
+
+    serialise_state(p_checkpoint, l_snapshot->bytes, l_sequence, p_position);
+
+    pthread_mutex_lock(&p_checkpoint->lock);
+    l_snapshot->state = SNAPSHOT_PENDING;
+    p_checkpoint->report.captures++;
+    uint64_t l_ns = telemetry_now_ns() - l_start;
+    p_checkpoint->report.capture_ns_sum += l_ns;
+    if (l_ns > p_checkpoint->report.capture_ns_max)
+        p_checkpoint->report.capture_ns_max = l_ns;
+    pthread_mutex_unlock(&p_checkpoint->lock);
+    pthread_cond_signal(&p_checkpoint->wake);
+
+    return true;
+}
+
+/**
+ * @brief Waits until the last capture is on disk.
+ *
+ * @return false if any write has failed.
+ */
+bool flush_checkpoint(FIR_checkpoint_t *p_checkpoint)
+{
+    pthread_mutex_lock(&p_checkpoint->lock);
+    while (p_checkpoint->snapshots[0].state != SNAPSHOT_FREE || p_checkpoint->snapshots[1].state != SNAPSHOT_FREE)
+    {
+        pthread_cond_wait(&p_checkpoint->idle, &p_checkpoint->lock);
+    }
+    bool l_ok = (p_checkpoint->report.failed == 0);
+    pthread_mutex_unlock(&p_checkpoint->lock);
+
+    return l_ok;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Restore                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* Finds the record of an entry in the mapped payload, NULL if there is none */
+static const uint8_t *find_record(const uint8_t *p_payload, uint64_t p_payload_bytes, uint32_t p_records,
+                                  const checkpoint_entry_t *p_entry, uint32_t *p_payload_len)
+{
+    uint64_t l_offset = 0;
+
+    for (uint32_t r = 0; r < p_records; r++)
+    {
+        record_header_t l_record;
+        if (p_payload_bytes - l_offset < sizeof(l_record))
+            return NULL;
+        memcpy(&l_record, p_payload + l_offset, sizeof(l_record));
+        if (p_payload_bytes - l_offset - sizeof(l_record) < l_record.payload_bytes)
+            return NULL;
+
+        if (l_record.kind == (uint32_t)p_entry->kind
+            && strncmp(l_record.name, p_entry->name, CHECKPOINT_NAME_MAX) == 0)
+        {
+            *p_payload_len = l_record.payload_bytes;
+            return p_payload + l_offset + sizeof(l_record);
+        }
+        l_offset += sizeof(l_record) + l_record.payload_bytes;
+    }
+    return NULL;
+}
+
+static bool parse_kernel(const char *p_name, FIR_kernel_t *p_kernel)
+{
+    for (uint32_t k = 0; k < FIR_KERNEL_COUNT; k++)
+    {
+        if (strncmp(p_name, filter_kernel_name((FIR_kernel_t)k), CHECKPOINT_KERNEL_MAX) == 0)
+        {
+            *p_kernel = (FIR_kernel_t)k;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Checks that a plan record was saved from a plan with the same coefficients and block length */
+static bool check_plan_record(const checkpoint_entry_t *p_entry, const uint8_t *p_payload, uint32_t p_payload_len,
+                              plan_record_t *p_state, FIR_kernel_t *p_kernel)
+{
+    const FIR_plan_t *l_plan = p_entry->plan;
+
+    if (p_payload_len != plan_payload_bytes(l_plan))
+    {
+        printf("Error. Checkpoint record %s is for a filter of another length.\n", p_entry->name);
+        return false;
+    }
+    memcpy(p_state, p_payload, sizeof(*p_state));
+
+    if (p_state->coeff_len != l_plan->coeff_len || p_state->block_len != l_plan->block_len
+        || p_state->coeff_hash != p_entry->coeff_hash)
+    {
+        printf("Error. Checkpoint record %s is for other coefficients or another block length.\n", p_entry->name);
+        return false;
+    }
+    if (!parse_kernel(p_state->kernel, p_kernel) || !kernel_supported(*p_kernel, l_plan->properties)
+        || p_state->levels > FFA_MAX_LEVELS || (*p_kernel == FIR_KERNEL_FFA && p_state->levels == 0))
+    {
+        printf("Error. Checkpoint record %s names a kernel this build cannot run.\n", p_entry->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Restores the tracked plans and accumulators from the checkpoint file.
+ *
+ * The file is memory-mapped and checked as a whole (magic, version, size,
+ * checksum, and a matching record for every entry), and the fast FIR
+ * decompositions the records name are built, before anything is changed,
+ * so on failure the tracked state is left as it was. Records without a
+ * tracked entry are ignored.
+ *
+ * @param[in,out] p_checkpoint Pointer to the checkpoint, with the same entries
+ *                as when it was written.
+ * @param[out] p_position Stream position passed to the capture restored.
+ *
+ * @return false if there is no valid checkpoint for the entries.
+ */
+bool restore_checkpoint(FIR_checkpoint_t *p_checkpoint, uint64_t *p_position)
+{
+    int l_fd = open(p_checkpoint->path, O_RDONLY);
+    if (l_fd < 0)
+    {
+        printf("Error. Not able to open checkpoint %s: %s.\n", p_checkpoint->path, strerror(errno));
+        return false;
+    }
+
+    struct stat l_stat;
+    const uint8_t *l_map = MAP_FAILED;
+    if (fstat(l_fd, &l_stat) == 0 && (uint64_t)l_stat.st_size >= sizeof(checkpoint_header_t))
+        l_map = mmap(NULL, (size_t)l_stat.st_size, PROT_READ, MAP_PRIVATE, l_fd, 0);
+    close(l_fd);
+    if (l_map == MAP_FAILED)
+    {
+        printf("Error. %s is not a FIR checkpoint.\n", p_checkpoint->path);
+        return false;
+    }
+
+    checkpoint_header_t l_header;
+    memcpy(&l_header, l_map, sizeof(l_header));
+    const uint8_t *l_payload = l_map + sizeof(l_header);
+
+    bool l_ok = memcmp(l_header.magic, CHECKPOINT_MAGIC, sizeof(l_header.magic)) == 0
+                && l_header.version == CHECKPOINT_VERSION
+                && l_header.payload_bytes == (uint64_t)l_stat.st_size - sizeof(l_header)
+                && l_header.checksum == fnv1a(l_payload, l_header.payload_bytes);
+    if (!l_ok)
+        printf("Error. %s is not a FIR checkpoint of version %u, or it is damaged.\n", p_checkpoint->path,
+               CHECKPOINT_VERSION);
+
+    // Check every entry and build its decomposition first, then apply, so a failure changes nothing
+    FIR_ffa_t **l_ffas = NULL;
+    if (l_ok)
+    {
+        l_ffas = arena_calloc(p_checkpoint->entry_count + 1U, sizeof(FIR_ffa_t *));
+        l_ok = (l_ffas != NULL);
+    }
+    for (uint32_t pass = 0; pass < 2 && l_ok; pass++)
+    {
+        for (uint32_t i = 0; i < p_checkpoint->entry_count && l_ok; i++)
+        {
+            checkpoint_entry_t *l_entry = &p_checkpoint->entries[i];
+            uint32_t l_len = 0;
+            const uint8_t *l_record = find_record(l_payload, l_header.payload_bytes, l_header.records, l_entry, &l_len);
+            if (l_record == NULL)
+            {
+                printf("Error. Checkpoint %s has no record for %s.\n", p_checkpoint->path, l_entry->name);
+                l_ok = false;
+                break;
+            }
+
+            if (l_entry->kind == CHECKPOINT_PLAN)
+            {
+                plan_record_t l_state;
+                FIR_kernel_t l_kernel;
+                FIR_plan_t *l_plan = l_entry->plan;
+                l_ok = check_plan_record(l_entry, l_record, l_len, &l_state, &l_kernel);
+                if (l_ok && pass == 0 && l_kernel == FIR_KERNEL_FFA)
+                {
+                    l_ffas[i] = create_ffa(l_plan->coeffs, l_plan->coeff_len, l_plan->block_len, l_state.factors,
+                                           l_state.levels);
+                    l_ok = (l_ffas[i] != NULL);
+                }
+                if (l_ok && pass == 1)
+                {
+                    l_ok = set_filter_plan_kernel(l_plan, l_kernel, l_ffas[i]);
+                    if (l_ok)
+                    {
+                        l_ffas[i] = NULL;
+                        memcpy(l_plan->work, l_record + sizeof(l_state), (l_plan->coeff_len - 1) * sizeof(float32_t));
+                    }
+                }
+            }
+            else if (l_len != sizeof(stats_record_t))
+            {
+                printf("Error. Checkpoint record %s is not a statistics record.\n", l_entry->name);
+                l_ok = false;
+            }
+            else if (pass == 1)
+            {
+                stats_record_t l_state;
+                memcpy(&l_state, l_record, sizeof(l_state));
+                l_entry->stats->count = l_state.count;
+                l_entry->stats->sum = l_state.sum;
+                l_entry->stats->sum_sq = l_state.sum_sq;
+                l_entry->stats->min = l_state.min;
+                l_entry->stats->max = l_state.max;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; l_ffas != NULL && i < p_checkpoint->entry_count; i++)
+    {
+        destroy_ffa(l_ffas[i]);
+    }
+    arena_free(l_ffas);
+
+    if (l_ok)
+    {
+        *p_position = l_header.position;
+        p_checkpoint->sequence = l_header.sequence;
+    }
+    munmap((void *)l_map, (size_t)l_stat.st_size);
+    return l_ok;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Report                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Reads the capture and write counters of a checkpoint.
+ */
+void read_checkpoint_report(FIR_checkpoint_t *p_checkpoint, FIR_checkpoint_report_t *p_report)
+{
+    pthread_mutex_lock(&p_checkpoint->lock);
+    *p_report = p_checkpoint->report;
+    pthread_mutex_unlock(&p_checkpoint->lock);
+    p_report->entries = p_checkpoint->entry_count;
+    p_report->bytes = p_checkpoint->bytes;
+}
+
+/**
+ * @brief Prints the size of a checkpoint and the cost of capturing and writing it.
+ */
+void print_checkpoint_report(const FIR_checkpoint_report_t *p_report)
+{
+    printf("Checkpoint: %u entries, %.1f KiB\n", p_report->entries, (double)p_report->bytes / 1024.0);
+    printf("Captures: %llu, %llu superseded before written\n", (unsigned long long)p_report->captures,
+           (unsigned long long)p_report->superseded);
+    printf("Written: %llu, %llu failed, last sequence %llu\n", (unsigned long long)p_report->written,
+           (unsigned long long)p_report->failed, (unsigned long long)p_report->last_sequence);
+    double l_captures = (p_report->captures > 0) ? (double)p_report->captures : 1.0;
+    printf("Capture time (filter thread): mean %.1f us, longest %.1f us (the first starts the writer)\n",
+           (double)p_report->capture_ns_sum / l_captures * 1e-3, (double)p_report->capture_ns_max * 1e-3);
+    printf("Longest write (writer thread): %.3f ms\n", (double)p_report->write_ns_max * 1e-6);
+}
+
+/**
+ * @brief Writes any pending capture, stops the writer and releases the checkpoint. Accepts NULL.
+ *
+ * The tracked plans and accumulators are not released.
+ */
+void destroy_checkpoint(FIR_checkpoint_t *p_checkpoint)
+{
+    if (p_checkpoint == NULL)
+        return;
+
+    if (p_checkpoint->writer_started)
+    {
+        pthread_mutex_lock(&p_checkpoint->lock);
+        p_checkpoint->stop = true;
+        pthread_cond_signal(&p_checkpoint->wake);
+        pthread_mutex_unlock(&p_checkpoint->lock);
+        pthread_join(p_checkpoint->writer, NULL);
+    }
+
+    pthread_mutex_destroy(&p_checkpoint->lock);
+    pthread_cond_destroy(&p_checkpoint->wake);
+    pthread_cond_destroy(&p_checkpoint->idle);
+    arena_free(p_checkpoint->snapshots[0].bytes);
+    arena_free(p_checkpoint->snapshots[1].bytes);
+    arena_free(p_checkpoint->entries);
+    arena_free(p_checkpoint);
+}
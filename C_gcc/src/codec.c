@@ -0,0 +1,768 @@
+/**
+ * @file codec.c
+ * @brief Predictive bit-packing codec for float32 signals, lossless or with bounded error.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "codec.h"
+#include "fir_target.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CODEC_MAX_ORDER  3U
+#define CODEC_STEP_SCALE (15.0 / 16.0)  /* step = 2 * bound * scale: room for rounding the decoded value to float32 */
+
+typedef enum {
+    BLOCK_LOSSLESS = 0,  /* integers are the order-preserving float bit patterns */
+    BLOCK_QUANTISED,     /* integers are multiples of the step */
+    BLOCK_RAW            /* float32 samples stored as they are; used when coding would expand them */
+} block_mode_t;
+
+typedef struct {
+    char     magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t block_len;
+    uint32_t reserved2;
+    double   step;          /* quantisation step, 0 for a lossless file */
+    uint64_t sample_count;
+} codec_header_t;
+
+typedef struct {
+    uint32_t sample_count;
+    uint32_t payload_bytes;
+    uint8_t  mode;
+    uint8_t  order;
+    uint16_t reserved;
+} codec_block_t;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t block_count;
+    char     magic[4];
+    uint32_t reserved;
+} codec_footer_t;
+
+struct FIR_codec_writer {
+    FILE       *file;
+    uint32_t    block_len;
+    float32_t   max_error;
+    double      step;
+    float32_t  *samples;    /* block being filled */
+    uint32_t    fill;
+    uint32_t   *values;     /* integers of the block */
+    uint32_t   *residuals;  /* zigzag residuals of the block */
+    uint8_t    *payload;
+    uint64_t   *index;
+    uint64_t    index_capacity;
+    uint64_t    offset;     /* bytes written so far */
+    FIR_codec_report_t report;
+};
+
+struct FIR_codec_reader {
+    FILE       *file;
+    codec_header_t header;
+    uint64_t   *index;
+    uint64_t    block_count;
+    uint64_t    next_block;  /* block read by the next decode */
+    float32_t  *samples;     /* decoded block */
+    uint32_t    decoded;     /* samples in the decoded block */
+    uint32_t    pos;         /* next sample of the decoded block to return */
+    uint32_t   *values;
+    uint8_t    *payload;
+};
+
+/* Largest payload of a block: one width byte per group and 32 bits per sample */
+static size_t max_payload(uint32_t p_block_len)
+{
+    return (size_t)p_block_len * sizeof(uint32_t) + (p_block_len + CODEC_GROUP - 1) / CODEC_GROUP + 8;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Integer mapping, prediction and packing                                   */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Maps a float bit pattern to an integer whose order follows the float order.
+ *
+ * Negative floats have their magnitude bits inverted, so the integers run
+ * continuously through zero, e.g. -0.0f -> -1 and +0.0f -> 0.
+ */
+static inline uint32_t float_to_ordered(float32_t p_value)
+{
+    uint32_t l_bits;
+    memcpy(&l_bits, &p_value, sizeof(l_bits));
+    return (l_bits & 0x80000000U) ? ~l_bits | 0x80000000U : l_bits;
+}
+
+static inline float32_t ordered_to_float(uint32_t p_value)
+{
+    uint32_t l_bits = (p_value & 0x80000000U) ? ~p_value | 0x80000000U : p_value;
+    float32_t l_float;
+    memcpy(&l_float, &l_bits, sizeof(l_float));
+    return l_float;
+}
+
+/* Polynomial prediction from the previous three integers; arithmetic wraps modulo 2^32 */
+static inline uint32_t predict(uint32_t p_order, uint32_t p_prev1, uint32_t p_prev2, uint32_t p_prev3)
+{
+    switch (p_order)
+    {
+        case 0:  return 0;
+        case 1:  return p_prev1;
+        case 2:  return 2 * p_prev1 - p_prev2;
+        default: return 3 * p_prev1 - 3 * p_prev2 + p_prev3;
+    }
+}
+
+/*
+ * The same prediction in float32, for lossless blocks: the residual is then
+ * the distance in ulps between the sample and its prediction, which stays
+ * small across exponent changes where predicting the bit patterns would not.
+ * Non-finite predictions are replaced by 0 so that decoding never depends
+ * on NaN propagation.
+ */
+static inline float32_t predict_float(uint32_t p_order, float32_t p_prev1, float32_t p_prev2, float32_t p_prev3)
+{
+    float32_t l_p;
+    switch (p_order)
+    {
+        case 0:  l_p = 0.0f; break;
+        case 1:  l_p = p_prev1; break;
+        case 2:  l_p = 2.0f * p_prev1 - p_prev2; break;
+        default: l_p = 3.0f * p_prev1 - 3.0f * p_prev2 + p_prev3; break;
+    }
+    return isfinite(l_p) ? l_p : 0.0f;
+}
+
+static inline uint32_t zigzag(uint32_t p_residual)
+{
+    return (p_residual << 1) ^ (uint32_t)((int32_t)p_residual >> 31);
+}
+
+static inline uint32_t bit_width(uint32_t p_value)
+{
+    return p_value ? 32U - (uint32_t)__builtin_clz(p_value) : 0U;
+}
+
+/*
+ * Zigzag residual of sample i under a predictor. The writer's block buffers
+ * are preceded by CODEC_MAX_ORDER zeros, so the first samples of a block
+ * need no special case. p_samples are the float samples behind p_values
+ * for a lossless block, predicted in float32; NULL to predict the integers.
+ */
+static inline __attribute__((always_inline))
+uint32_t residual_at(const uint32_t *p_values, const float32_t *p_samples, uint32_t i, uint32_t p_order)
+{
+    const uint32_t *l_v = &p_values[i];
+    uint32_t l_pred;
+
+    if (p_samples != NULL)
+    {
+        const float32_t *l_x = &p_samples[i];
+        l_pred = float_to_ordered(predict_float(p_order, l_x[-1], l_x[-2], l_x[-3]));
+    }
+    else
+    {
+        l_pred = predict(p_order, l_v[-1], l_v[-2], l_v[-3]);
+    }
+    return zigzag(l_v[0] - l_pred);
+}
+
+static inline __attribute__((always_inline))
+size_t packed_bytes(const uint32_t *p_values, const float32_t *p_samples, uint32_t p_len, uint32_t p_order)
+{
+    size_t l_bytes = 0;
+    uint32_t g = 0;
+
+    // Full groups have a constant trip count, which lets the compiler vectorise them
+    for (; g + CODEC_GROUP <= p_len; g += CODEC_GROUP)
+    {
+        uint32_t l_or = 0;
+        for (uint32_t i = 0; i < CODEC_GROUP; i++)
+            l_or |= residual_at(&p_values[g], p_samples ? &p_samples[g] : NULL, i, p_order);
+        l_bytes += 1 + (CODEC_GROUP * bit_width(l_or) + 7) / 8;
+    }
+    if (g < p_len)
+    {
+        uint32_t l_or = 0;
+        for (uint32_t i = g; i < p_len; i++)
+            l_or |= residual_at(p_values, p_samples, i, p_order);
+        l_bytes += 1 + ((p_len - g) * bit_width(l_or) + 7) / 8;
+    }
+    return l_bytes;
+}
+
+/**
+ * @brief Returns the predictor order giving the smallest packed block.
+ *
+ * Each order is costed in its own loop with the order a constant, so the
+ * loops have no branches and vectorise.
+ */
+FIR_MULTIVERSION
+static uint32_t choose_order(const uint32_t *p_values, const float32_t *p_samples, uint32_t p_len)
+{
+    size_t l_bytes[CODEC_MAX_ORDER + 1];
+
+    if (p_samples != NULL)
+    {
+        l_bytes[0] = packed_bytes(p_values, p_samples, p_len, 0);
+        l_bytes[1] = packed_bytes(p_values, p_samples, p_len, 1);
+        l_bytes[2] = packed_bytes(p_values, p_samples, p_len, 2);
+        l_bytes[3] = packed_bytes(p_values, p_samples, p_len, 3);
+    }
+    else
+    {
+        l_bytes[0] = packed_bytes(p_values, NULL, p_len, 0);
+        l_bytes[1] = packed_bytes(p_values, NULL, p_len, 1);
+        l_bytes[2] = packed_bytes(p_values, NULL, p_len, 2);
+        l_bytes[3] = packed_bytes(p_values, NULL, p_len, 3);
+    }
+
+    uint32_t l_order = 0;
+    for (uint32_t o = 1; o <= CODEC_MAX_ORDER; o++)
+    {
+        if (l_bytes[o] < l_bytes[l_order])
+            l_order = o;
+    }
+    return l_order;
+}
+
+static inline __attribute__((always_inline))
+void residual_block(const uint32_t *p_values, const float32_t *p_samples, uint32_t p_len, uint32_t p_order,
+                    uint32_t *p_residuals)
+{
+    uint32_t g = 0;
+
+    for (; g + CODEC_GROUP <= p_len; g += CODEC_GROUP)
+    {
+        for (uint32_t i = 0; i < CODEC_GROUP; i++)
+            p_residuals[g + i] = residual_at(&p_values[g], p_samples ? &p_samples[g] : NULL, i, p_order);
+    }
+    for (; g < p_len; g++)
+        p_residuals[g] = residual_at(p_values, p_samples, g, p_order);
+}
+
+/**
+ * @brief Writes the zigzag residuals of p_values under the chosen predictor.
+ */
+FIR_MULTIVERSION
+static void make_residuals(const uint32_t *p_values, const float32_t *p_samples, uint32_t p_len,
+                           uint32_t p_order, uint32_t *p_residuals)
+{
+    switch (p_order)
+    {
+        case 0:  residual_block(p_values, p_samples, p_len, 0, p_residuals); break;
+        case 1:  residual_block(p_values, p_samples, p_len, 1, p_residuals); break;
+        case 2:  residual_block(p_values, p_samples, p_len, 2, p_residuals); break;
+        default: residual_block(p_values, p_samples, p_len, 3, p_residuals); break;
+    }
+}
+
+static uint8_t *pack_group(const uint32_t *p_residuals, uint32_t p_len, uint32_t p_width, uint8_t *p_out)
+{
+    uint64_t l_acc = 0;
+    uint32_t l_bits = 0;
+
+    for (uint32_t i = 0; i < p_len; i++)
+    {
+        l_acc |= (uint64_t)p_residuals[i] << l_bits;
+        l_bits += p_width;
+        while (l_bits >= 8)
+        {
+            *p_out++ = (uint8_t)l_acc;
+            l_acc >>= 8;
+            l_bits -= 8;
+        }
+    }
+    if (l_bits > 0)
+        *p_out++ = (uint8_t)l_acc;
+
+    return p_out;
+}
+
+static const uint8_t *unpack_group(const uint8_t *p_in, uint32_t p_len, uint32_t p_width, uint32_t *p_residuals)
+{
+    uint64_t l_mask = (1ULL << p_width) - 1;
+    uint64_t l_acc = 0;
+    uint32_t l_bits = 0;
+
+    for (uint32_t i = 0; i < p_len; i++)
+    {
+        while (l_bits < p_width)
+        {
+            l_acc |= (uint64_t)*p_in++ << l_bits;
+            l_bits += 8;
+        }
+        p_residuals[i] = (uint32_t)(l_acc & l_mask);
+        l_acc >>= p_width;
+        l_bits -= p_width;
+    }
+
+    return p_in;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Writer                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Turns the block into integers, quantised if every sample stays within the error bound.
+ */
+static block_mode_t block_to_integers(FIR_codec_writer_t *p_writer, uint32_t p_len)
+{
+    const float32_t *l_x = p_writer->samples;
+    double l_step = p_writer->step;
+
+    if (l_step > 0.0)
+    {
+        uint32_t i = 0;
+        for (; i < p_len; i++)
+        {
+            double l_q = nearbyint((double)l_x[i] / l_step);
+            if (!(fabs(l_q) <= 2147483647.0)
+                || fabs((double)l_x[i] - (double)(float32_t)(l_q * l_step)) > p_writer->max_error)
+                break;
+            p_writer->values[i] = (uint32_t)(int32_t)l_q;
+        }
+        if (i == p_len)
+            return BLOCK_QUANTISED;
+    }
+
+    for (uint32_t i = 0; i < p_len; i++)
+    {
+        p_writer->values[i] = float_to_ordered(l_x[i]);
+    }
+    return BLOCK_LOSSLESS;
+}
+
+static bool write_bytes(FIR_codec_writer_t *p_writer, const void *p_data, size_t p_len)
+{
+    if (fwrite(p_data, 1, p_len, p_writer->file) != p_len)
+        return false;
+    p_writer->offset += p_len;
+    return true;
+}
+
+/**
+ * @brief Codes the buffered samples as one block and appends it to the file.
+ */
+static bool flush_block(FIR_codec_writer_t *p_writer)
+{
+    uint32_t l_len = p_writer->fill;
+    if (l_len == 0)
+        return true;
+
+    if (p_writer->report.blocks == p_writer->index_capacity)
+    {
+        uint64_t l_capacity = p_writer->index_capacity ? 2 * p_writer->index_capacity : 256;
+        uint64_t *l_index = realloc(p_writer->index, l_capacity * sizeof(uint64_t));
+        if (l_index == NULL)
+            return false;
+        p_writer->index = l_index;
+        p_writer->index_capacity = l_capacity;
+    }
+    p_writer->index[p_writer->report.blocks] = p_writer->offset;
+
+    block_mode_t l_mode = block_to_integers(p_writer, l_len);
+    const float32_t *l_samples = (l_mode == BLOCK_LOSSLESS) ? p_writer->samples : NULL;
+
+    uint32_t l_order = choose_order(p_writer->values, l_samples, l_len);
+    make_residuals(p_writer->values, l_samples, l_len, l_order, p_writer->residuals);
+
+    uint8_t *l_out = p_writer->payload;
+    for (uint32_t g = 0; g < l_len; g += CODEC_GROUP)
+    {
+        uint32_t l_n = (l_len - g < CODEC_GROUP) ? l_len - g : CODEC_GROUP;
+        uint32_t l_or = 0;
+        for (uint32_t i = g; i < g + l_n; i++)
+            l_or |= p_writer->residuals[i];
+
+        uint32_t l_width = bit_width(l_or);
+        *l_out++ = (uint8_t)l_width;
+        l_out = pack_group(&p_writer->residuals[g], l_n, l_width, l_out);
+    }
+
+    if ((size_t)(l_out - p_writer->payload) >= l_len * sizeof(float32_t))
+    {
+        memcpy(p_writer->payload, p_writer->samples, l_len * sizeof(float32_t));
+        l_out = p_writer->payload + l_len * sizeof(float32_t);
+        l_mode = BLOCK_RAW;
+        l_order = 0;
+    }
+
+    codec_block_t l_block = { .sample_count = l_len, .payload_bytes = (uint32_t)(l_out - p_writer->payload),
+                              .mode = (uint8_t)l_mode, .order = (uint8_t)l_order };
+    if (!write_bytes(p_writer, &l_block, sizeof(l_block))
+        || !write_bytes(p_writer, p_writer->payload, l_block.payload_bytes))
+        return false;
+
+    p_writer->report.blocks++;
+    p_writer->report.samples += l_len;
+    if (l_mode == BLOCK_QUANTISED)
+        p_writer->report.lossy_blocks++;
+    p_writer->fill = 0;
+    return true;
+}
+
+/**
+ * @brief Creates a compressed signal file and returns a writer for it.
+ *
+ * @param[in] p_filename Path of the file; it will be created or overwritten.
+ * @param[in] p_max_error Largest absolute error allowed per sample, 0 for lossless.
+ * @param[in] p_block_len Samples per block, 0 for CODEC_DEFAULT_BLOCK. Smaller
+ *            blocks seek faster, larger ones compress slightly better.
+ *
+ * @return The writer, or NULL on failure.
+ */
+FIR_codec_writer_t *open_codec_writer(const char *p_filename, float32_t p_max_error, uint32_t p_block_len)
+{
+    if (!(p_max_error >= 0.0f) || !isfinite(p_max_error))
+    {
+        printf("Error. The codec error bound must be a finite value of 0 or more.\n");
+        return NULL;
+    }
+
+    FIR_codec_writer_t *l_writer = calloc(1, sizeof(FIR_codec_writer_t));
+    if (l_writer == NULL)
+        return NULL;
+
+    l_writer->block_len = p_block_len ? p_block_len : CODEC_DEFAULT_BLOCK;
+    l_writer->max_error = p_max_error;
+    l_writer->step = 2.0 * (double)p_max_error * CODEC_STEP_SCALE;
+    // CODEC_MAX_ORDER zeros before each block, read by the predictors
+    float32_t *l_samples = calloc(CODEC_MAX_ORDER + l_writer->block_len, sizeof(float32_t));
+    uint32_t *l_values = calloc(CODEC_MAX_ORDER + l_writer->block_len, sizeof(uint32_t));
+    l_writer->samples = l_samples ? &l_samples[CODEC_MAX_ORDER] : NULL;
+    l_writer->values = l_values ? &l_values[CODEC_MAX_ORDER] : NULL;
+    l_writer->residuals = malloc(l_writer->block_len * sizeof(uint32_t));
+    l_writer->payload = malloc(max_payload(l_writer->block_len));
+    l_writer->file = fopen(p_filename, "wb");
+
+    if (l_writer->file == NULL)
+        printf("Error. Not able to open file %s for writing.\n", p_filename);
+    else if (l_writer->samples == NULL || l_writer->values == NULL || l_writer->residuals == NULL
+             || l_writer->payload == NULL)
+    {
+        fclose(l_writer->file);
+        l_writer->file = NULL;
+    }
+    if (l_writer->file == NULL)
+    {
+        close_codec_writer(l_writer, NULL);
+        return NULL;
+    }
+
+    // The sample count is filled in by close_codec_writer()
+    codec_header_t l_header = { .version = CODEC_VERSION, .block_len = l_writer->block_len,
+                                .step = l_writer->step };
+    memcpy(l_header.magic, CODEC_MAGIC, sizeof(l_header.magic));
+    if (!write_bytes(l_writer, &l_header, sizeof(l_header)))
+    {
+        printf("Error. Not able to write %s.\n", p_filename);
+        close_codec_writer(l_writer, NULL);
+        return NULL;
+    }
+
+    return l_writer;
+}
+
+/**
+ * @brief Appends samples to a compressed file; whole blocks are coded and written as they fill.
+ *
+ * @return false if the file could not be written.
+ */
+bool write_codec_samples(FIR_codec_writer_t *p_writer, const float32_t *p_samples, uint64_t p_count)
+{
+    for (uint64_t l_done = 0; l_done < p_count; )
+    {
+        uint32_t l_room = p_writer->block_len - p_writer->fill;
+        uint32_t l_len = (p_count - l_done < l_room) ? (uint32_t)(p_count - l_done) : l_room;
+
+        memcpy(&p_writer->samples[p_writer->fill], &p_samples[l_done], l_len * sizeof(float32_t));
+        p_writer->fill += l_len;
+        l_done += l_len;
+
+        if (p_writer->fill == p_writer->block_len && !flush_block(p_writer))
+        {
+            printf("Error. Not able to write a compressed block.\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Codes the last partial block, writes the index and closes the file. Accepts NULL.
+ *
+ * @param[in] p_writer The writer; it is freed in all cases.
+ * @param[out] p_report Where to store the totals, or NULL.
+ *
+ * @return false if the file could not be completed.
+ */
+bool close_codec_writer(FIR_codec_writer_t *p_writer, FIR_codec_report_t *p_report)
+{
+    if (p_writer == NULL)
+        return false;
+
+    bool l_ok = (p_writer->file != NULL) && flush_block(p_writer);
+
+    if (l_ok)
+    {
+        codec_footer_t l_footer = { .index_offset = p_writer->offset, .block_count = p_writer->report.blocks };
+        memcpy(l_footer.magic, CODEC_MAGIC, sizeof(l_footer.magic));
+        l_ok = write_bytes(p_writer, p_writer->index, p_writer->report.blocks * sizeof(uint64_t))
+               && write_bytes(p_writer, &l_footer, sizeof(l_footer));
+    }
+    if (l_ok)
+    {
+        codec_header_t l_header = { .version = CODEC_VERSION, .block_len = p_writer->block_len,
+                                    .step = p_writer->step, .sample_count = p_writer->report.samples };
+        memcpy(l_header.magic, CODEC_MAGIC, sizeof(l_header.magic));
+        l_ok = fseeko(p_writer->file, 0, SEEK_SET) == 0 && fwrite(&l_header, sizeof(l_header), 1, p_writer->file) == 1;
+    }
+    if (p_writer->file != NULL)
+    {
+        l_ok = (fclose(p_writer->file) == 0) && l_ok;
+        if (!l_ok)
+            printf("Error. Not able to complete a compressed file.\n");
+    }
+
+    p_writer->report.bytes = p_writer->offset;
+    if (p_report != NULL)
+        *p_report = p_writer->report;
+
+    if (p_writer->samples != NULL)
+        free(p_writer->samples - CODEC_MAX_ORDER);
+    if (p_writer->values != NULL)
+        free(p_writer->values - CODEC_MAX_ORDER);
+    free(p_writer->residuals);
+    free(p_writer->payload);
+    free(p_writer->index);
+    free(p_writer);
+    return l_ok;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Reader                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Opens a compressed signal file for streaming or random-access decoding.
+ *
+ * @return The reader, positioned at the first sample, or NULL on failure.
+ */
+FIR_codec_reader_t *open_codec_reader(const char *p_filename)
+{
+    FIR_codec_reader_t *l_reader = calloc(1, sizeof(FIR_codec_reader_t));
+    if (l_reader == NULL)
+        return NULL;
+
+    l_reader->file = fopen(p_filename, "rb");
+    if (l_reader->file == NULL)
+    {
+        printf("Error. Not able to open file %s for reading.\n", p_filename);
+        free(l_reader);
+        return NULL;
+    }
+
+    codec_header_t *l_header = &l_reader->header;
+    codec_footer_t l_footer;
+    bool l_ok = fread(l_header, sizeof(*l_header), 1, l_reader->file) == 1
+                && memcmp(l_header->magic, CODEC_MAGIC, sizeof(l_header->magic)) == 0
+                && l_header->version == CODEC_VERSION && l_header->block_len > 0
+                && fseeko(l_reader->file, -(off_t)sizeof(l_footer), SEEK_END) == 0
+                && fread(&l_footer, sizeof(l_footer), 1, l_reader->file) == 1
+                && memcmp(l_footer.magic, CODEC_MAGIC, sizeof(l_footer.magic)) == 0
+                && l_footer.block_count == (l_header->sample_count + l_header->block_len - 1) / l_header->block_len;
+
+    if (l_ok)
+    {
+        l_reader->block_count = l_footer.block_count;
+        l_reader->index = malloc((l_footer.block_count ? l_footer.block_count : 1) * sizeof(uint64_t));
+        l_reader->samples = malloc(l_header->block_len * sizeof(float32_t));
+        l_reader->values = malloc(l_header->block_len * sizeof(uint32_t));
+        l_reader->payload = malloc(max_payload(l_header->block_len));
+        l_ok = l_reader->index != NULL && l_reader->samples != NULL && l_reader->values != NULL
+               && l_reader->payload != NULL
+               && fseeko(l_reader->file, (off_t)l_footer.index_offset, SEEK_SET) == 0
+               && fread(l_reader->index, sizeof(uint64_t), l_footer.block_count, l_reader->file)
+                  == l_footer.block_count;
+    }
+
+    if (!l_ok || !seek_codec_reader(l_reader, 0))
+    {
+        printf("Error. %s is not a complete compressed signal file.\n", p_filename);
+        close_codec_reader(l_reader);
+        return NULL;
+    }
+
+    return l_reader;
+}
+
+/**
+ * @brief Total number of samples in the file.
+ */
+uint64_t codec_sample_count(const FIR_codec_reader_t *p_reader)
+{
+    return p_reader->header.sample_count;
+}
+
+/**
+ * @brief Reads and decodes the block at the current file position.
+ */
+static bool decode_block(FIR_codec_reader_t *p_reader)
+{
+    codec_block_t l_block;
+    uint32_t l_block_len = p_reader->header.block_len;
+
+    if (fread(&l_block, sizeof(l_block), 1, p_reader->file) != 1 || l_block.sample_count > l_block_len
+        || l_block.payload_bytes > max_payload(l_block_len) || l_block.order > CODEC_MAX_ORDER
+        || l_block.mode > BLOCK_RAW
+        || (l_block.mode == BLOCK_RAW && l_block.payload_bytes != l_block.sample_count * sizeof(float32_t))
+        || fread(p_reader->payload, 1, l_block.payload_bytes, p_reader->file) != l_block.payload_bytes)
+    {
+        printf("Error. Compressed block %llu is damaged.\n", (unsigned long long)p_reader->next_block);
+        return false;
+    }
+
+    uint32_t l_len = l_block.sample_count;
+    if (l_block.mode == BLOCK_RAW)
+    {
+        memcpy(p_reader->samples, p_reader->payload, l_len * sizeof(float32_t));
+        p_reader->decoded = l_len;
+        p_reader->pos = 0;
+        p_reader->next_block++;
+        return true;
+    }
+
+    uint32_t *l_values = p_reader->values;
+    const uint8_t *l_in = p_reader->payload;
+    for (uint32_t g = 0; g < l_len; g += CODEC_GROUP)
+    {
+        uint32_t l_n = (l_len - g < CODEC_GROUP) ? l_len - g : CODEC_GROUP;
+        uint32_t l_width = *l_in++;
+        if (l_width > 32)
+            return false;
+        l_in = unpack_group(l_in, l_n, l_width, &l_values[g]);
+    }
+
+    float32_t *l_samples = p_reader->samples;
+    if (l_block.mode == BLOCK_QUANTISED)
+    {
+        uint32_t l_prev1 = 0, l_prev2 = 0, l_prev3 = 0;
+        for (uint32_t i = 0; i < l_len; i++)
+        {
+            uint32_t l_r = (l_values[i] >> 1) ^ (0U - (l_values[i] & 1U));
+            uint32_t l_value = l_r + predict(l_block.order, l_prev1, l_prev2, l_prev3);
+            l_samples[i] = (float32_t)((double)(int32_t)l_value * p_reader->header.step);
+            l_prev3 = l_prev2;
+            l_prev2 = l_prev1;
+            l_prev1 = l_value;
+        }
+    }
+    else
+    {
+        float32_t l_prev1 = 0.0f, l_prev2 = 0.0f, l_prev3 = 0.0f;
+        for (uint32_t i = 0; i < l_len; i++)
+        {
+            uint32_t l_r = (l_values[i] >> 1) ^ (0U - (l_values[i] & 1U));
+            l_samples[i] = ordered_to_float(l_r + float_to_ordered(predict_float(l_block.order, l_prev1, l_prev2,
+                                                                                 l_prev3)));
+            l_prev3 = l_prev2;
+            l_prev2 = l_prev1;
+            l_prev1 = l_samples[i];
+        }
+    }
+
+    p_reader->decoded = l_len;
+    p_reader->pos = 0;
+    p_reader->next_block++;
+    return true;
+}
+
+/**
+ * @brief Moves the reader to sample p_sample, decoding only the block that holds it.
+ *
+ * @return false if p_sample is past the end or the block is damaged.
+ */
+bool seek_codec_reader(FIR_codec_reader_t *p_reader, uint64_t p_sample)
+{
+    if (p_sample > p_reader->header.sample_count)
+        return false;
+
+    uint64_t l_block = p_sample / p_reader->header.block_len;
+    p_reader->decoded = 0;
+    p_reader->pos = 0;
+    p_reader->next_block = l_block;
+    if (l_block == p_reader->block_count)
+        return true;
+
+    if (fseeko(p_reader->file, (off_t)p_reader->index[l_block], SEEK_SET) != 0 || !decode_block(p_reader))
+        return false;
+    p_reader->pos = (uint32_t)(p_sample % p_reader->header.block_len);
+    return true;
+}
+
+/**
+ * @brief Decodes up to p_count samples from the current position.
+ *
+ * @return The number of samples read; fewer than p_count at the end of the file or on a damaged block.
+ */
+uint64_t read_codec_samples(FIR_codec_reader_t *p_reader, float32_t *p_samples, uint64_t p_count)
+{
+    uint64_t l_done = 0;
+
+    while (l_done < p_count)
+    {
+        if (p_reader->pos == p_reader->decoded)
+        {
+            if (p_reader->next_block == p_reader->block_count || !decode_block(p_reader))
+                break;
+        }
+
+        uint32_t l_avail = p_reader->decoded - p_reader->pos;
+        uint32_t l_len = (p_count - l_done < l_avail) ? (uint32_t)(p_count - l_done) : l_avail;
+        memcpy(&p_samples[l_done], &p_reader->samples[p_reader->pos], l_len * sizeof(float32_t));
+        p_reader->pos += l_len;
+        l_done += l_len;
+    }
+
+    return l_done;
+}
+
+/**
+ * @brief Closes a reader. Accepts NULL.
+ */
+void close_codec_reader(FIR_codec_reader_t *p_reader)
+{
+    if (p_reader == NULL)
+        return;
+
+    if (p_reader->file != NULL)
+        fclose(p_reader->file);
+    free(p_reader->index);
+    free(p_reader->samples);
+    free(p_reader->values);
+    free(p_reader->payload);
+    free(p_reader);
+}
+
+/**
+ * @brief Prints the size of a compressed file against float32 samples.
+ */
+void print_codec_report(const char *p_label, const FIR_codec_report_t *p_report)
+{
+    double l_raw = (double)p_report->samples * sizeof(float32_t);
+    printf("Compressed %s: %llu samples in %llu bytes, %.2f bits/sample, ratio %.2f, %llu/%llu blocks lossy\n",
+           p_label, (unsigned long long)p_report->samples, (unsigned long long)p_report->bytes,
+           p_report->samples ? 8.0 * (double)p_report->bytes / (double)p_report->samples : 0.0,
+           p_report->bytes ? l_raw / (double)p_report->bytes : 0.0,
+           (unsigned long long)p_report->lossy_blocks, (unsigned long long)p_report->blocks);
+}
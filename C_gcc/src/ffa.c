@@ -0,0 +1,564 @@
+/**
+ * @file ffa.c
+ * @brief Parallel fast FIR decompositions: construction, cost model and kernel.
+ */
+
+#include "ffa.h"
+#include "fir_target.h"
+#include "arena.h"
+#include "realtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FFA_ROW_ALIGN  16U  /* floats; rows start on a cache line */
+
+/*
+ * Cost of a product beyond its taps, in multiplies: its pre-addition pass,
+ * the set-up of its tiles and the row of outputs written and read back by
+ * the post-additions. Fitted to timings of every decomposition of the bank
+ * filters on an AVX-512 machine, where the deeper ones gained much less
+ * than their multiply counts suggest.
+ */
+#define FFA_PRODUCT_OVERHEAD  16U
+
+typedef struct {
+    uint8_t   product;
+    uint8_t   delay;    /* 1: the product's previous decimated output */
+    float32_t weight;
+} ffa_term_t;
+
+/*
+ * A decomposition as pre- and post-addition matrices. Product m runs over
+ * the sum of the input phases set in pre[m] (the same sum of tap phases
+ * forms its sub-filter); output phase j is the weighted sum of post[j].
+ */
+typedef struct {
+    uint32_t   parallel;
+    uint32_t   products;
+    uint16_t   pre[FFA_MAX_PRODUCTS];
+    uint32_t   post_count[FFA_MAX_PARALLEL];
+    ffa_term_t post[FFA_MAX_PARALLEL][2 * FFA_MAX_PRODUCTS];
+} ffa_algorithm_t;
+
+struct FIR_ffa {
+    ffa_algorithm_t alg;
+    uint32_t   factors[FFA_MAX_LEVELS];
+    uint32_t   levels;
+    uint32_t   coeff_len;
+    uint32_t   sub_len;       /* K = ceil(coeff_len / parallel) taps per sub-filter */
+    uint32_t   block_len;
+    uint32_t   row_len;       /* block_len / parallel + sub_len, rounded up */
+    uint32_t   out_len;       /* block_len / parallel + 1, rounded up */
+    float32_t *sub_coeffs;    /* products rows of sub_len taps */
+    float32_t *phases;        /* parallel rows of decimated input, sub_len history first */
+    float32_t *stream;        /* one pre-added row, then reused for the post-additions */
+    float32_t *outputs;       /* products rows: the previous decimated output, then the block's */
+};
+
+/* 2-parallel: H0 X0, H1 X1, (H0+H1)(X0+X1) */
+static const uint16_t g_pre2[3] = { 0x1, 0x2, 0x3 };
+static const int8_t g_post2[3][3] = {
+    {  1,  0, 0 },
+    { -1, -1, 1 },
+    {  0,  1, 0 }
+};
+
+/*
+ * 3-parallel: H0 X0, H1 X1, H2 X2, (H0+H1)(X0+X1), (H1+H2)(X1+X2), (H0+H1+H2)(X0+X1+X2).
+ * The middle coefficient H0 X2 + H1 X1 + H2 X0 is the last product less the
+ * two before it, which both hold H1 X1, so H1 X1 is added back twice.
+ */
+static const uint16_t g_pre3[6] = { 0x1, 0x2, 0x4, 0x3, 0x6, 0x7 };
+static const int8_t g_post3[5][6] = {
+    {  1,  0,  0,  0,  0, 0 },
+    { -1, -1,  0,  1,  0, 0 },
+    {  0,  2,  0, -1, -1, 1 },
+    {  0, -1, -1,  0,  1, 0 },
+    {  0,  0,  1,  0,  0, 0 }
+};
+
+
+/* ------------------------------------------------------------------------- */
+/* Decompositions                                                            */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Nests the 2- and 3-parallel algorithms, first factor innermost.
+ *
+ * A level of factor f treats the polynomial of the levels so far as its
+ * coefficients: input phase i + L*i_f, product m + M*m_f, and output
+ * coefficient s + L*s_f of the product polynomial (degree 2L*f - 2).
+ * Output phase j then adds coefficient j + L*f, one decimated sample late.
+ *
+ * @return false if the factors are not 2s and 3s or exceed the limits.
+ */
+static bool build_algorithm(const uint32_t *p_factors, uint32_t p_levels, ffa_algorithm_t *p_alg)
+{
+    int16_t l_post[2 * FFA_MAX_PARALLEL][FFA_MAX_PRODUCTS];
+    int16_t l_next[2 * FFA_MAX_PARALLEL][FFA_MAX_PRODUCTS];
+    uint32_t L = 1;
+    uint32_t M = 1;
+
+    if (p_levels == 0 || p_levels > FFA_MAX_LEVELS)
+        return false;
+
+    memset(p_alg, 0, sizeof(*p_alg));
+    memset(l_post, 0, sizeof(l_post));
+    p_alg->pre[0] = 0x1;
+    l_post[0][0] = 1;
+
+    for (uint32_t l = 0; l < p_levels; l++)
+    {
+        uint32_t f = p_factors[l];
+        if ((f != 2 && f != 3) || L * f > FFA_MAX_PARALLEL)
+            return false;
+
+        uint32_t l_products = (f == 2) ? 3 : 6;
+        const uint16_t *l_pre = (f == 2) ? g_pre2 : g_pre3;
+        if (M * l_products > FFA_MAX_PRODUCTS)
+            return false;
+
+        uint16_t l_masks[FFA_MAX_PRODUCTS];
+        for (uint32_t mf = 0; mf < l_products; mf++)
+        {
+            for (uint32_t m = 0; m < M; m++)
+            {
+                uint16_t l_mask = 0;
+                for (uint32_t i_f = 0; i_f < f; i_f++)
+                {
+                    if (l_pre[mf] & (1U << i_f))
+                        l_mask |= (uint16_t)(p_alg->pre[m] << (L * i_f));
+                }
+                l_masks[m + M * mf] = l_mask;
+            }
+        }
+
+        memset(l_next, 0, sizeof(l_next));
+        for (uint32_t sf = 0; sf < 2 * f - 1; sf++)
+        {
+            for (uint32_t mf = 0; mf < l_products; mf++)
+            {
+                int32_t l_outer = (f == 2) ? g_post2[sf][mf] : g_post3[sf][mf];
+                if (l_outer == 0)
+                    continue;
+                for (uint32_t s = 0; s < 2 * L - 1; s++)
+                {
+                    for (uint32_t m = 0; m < M; m++)
+                    {
+                        l_next[s + L * sf][m + M * mf] += (int16_t)(l_outer * l_post[s][m]);
+                    }
+                }
+            }
+        }
+
+        L *= f;
+        M *= l_products;
+        memcpy(p_alg->pre, l_masks, M * sizeof(uint16_t));
+        memcpy(l_post, l_next, sizeof(l_post));
+    }
+
+    p_alg->parallel = L;
+    p_alg->products = M;
+
+    for (uint32_t j = 0; j < L; j++)
+    {
+        for (uint32_t d = 0; d < 2; d++)
+        {
+            uint32_t s = j + d * L;
+            if (s > 2 * L - 2)
+                continue;
+            for (uint32_t m = 0; m < M; m++)
+            {
+                if (l_post[s][m] == 0)
+                    continue;
+                ffa_term_t *l_term = &p_alg->post[j][p_alg->post_count[j]++];
+                l_term->product = (uint8_t)m;
+                l_term->delay = (uint8_t)d;
+                l_term->weight = (float32_t)l_post[s][m];
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Additions per block of L outputs spent outside the sub-filters.
+ */
+static uint32_t algorithm_additions(const ffa_algorithm_t *p_alg)
+{
+    uint32_t l_adds = 0;
+
+    for (uint32_t m = 0; m < p_alg->products; m++)
+    {
+        l_adds += (uint32_t)__builtin_popcount(p_alg->pre[m]) - 1;
+    }
+    for (uint32_t j = 0; j < p_alg->parallel; j++)
+    {
+        l_adds += p_alg->post_count[j] - 1;
+    }
+
+    return l_adds;
+}
+
+/**
+ * @brief Operations per output of a decomposition, in the units of the plan cost model.
+ *
+ * The sub-filter multiplies, M * ceil(N/L) / L, plus FFA_PRODUCT_OVERHEAD
+ * per product and the pre- and post-additions: direct form would count N.
+ *
+ * @return The cost, or UINT32_MAX if the factors are not valid.
+ */
+uint32_t ffa_cost(uint32_t p_coeff_len, const uint32_t *p_factors, uint32_t p_levels)
+{
+    ffa_algorithm_t l_alg;
+    if (!build_algorithm(p_factors, p_levels, &l_alg))
+        return UINT32_MAX;
+
+    uint32_t L = l_alg.parallel;
+    uint32_t K = (p_coeff_len + L - 1) / L;
+    uint32_t l_ops = l_alg.products * (K + FFA_PRODUCT_OVERHEAD) + algorithm_additions(&l_alg);
+
+    return (l_ops + L - 1) / L;
+}
+
+/**
+ * @brief Picks the cheapest decomposition for a filter length.
+ *
+ * Every nesting of 2- and 3-parallel levels up to FFA_MAX_LEVELS deep and
+ * FFA_MAX_PARALLEL wide is costed; on a tie the shallower one wins.
+ *
+ * @param[in] p_coeff_len Number of taps.
+ * @param[out] p_factors FFA_MAX_LEVELS entries; the factors, innermost first.
+ *
+ * @return Number of levels written to p_factors.
+ */
+uint32_t choose_ffa_factors(uint32_t p_coeff_len, uint32_t *p_factors)
+{
+    uint32_t l_best_cost = UINT32_MAX;
+    uint32_t l_best_levels = 1;
+    p_factors[0] = 2;
+
+    for (uint32_t l_levels = 1; l_levels <= FFA_MAX_LEVELS; l_levels++)
+    {
+        // Each level is 2 or 3: bit l of c picks the factor of level l
+        for (uint32_t c = 0; c < (1U << l_levels); c++)
+        {
+            uint32_t l_factors[FFA_MAX_LEVELS];
+            for (uint32_t l = 0; l < l_levels; l++)
+            {
+                l_factors[l] = (c & (1U << l)) ? 3U : 2U;
+            }
+
+            uint32_t l_cost = ffa_cost(p_coeff_len, l_factors, l_levels);
+            if (l_cost < l_best_cost)
+            {
+                l_best_cost = l_cost;
+                l_best_levels = l_levels;
+                memcpy(p_factors, l_factors, l_levels * sizeof(uint32_t));
+            }
+        }
+    }
+
+    return l_best_levels;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Engine                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t round_row(uint32_t p_len)
+{
+    return (p_len + FFA_ROW_ALIGN - 1) / FFA_ROW_ALIGN * FFA_ROW_ALIGN;
+}
+
+/**
+ * @brief Builds the sub-filters and buffers of a decomposition for blocks of up to p_block_len samples.
+ *
+ * The taps are zero-padded to a multiple of L; sub-filter m is the sum of
+ * the tap phases in its pre-addition, the same sum its input stream gets.
+ *
+ * @param[in] p_coeffs Pointer to the filter coefficients; they are not kept.
+ * @param[in] p_coeff_len Number of coefficients.
+ * @param[in] p_block_len Largest number of outputs run_ffa() is given at once.
+ * @param[in] p_factors Factors of the levels, innermost first, each 2 or 3.
+ * @param[in] p_levels Number of levels.
+ *
+ * @return The new decomposition, or NULL on failure.
+ */
+FIR_ffa_t *create_ffa(const float32_t *p_coeffs, uint32_t p_coeff_len, uint32_t p_block_len,
+                      const uint32_t *p_factors, uint32_t p_levels)
+{
+    ffa_algorithm_t l_alg;
+    if (p_coeff_len == 0 || !build_algorithm(p_factors, p_levels, &l_alg))
+    {
+        printf("Error. A fast FIR decomposition needs 1 to %u levels of 2 or 3, at most %u wide.\n",
+               FFA_MAX_LEVELS, FFA_MAX_PARALLEL);
+        return NULL;
+    }
+
+    FIR_ffa_t *l_ffa = arena_calloc(1, sizeof(FIR_ffa_t));
+    if (l_ffa == NULL)
+        return NULL;
+
+    uint32_t L = l_alg.parallel;
+    uint32_t M = l_alg.products;
+    uint32_t K = (p_coeff_len + L - 1) / L;
+
+    l_ffa->alg = l_alg;
+    memcpy(l_ffa->factors, p_factors, p_levels * sizeof(uint32_t));
+    l_ffa->levels = p_levels;
+    l_ffa->coeff_len = p_coeff_len;
+    l_ffa->sub_len = K;
+    l_ffa->block_len = p_block_len;
+    l_ffa->row_len = round_row(p_block_len / L + K);
+    l_ffa->out_len = round_row(p_block_len / L + 1);
+    l_ffa->sub_coeffs = arena_calloc((size_t)M * K, sizeof(float32_t));
+    l_ffa->phases = arena_alloc((size_t)L * l_ffa->row_len * sizeof(float32_t));
+    l_ffa->stream = arena_alloc((size_t)l_ffa->row_len * sizeof(float32_t));
+    l_ffa->outputs = arena_alloc((size_t)M * l_ffa->out_len * sizeof(float32_t));
+
+    if (l_ffa->sub_coeffs == NULL || l_ffa->phases == NULL || l_ffa->stream == NULL || l_ffa->outputs == NULL)
+    {
+        printf("Error. Not able to allocate a fast FIR decomposition of %u sub-filters.\n", M);
+        destroy_ffa(l_ffa);
+        return NULL;
+    }
+    prefault_memory(l_ffa->phases, (size_t)L * l_ffa->row_len * sizeof(float32_t));
+    prefault_memory(l_ffa->stream, (size_t)l_ffa->row_len * sizeof(float32_t));
+    prefault_memory(l_ffa->outputs, (size_t)M * l_ffa->out_len * sizeof(float32_t));
+
+    for (uint32_t m = 0; m < M; m++)
+    {
+        float32_t *l_sub = &l_ffa->sub_coeffs[m * K];
+        for (uint32_t i = 0; i < L; i++)
+        {
+            if ((l_alg.pre[m] & (1U << i)) == 0)
+                continue;
+            for (uint32_t t = 0; t < K && t * L + i < p_coeff_len; t++)
+            {
+                l_sub[t] += p_coeffs[t * L + i];
+            }
+        }
+    }
+
+    return l_ffa;
+}
+
+/**
+ * @brief Number of outputs L computed together; run_ffa() handles multiples of it.
+ */
+uint32_t ffa_parallelism(const FIR_ffa_t *p_ffa)
+{
+    return p_ffa->alg.parallel;
+}
+
+/**
+ * @brief Copies the factors of the levels, innermost first, into p_factors.
+ *
+ * @param[out] p_factors FFA_MAX_LEVELS entries.
+ *
+ * @return Number of levels.
+ */
+uint32_t ffa_factors(const FIR_ffa_t *p_ffa, uint32_t *p_factors)
+{
+    memcpy(p_factors, p_ffa->factors, p_ffa->levels * sizeof(uint32_t));
+    return p_ffa->levels;
+}
+
+/**
+ * @brief Sub-filter multiplies per output, M * K / L rounded up.
+ */
+uint32_t ffa_multiplies(const FIR_ffa_t *p_ffa)
+{
+    uint32_t L = p_ffa->alg.parallel;
+    return (p_ffa->alg.products * p_ffa->sub_len + L - 1) / L;
+}
+
+/**
+ * @brief Cost of the decomposition per output, as ffa_cost().
+ */
+uint32_t ffa_plan_cost(const FIR_ffa_t *p_ffa)
+{
+    return ffa_cost(p_ffa->coeff_len, p_ffa->factors, p_ffa->levels);
+}
+
+/**
+ * @brief Writes the factors as text, e.g. "2x3", innermost first.
+ */
+void describe_ffa(const FIR_ffa_t *p_ffa, char *p_text, uint32_t p_text_len)
+{
+    uint32_t l_used = 0;
+
+    p_text[0] = '\0';
+    for (uint32_t l = 0; l < p_ffa->levels && l_used < p_text_len; l++)
+    {
+        l_used += (uint32_t)snprintf(&p_text[l_used], p_text_len - l_used, l ? "x%u" : "%u", p_ffa->factors[l]);
+    }
+}
+
+/*
+ * The passes over the decimated rows work FIR_TILE samples at a time into a
+ * local accumulator, like the plan kernels, so that each one vectorises
+ * without the compiler having to prove the rows do not overlap.
+ */
+#define TILE_INLINE static inline __attribute__((always_inline))
+
+/* Pre-addition: sum of the phase rows set in p_mask, samples p_r .. p_r+p_width-1 */
+TILE_INLINE void pre_add_tile(const float32_t *p_phases, uint32_t p_row_len, uint32_t p_mask, uint32_t p_r,
+                              uint32_t p_width, float32_t *p_sum)
+{
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+
+    for (; p_mask != 0; p_mask &= p_mask - 1)
+    {
+        const float32_t *l_row = &p_phases[(uint32_t)__builtin_ctz(p_mask) * p_row_len + p_r];
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_row[j];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_sum[p_r + j] = l_acc[j];
+    }
+}
+
+/* Sub-filter: as direct_tile in plan.c, FIR_TILE consecutive decimated outputs, taps in the outer loop */
+TILE_INLINE void sub_filter_tile(const float32_t *p_u, uint32_t p_width, const float32_t *h, uint32_t K,
+                                 float32_t *p_y)
+{
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+
+    for (uint32_t t = 0; t < K; t++)
+    {
+        const float32_t *l_ut = p_u - t;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_ut[j] * h[t];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[j] = l_acc[j];
+    }
+}
+
+/* Post-addition of output phase p_j for decimated outputs p_k .. p_k+p_width-1, stored interleaved */
+TILE_INLINE void post_add_tile(const FIR_ffa_t *p_ffa, uint32_t p_j, uint32_t p_k, uint32_t p_width,
+                               float32_t *p_y)
+{
+    const ffa_term_t *l_terms = p_ffa->alg.post[p_j];
+    uint32_t L = p_ffa->alg.parallel;
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+
+    for (uint32_t e = 0; e < p_ffa->alg.post_count[p_j]; e++)
+    {
+        // Row index k + 1 is decimated output k; a delayed term reads k - 1
+        const float32_t *l_prod = &p_ffa->outputs[l_terms[e].product * p_ffa->out_len + p_k + 1 - l_terms[e].delay];
+        float32_t l_weight = l_terms[e].weight;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_weight * l_prod[j];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[(p_k + j) * L + p_j] = l_acc[j];
+    }
+}
+
+/**
+ * @brief Filters the first multiple of L samples of a block with the decomposition.
+ *
+ * Reads p_x[-(K*L)] .. p_x[p_len-1]: the coeff_len-1 history of a plan's
+ * work buffer and up to FFA_SLACK samples before it, which only ever meet
+ * the zero padding of the taps. Output phase j of decimated output k is
+ * the weighted sum of its products at k and, for the wrapped terms, k-1.
+ *
+ * @param[in,out] p_ffa Pointer to the decomposition; its phase, stream and output buffers are overwritten.
+ * @param[in] p_x Block of input samples, preceded by the history.
+ * @param[in] p_len Number of samples, at most the block length.
+ * @param[out] p_y Output array; p_y[0] .. p_y[return-1] are written.
+ *
+ * @return Number of outputs written, p_len rounded down to a multiple of L.
+ */
+FIR_MULTIVERSION
+uint32_t run_ffa(FIR_ffa_t *p_ffa, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    const ffa_algorithm_t *l_alg = &p_ffa->alg;
+    uint32_t L = l_alg->parallel;
+    uint32_t K = p_ffa->sub_len;
+    uint32_t Q = p_len / L;
+    uint32_t R = Q + K;
+    uint32_t n;
+
+    if (Q == 0)
+        return 0;
+
+    // Decimate: row i holds x[(r - K) * L + i]
+    const float32_t *l_base = p_x - (int64_t)K * L;
+    for (uint32_t i = 0; i < L; i++)
+    {
+        float32_t *l_row = &p_ffa->phases[i * p_ffa->row_len];
+        for (uint32_t r = 0; r < R; r++)
+        {
+            l_row[r] = l_base[r * L + i];
+        }
+    }
+
+    // Products: pre-add the stream, then run the sub-filter over decimated outputs -1 .. Q-1
+    for (uint32_t m = 0; m < l_alg->products; m++)
+    {
+        uint32_t l_mask = l_alg->pre[m];
+        const float32_t *l_u = &p_ffa->phases[(uint32_t)__builtin_ctz(l_mask) * p_ffa->row_len];
+
+        if ((l_mask & (l_mask - 1)) != 0)
+        {
+            for (n = 0; n + FIR_TILE <= R; n += FIR_TILE)
+                pre_add_tile(p_ffa->phases, p_ffa->row_len, l_mask, n, FIR_TILE, p_ffa->stream);
+            if (n < R)
+                pre_add_tile(p_ffa->phases, p_ffa->row_len, l_mask, n, R - n, p_ffa->stream);
+            l_u = p_ffa->stream;
+        }
+
+        const float32_t *h = &p_ffa->sub_coeffs[m * K];
+        const float32_t *l_in = &l_u[K - 1];
+        float32_t *l_out = &p_ffa->outputs[m * p_ffa->out_len];
+
+        for (n = 0; n + FIR_TILE <= Q + 1; n += FIR_TILE)
+            sub_filter_tile(&l_in[n], FIR_TILE, h, K, &l_out[n]);
+        if (n < Q + 1)
+            sub_filter_tile(&l_in[n], Q + 1 - n, h, K, &l_out[n]);
+    }
+
+    for (uint32_t j = 0; j < L; j++)
+    {
+        for (n = 0; n + FIR_TILE <= Q; n += FIR_TILE)
+            post_add_tile(p_ffa, j, n, FIR_TILE, p_y);
+        if (n < Q)
+            post_add_tile(p_ffa, j, n, Q - n, p_y);
+    }
+
+    return Q * L;
+}
+
+/**
+ * @brief Releases a decomposition. Accepts NULL.
+ */
+void destroy_ffa(FIR_ffa_t *p_ffa)
+{
+    if (p_ffa == NULL)
+        return;
+
+    arena_free(p_ffa->sub_coeffs);
+    arena_free(p_ffa->phases);
+    arena_free(p_ffa->stream);
+    arena_free(p_ffa->outputs);
+    arena_free(p_ffa);
+}
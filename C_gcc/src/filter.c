@@ -133,11 +133,19 @@ void generate_signal(uint32_t *p_input, uint32_t p_input_len, float32_t *p_outpu
  * @return void
  */
 void filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output)
+{
+    filter_signal64(p_input, p_input_len, p_filter, p_output);
+}
+
+/**
+ * @brief Same as filter_signal, with a 64-bit length for signals of 4G samples or more.
+ */
+void filter_signal64(float32_t *p_input, uint64_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output)
 {
     uint32_t N = p_filter->coeff_b_len;
     float32_t *h = p_filter->coeff_b_ptr;
 
-    for (uint32_t n = 0; n < p_input_len; n++) 
+    for (uint64_t n = 0; n < p_input_len; n++) 
     {
         float32_t l_acc = 0.0f;
 
@@ -172,6 +180,14 @@ void filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *p_fil
  * @note Filter coefficients must exhibit symmetry: h[k] = h[N-1-k].
  */
 void symm_filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output) 
+{
+    symm_filter_signal64(p_input, p_input_len, p_filter, p_output);
+}
+
+/**
+ * @brief Same as symm_filter_signal, with a 64-bit length for signals of 4G samples or more.
+ */
+void symm_filter_signal64(float32_t *p_input, uint64_t p_input_len, FIR_filter_t *p_filter, float32_t *p_output) 
 {
     uint32_t N = p_filter->coeff_b_len;
     float32_t *h = p_filter->coeff_b_ptr;
@@ -179,7 +195,7 @@ void symm_filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *
 
     uint32_t l_half_len = (N / 2);
     
-    for (uint32_t n = 0; n < p_input_len; n++) 
+    for (uint64_t n = 0; n < p_input_len; n++) 
     {
         float32_t l_acc = 0.0f;
         
@@ -211,6 +227,217 @@ void symm_filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *
 }
 
 
+/**
+ * @brief Maps a logical delay-line position onto the physical ring slot.
+ *
+ * @param p_head Physical slot currently holding the oldest sample.
+ * @param p_pos Logical position, 0 being the oldest sample.
+ * @param p_ring_len Number of samples held by the ring.
+ *
+ * @return Physical index into the ring buffer.
+ */
+static inline uint32_t ring_index(uint32_t p_head, uint32_t p_pos, uint32_t p_ring_len)
+{
+    uint32_t l_idx = p_head + p_pos;
+    return (l_idx >= p_ring_len) ? (l_idx - p_ring_len) : l_idx;
+}
+
+/**
+ * @brief Reverses a run of samples in place.
+ */
+static void reverse_samples(float32_t *p_data, uint32_t p_len)
+{
+    uint32_t i = 0;
+    uint32_t j = p_len;
+    while (i + 1 < j)
+    {
+        j--;
+        float32_t l_tmp = p_data[i];
+        p_data[i] = p_data[j];
+        p_data[j] = l_tmp;
+        i++;
+    }
+}
+
+/**
+ * @brief Core of the in-place filters, operating on a strided signal.
+ *
+ * The history buffer is used as a ring of the last N-1 inputs while the block
+ * is processed, so each output can overwrite its own input as soon as it has
+ * been computed. On return the ring is rotated back so that p_history holds
+ * the last N-1 inputs in chronological order, ready for the next block.
+ *
+ * @param[in,out] p_signal Pointer to the first sample of the signal.
+ * @param[in] p_signal_len Number of samples to process.
+ * @param[in] p_stride Distance between consecutive samples in p_signal.
+ * @param[in] p_filter Pointer to the FIR filter structure.
+ * @param[in,out] p_history N-1 sample history, oldest sample first.
+ * @param[in] p_symmetric Use the folded symmetric tap evaluation.
+ */
+static void inplace_filter_core(float32_t *p_signal, uint64_t p_signal_len, uint64_t p_stride,
+                                FIR_filter_t *p_filter, float32_t *p_history, bool p_symmetric)
+{
+    uint32_t N = p_filter->coeff_b_len;
+    float32_t *h = p_filter->coeff_b_ptr;
+    uint32_t M = N - 1;
+    uint32_t l_head = 0;
+    uint32_t l_half_len = (N / 2);
+    bool l_is_odd = (N % 2 != 0);
+
+    if (M == 0)
+    {
+        for (uint64_t n = 0; n < p_signal_len; n++)
+        {
+            p_signal[n * p_stride] *= h[0];
+        }
+        return;
+    }
+
+    for (uint64_t n = 0; n < p_signal_len; n++)
+    {
+        float32_t *l_sample = &p_signal[n * p_stride];
+        float32_t l_x0 = *l_sample;
+        float32_t l_acc = 0.0f;
+
+        if (p_symmetric)
+        {
+            // Pair x[n-k] with x[n-(N-1-k)]; the latter sits at logical position k
+            for (uint32_t k = 0; k < l_half_len; k++)
+            {
+                float32_t l_newer = (k == 0) ? l_x0 : p_history[ring_index(l_head, M - k, M)];
+                float32_t l_older = p_history[ring_index(l_head, k, M)];
+                l_acc += (l_newer + l_older) * h[k];
+            }
+
+            if (l_is_odd)
+            {
+                l_acc += p_history[ring_index(l_head, M - l_half_len, M)] * h[l_half_len];
+            }
+        }
+        else
+        {
+            l_acc += l_x0 * h[0];
+
+            // x[n-k] for k = 1..head lives in ring[head-1] down to ring[0] ...
+            uint32_t k = 1;
+            for (; k <= l_head; k++)
+            {
+                l_acc += p_history[l_head - k] * h[k];
+            }
+            // ... and the remaining taps wrap round to ring[M-1] down to ring[head]
+            for (; k < N; k++)
+            {
+                l_acc += p_history[l_head + M - k] * h[k];
+            }
+        }
+
+        // Retire the oldest sample and store the new one in its slot
+        p_history[l_head] = l_x0;
+        l_head = (l_head + 1 == M) ? 0 : l_head + 1;
+
+        *l_sample = l_acc;
+    }
+
+    // Rotate the ring left by l_head so the history is linear again
+    reverse_samples(p_history, l_head);
+    reverse_samples(&p_history[l_head], M - l_head);
+    reverse_samples(p_history, M);
+}
+
+/**
+ * @brief Applies a FIR filter to a signal in place.
+ *
+ * The filtered output overwrites the input. Only the N-1 sample history buffer
+ * is needed as scratch, so the working set is halved compared with
+ * filter_signal. Consecutive calls with the same history continue the stream
+ * without a start-up transient.
+ *
+ * @param[in,out] p_signal Pointer to the signal; overwritten with the filtered output.
+ * @param[in] p_signal_len Length of the signal.
+ * @param[in] p_filter Pointer to the FIR filter structure containing coefficients.
+ * @param[in,out] p_history Buffer of p_filter->coeff_b_len - 1 samples holding the
+ *                          previous inputs, oldest first. Zero it before the first
+ *                          call to match filter_signal.
+ *
+ * @return void
+ */
+void filter_signal_inplace(float32_t *p_signal, uint32_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history)
+{
+    inplace_filter_core(p_signal, p_signal_len, 1, p_filter, p_history, false);
+}
+
+/**
+ * @brief Same as filter_signal_inplace, with a 64-bit length.
+ */
+void filter_signal_inplace64(float32_t *p_signal, uint64_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history)
+{
+    inplace_filter_core(p_signal, p_signal_len, 1, p_filter, p_history, false);
+}
+
+/**
+ * @brief Applies a symmetric FIR filter to a signal in place.
+ *
+ * In-place counterpart of symm_filter_signal. See filter_signal_inplace for
+ * the history buffer contract.
+ *
+ * @param[in,out] p_signal Pointer to the signal; overwritten with the filtered output.
+ * @param[in] p_signal_len Length of the signal.
+ * @param[in] p_filter Pointer to the FIR filter structure containing coefficients.
+ * @param[in,out] p_history Buffer of p_filter->coeff_b_len - 1 previous inputs.
+ *
+ * @return void
+ *
+ * @note Filter coefficients must exhibit symmetry: h[k] = h[N-1-k].
+ */
+void symm_filter_signal_inplace(float32_t *p_signal, uint32_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history)
+{
+    inplace_filter_core(p_signal, p_signal_len, 1, p_filter, p_history, true);
+}
+
+/**
+ * @brief Same as symm_filter_signal_inplace, with a 64-bit length.
+ */
+void symm_filter_signal_inplace64(float32_t *p_signal, uint64_t p_signal_len, FIR_filter_t *p_filter, float32_t *p_history)
+{
+    inplace_filter_core(p_signal, p_signal_len, 1, p_filter, p_history, true);
+}
+
+/**
+ * @brief Applies a FIR filter in place to every channel of an interleaved signal.
+ *
+ * Each channel keeps its own N-1 sample history. The symmetric kernel is used
+ * when p_filter->symmetric is set.
+ *
+ * @param[in,out] p_frames Interleaved samples, p_frame_count * p_channel_count long.
+ * @param[in] p_frame_count Number of frames (samples per channel).
+ * @param[in] p_channel_count Number of interleaved channels.
+ * @param[in] p_filter Pointer to the FIR filter structure applied to every channel.
+ * @param[in,out] p_history p_channel_count consecutive histories of
+ *                          p_filter->coeff_b_len - 1 samples each.
+ *
+ * @return void
+ */
+void filter_channels_inplace(float32_t *p_frames, uint32_t p_frame_count, uint32_t p_channel_count,
+                             FIR_filter_t *p_filter, float32_t *p_history)
+{
+    filter_channels_inplace64(p_frames, p_frame_count, p_channel_count, p_filter, p_history);
+}
+
+/**
+ * @brief Same as filter_channels_inplace, with a 64-bit frame count.
+ */
+void filter_channels_inplace64(float32_t *p_frames, uint64_t p_frame_count, uint32_t p_channel_count,
+                               FIR_filter_t *p_filter, float32_t *p_history)
+{
+    uint32_t l_history_len = p_filter->coeff_b_len - 1;
+
+    for (uint32_t c = 0; c < p_channel_count; c++)
+    {
+        inplace_filter_core(&p_frames[c], p_frame_count, p_channel_count, p_filter,
+                            &p_history[(uint64_t)c * l_history_len], p_filter->symmetric);
+    }
+}
+
 /**
  * @brief Records an array of floating-point values to a CSV file.
  * 
@@ -230,25 +457,40 @@ void symm_filter_signal(float32_t *p_input, uint32_t p_input_len, FIR_filter_t *
  *          not be portable to all systems (e.g., Windows).
  */
 void record_output(float32_t *p_output, uint32_t p_output_len, const char *p_filename)
+{
+    record_output64(p_output, p_output_len, p_filename);
+}
+
+/**
+ * @brief Same as record_output, with a 64-bit length.
+ *
+ * @return false if the file could not be opened or written completely.
+ */
+bool record_output64(float32_t *p_output, uint64_t p_output_len, const char *p_filename)
 {
     FILE *l_file = fopen(p_filename, "w");
 
     if (l_file == NULL) 
     {
         printf("Error. Not able to open file %s for writing.\n", p_filename);
-        return;
+        return false;
     }
 
-    for (uint32_t i = 0; i < p_output_len; i++) 
+    bool l_ok = true;
+    for (uint64_t i = 0; i < p_output_len && l_ok; i++) 
     {
-        fprintf(l_file, "%f,", p_output[i]);
+        l_ok = fprintf(l_file, "%f,", p_output[i]) > 0;
     }
     
     // remove trailing comma
-    fseek(l_file, -1, SEEK_END);
-    ftruncate(fileno(l_file), ftell(l_file));
+    if (l_ok && p_output_len > 0)
+        l_ok = fseek(l_file, -1, SEEK_END) == 0 && ftruncate(fileno(l_file), ftell(l_file)) == 0;
 
-    fclose(l_file);
+    l_ok = !ferror(l_file) && l_ok;
+    l_ok = (fclose(l_file) == 0) && l_ok;
+    if (!l_ok)
+        printf("Error. Not able to write file %s.\n", p_filename);
+    return l_ok;
 }
 
 
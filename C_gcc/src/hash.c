@@ -0,0 +1,27 @@
+/**
+ * @file hash.c
+ * @brief FNV-1a hash over raw bytes.
+ */
+
+#include "hash.h"
+
+/**
+ * @brief 64-bit FNV-1a hash of p_len bytes.
+ *
+ * @param[in] p_bytes Pointer to the bytes to hash.
+ * @param[in] p_len Number of bytes.
+ *
+ * @return The hash; the same for the same bytes on every platform.
+ */
+uint64_t fnv1a(const void *p_bytes, uint64_t p_len)
+{
+    const uint8_t *l_bytes = p_bytes;
+    uint64_t l_hash = FNV1A_OFFSET_BASIS;
+
+    for (uint64_t i = 0; i < p_len; i++)
+    {
+        l_hash ^= l_bytes[i];
+        l_hash *= FNV1A_PRIME;
+    }
+    return l_hash;
+}
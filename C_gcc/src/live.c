@@ -0,0 +1,252 @@
+/**
+ * @file live.c
+ * @brief Lock-free coefficient hot-swap for streaming filters.
+ */
+
+#include "live.h"
+#include "arena.h"
+#include "realtime.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Plans move through two single-slot mailboxes:
+ *
+ *   control --pending--> data      newly published plan
+ *   data    --retired--> control   plan that is no longer used
+ *
+ * The data thread adopts a pending plan only when the retired slot is empty
+ * and no crossfade is running, so it always has somewhere to put the plan
+ * it replaces. A plan published before the previous one was adopted simply
+ * replaces it and the unused one is freed by the publisher.
+ */
+struct FIR_live_filter {
+    uint32_t     max_taps;
+    uint32_t     block_len;
+    uint32_t     crossfade_len;
+    float32_t   *work;       /* max_taps-1 history samples followed by block_len samples */
+    float32_t   *faded;      /* block_len outputs of the outgoing plan during a crossfade */
+    FIR_plan_t  *current;    /* data thread only */
+    FIR_plan_t  *outgoing;   /* data thread only, non-NULL while crossfading */
+    uint32_t     fade_pos;   /* crossfade samples done */
+    _Atomic(FIR_plan_t *) pending;
+    _Atomic(FIR_plan_t *) retired;
+    _Atomic uint64_t      swaps;
+};
+
+/**
+ * @brief Plans a coefficient set on the calling (control) thread.
+ */
+static FIR_plan_t *plan_coefficients(FIR_live_filter_t *p_live, FIR_filter_t *p_filter, FIR_plan_mode_t p_mode)
+{
+    if (p_filter->coeff_b_len > p_live->max_taps)
+    {
+        printf("Error. A live filter sized for %u taps cannot take %u.\n", p_live->max_taps, p_filter->coeff_b_len);
+        return NULL;
+    }
+    return create_filter_plan(p_filter, p_live->block_len, p_mode);
+}
+
+/**
+ * @brief Creates a live filter running p_filter.
+ *
+ * @param[in] p_filter Initial coefficients; they are copied.
+ * @param[in] p_max_taps Longest filter that may ever be published; sets the history kept.
+ * @param[in] p_block_len Largest block filtered at once; swaps happen between blocks.
+ * @param[in] p_crossfade_len Samples over which the output fades from the old
+ *            coefficients to the new ones, 0 to switch at once.
+ * @param[in] p_mode How to choose the kernel of each coefficient set.
+ *
+ * @return The new live filter, or NULL on failure.
+ */
+FIR_live_filter_t *create_live_filter(FIR_filter_t *p_filter, uint32_t p_max_taps, uint32_t p_block_len,
+                                      uint32_t p_crossfade_len, FIR_plan_mode_t p_mode)
+{
+    if (p_max_taps == 0 || p_block_len == 0)
+    {
+        printf("Error. A live filter needs at least one tap and a non-empty block.\n");
+        return NULL;
+    }
+
+    FIR_live_filter_t *l_live = arena_calloc(1, sizeof(FIR_live_filter_t));
+    if (l_live == NULL)
+        return NULL;
+
+    l_live->max_taps = p_max_taps;
+    l_live->block_len = p_block_len;
+    l_live->crossfade_len = p_crossfade_len;
+    atomic_init(&l_live->pending, NULL);
+    atomic_init(&l_live->retired, NULL);
+    atomic_init(&l_live->swaps, 0);
+
+    // The plans' kernels may read FFA_SLACK samples before the history, as in a plan's own work buffer
+    l_live->work = arena_calloc(FFA_SLACK + p_max_taps - 1 + p_block_len, sizeof(float32_t));
+    l_live->faded = arena_alloc(p_block_len * sizeof(float32_t));
+    if (l_live->work != NULL)
+        l_live->work += FFA_SLACK;
+    if (l_live->work == NULL || l_live->faded == NULL)
+    {
+        printf("Error. Not able to allocate a live filter of %u taps.\n", p_max_taps);
+        destroy_live_filter(l_live);
+        return NULL;
+    }
+    prefault_memory(l_live->faded, p_block_len * sizeof(float32_t));
+
+    l_live->current = plan_coefficients(l_live, p_filter, p_mode);
+    if (l_live->current == NULL)
+    {
+        destroy_live_filter(l_live);
+        return NULL;
+    }
+
+    return l_live;
+}
+
+/**
+ * @brief Frees the plan the data thread has finished with, if any. Control thread only.
+ */
+void reclaim_live_filter(FIR_live_filter_t *p_live)
+{
+    destroy_filter_plan(atomic_exchange_explicit(&p_live->retired, NULL, memory_order_acquire));
+}
+
+/**
+ * @brief Publishes new coefficients to the running filter. Control thread only.
+ *
+ * The coefficients are planned here, so the data thread only swaps a
+ * pointer. They take effect at the data thread's next block boundary, or
+ * after the crossfade in progress; if this is called again before then, the
+ * newer set wins.
+ *
+ * @return false if the coefficients could not be planned or do not fit.
+ */
+bool publish_live_filter(FIR_live_filter_t *p_live, FIR_filter_t *p_filter, FIR_plan_mode_t p_mode)
+{
+    reclaim_live_filter(p_live);
+
+    FIR_plan_t *l_plan = plan_coefficients(p_live, p_filter, p_mode);
+    if (l_plan == NULL)
+        return false;
+
+    destroy_filter_plan(atomic_exchange_explicit(&p_live->pending, l_plan, memory_order_acq_rel));
+    return true;
+}
+
+/**
+ * @brief Adopts a pending plan if there is one and the last swap is complete.
+ */
+static void adopt_pending(FIR_live_filter_t *p_live)
+{
+    if (p_live->outgoing != NULL
+        || atomic_load_explicit(&p_live->retired, memory_order_acquire) != NULL
+        || atomic_load_explicit(&p_live->pending, memory_order_relaxed) == NULL)
+        return;
+
+    FIR_plan_t *l_next = atomic_exchange_explicit(&p_live->pending, NULL, memory_order_acquire);
+    if (l_next == NULL)
+        return;
+
+    if (p_live->crossfade_len > 0)
+    {
+        p_live->outgoing = p_live->current;
+        p_live->fade_pos = 0;
+    }
+    else
+    {
+        atomic_store_explicit(&p_live->retired, p_live->current, memory_order_release);
+    }
+
+    p_live->current = l_next;
+    atomic_fetch_add_explicit(&p_live->swaps, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Blends the outgoing output into p_output: linear ramp from old to new.
+ */
+static void crossfade_block(FIR_live_filter_t *p_live, const float32_t *p_block, uint32_t p_len, float32_t *p_output)
+{
+    p_live->outgoing->kernel_fn(p_live->outgoing, p_block, p_len, p_live->faded);
+
+    float32_t l_step = 1.0f / (float32_t)p_live->crossfade_len;
+    uint32_t i = 0;
+    for (; i < p_len && p_live->fade_pos < p_live->crossfade_len; i++)
+    {
+        float32_t l_gain = (float32_t)(++p_live->fade_pos) * l_step;
+        p_output[i] = (1.0f - l_gain) * p_live->faded[i] + l_gain * p_output[i];
+    }
+
+    if (p_live->fade_pos == p_live->crossfade_len)
+    {
+        atomic_store_explicit(&p_live->retired, p_live->outgoing, memory_order_release);
+        p_live->outgoing = NULL;
+    }
+}
+
+/**
+ * @brief Filters a signal with the current coefficients. Data thread only.
+ *
+ * Like execute_filter_plan, the history is kept between calls and
+ * p_output may alias p_input. Published coefficients are picked up at block
+ * boundaries without locking; the history carries over, so the new filter
+ * behaves as if it had been running all along.
+ *
+ * @param[in,out] p_live Pointer to the live filter.
+ * @param[in] p_input Pointer to the input signal array.
+ * @param[in] p_input_len Length of the input signal.
+ * @param[out] p_output Pointer to the output signal array; may alias p_input.
+ *
+ * @return void
+ */
+void execute_live_filter(FIR_live_filter_t *p_live, const float32_t *p_input, uint64_t p_input_len,
+                         float32_t *p_output)
+{
+    uint32_t l_history_len = p_live->max_taps - 1;
+    float32_t *l_block = &p_live->work[l_history_len];
+
+    for (uint64_t l_done = 0; l_done < p_input_len; )
+    {
+        uint32_t l_len = p_live->block_len;
+        if (p_input_len - l_done < l_len)
+            l_len = (uint32_t)(p_input_len - l_done);
+
+        adopt_pending(p_live);
+
+        memcpy(l_block, &p_input[l_done], l_len * sizeof(float32_t));
+        p_live->current->kernel_fn(p_live->current, l_block, l_len, &p_output[l_done]);
+        if (p_live->outgoing != NULL)
+            crossfade_block(p_live, l_block, l_len, &p_output[l_done]);
+
+        memmove(p_live->work, &p_live->work[l_len], l_history_len * sizeof(float32_t));
+        l_done += l_len;
+    }
+}
+
+/**
+ * @brief Number of coefficient sets adopted by the data thread so far.
+ */
+uint64_t live_filter_swaps(FIR_live_filter_t *p_live)
+{
+    return atomic_load_explicit(&p_live->swaps, memory_order_relaxed);
+}
+
+/**
+ * @brief Releases a live filter and all its plans. Accepts NULL.
+ *
+ * The data thread must have stopped calling execute_live_filter().
+ */
+void destroy_live_filter(FIR_live_filter_t *p_live)
+{
+    if (p_live == NULL)
+        return;
+
+    destroy_filter_plan(p_live->current);
+    destroy_filter_plan(p_live->outgoing);
+    destroy_filter_plan(atomic_load(&p_live->pending));
+    destroy_filter_plan(atomic_load(&p_live->retired));
+    if (p_live->work != NULL)
+        arena_free(p_live->work - FFA_SLACK);
+    arena_free(p_live->faded);
+    arena_free(p_live);
+}
@@ -0,0 +1,417 @@
+/**
+ * @file lut.c
+ * @brief Table-lookup FIR engine for small-alphabet integer inputs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lut.h"
+#include "telemetry.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LUT_READ_COST    8U  /* multiplies per table read when estimating; SIMD multiplies are cheap */
+#define MEASURE_TRIALS   5U
+#define MEASURE_MIN_NS   2000000ULL
+#define LUT_TILE         8U  /* outputs per tile; 16 accumulators spill to the stack */
+
+static const char *g_engine_names[FIR_INT_ENGINE_COUNT] = { "mac", "lut" };
+
+
+/* ------------------------------------------------------------------------- */
+/* Kernel                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Tiled like the plan kernels, LUT_TILE outputs at a time with the tables in
+ * the outer loop, so every output adds its partial sums in table order. The
+ * kernel is bound by table reads rather than arithmetic, and gathers are no
+ * faster than scalar loads, so it is not multiversioned.
+ */
+static inline __attribute__((always_inline))
+void lut_tile(const uint8_t *p_w, uint32_t p_width, const float32_t *p_tables, uint32_t p_table_len,
+              uint32_t p_group_count, uint32_t p_group_len, float32_t *p_y)
+{
+    float32_t l_acc[LUT_TILE] = { 0.0f };
+
+    for (uint32_t g = 0; g < p_group_count; g++)
+    {
+        const float32_t *l_table = &p_tables[g * p_table_len];
+        const uint8_t *l_wg = p_w - g * p_group_len;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_table[l_wg[j]];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[j] = l_acc[j];
+    }
+}
+
+/**
+ * @brief One table read per group of taps; p_w is preceded by the history windows.
+ */
+static void lut_kernel(const FIR_int_plan_t *p_plan, const uint8_t *p_w, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t n = 0;
+
+    for (; n + LUT_TILE <= p_len; n += LUT_TILE)
+        lut_tile(&p_w[n], LUT_TILE, p_plan->tables, p_plan->table_len, p_plan->group_count, p_plan->group_len, &p_y[n]);
+    if (n < p_len)
+        lut_tile(&p_w[n], p_len - n, p_plan->tables, p_plan->table_len, p_plan->group_count, p_plan->group_len, &p_y[n]);
+}
+
+/**
+ * @brief Appends the packed windows of p_len codes after the history windows.
+ */
+static void pack_windows(FIR_int_plan_t *p_plan, const uint8_t *p_codes, uint32_t p_len)
+{
+    uint8_t *l_windows = &p_plan->windows[(p_plan->group_count - 1) * p_plan->group_len];
+    uint32_t l_code_mask = (1U << p_plan->bits) - 1;
+    uint32_t l_index_mask = p_plan->table_len - 1;
+    uint32_t l_window = p_plan->window;
+
+    for (uint32_t i = 0; i < p_len; i++)
+    {
+        l_window = ((l_window << p_plan->bits) | (p_codes[i] & l_code_mask)) & l_index_mask;
+        l_windows[i] = (uint8_t)l_window;
+    }
+
+    p_plan->window = l_window;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Planning                                                                  */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Returns the printable name of an integer engine.
+ */
+const char *int_engine_name(FIR_int_engine_t p_engine)
+{
+    if (p_engine >= FIR_INT_ENGINE_COUNT)
+        return "unknown";
+    return g_engine_names[p_engine];
+}
+
+/**
+ * @brief Builds the partial-sum tables and the window buffer of the table engine.
+ *
+ * Sums are formed in double and rounded once, so each table entry is the
+ * correctly rounded partial sum of its group.
+ */
+static bool build_tables(FIR_int_plan_t *p_plan, const float32_t *p_coeffs, uint32_t p_coeff_len)
+{
+    uint32_t G = p_plan->group_len;
+    uint32_t l_code_mask = (1U << p_plan->bits) - 1;
+
+    p_plan->tables = arena_alloc((size_t)p_plan->group_count * p_plan->table_len * sizeof(float32_t));
+    p_plan->windows = arena_alloc((p_plan->group_count - 1) * G + p_plan->block_len);
+    if (p_plan->tables == NULL || p_plan->windows == NULL)
+    {
+        printf("Error. Not able to allocate lookup tables for %u taps.\n", p_coeff_len);
+        return false;
+    }
+
+    for (uint32_t g = 0; g < p_plan->group_count; g++)
+    {
+        for (uint32_t w = 0; w < p_plan->table_len; w++)
+        {
+            double l_sum = 0.0;
+            for (uint32_t i = 0; i < G && g * G + i < p_coeff_len; i++)
+            {
+                uint32_t l_code = (w >> (i * p_plan->bits)) & l_code_mask;
+                l_sum += (double)p_coeffs[g * G + i] * (double)p_plan->values[l_code];
+            }
+            p_plan->tables[g * p_plan->table_len + w] = (float32_t)l_sum;
+        }
+    }
+
+    reset_int_filter_plan(p_plan);
+    return true;
+}
+
+/**
+ * @brief Times one engine over a block of random codes and returns the best ns per block.
+ */
+static uint64_t measure_engine(FIR_int_plan_t *p_plan, FIR_int_engine_t p_engine, const uint8_t *p_codes,
+                               float32_t *p_output)
+{
+    uint64_t l_best = UINT64_MAX;
+
+    p_plan->engine = p_engine;
+    for (uint32_t t = 0; t < MEASURE_TRIALS; t++)
+    {
+        uint32_t l_reps = 0;
+        uint64_t l_start = telemetry_now_ns();
+        uint64_t l_elapsed;
+        do
+        {
+            execute_int_filter_plan(p_plan, p_codes, p_plan->block_len, p_output);
+            l_reps++;
+            l_elapsed = telemetry_now_ns() - l_start;
+        } while (l_elapsed < MEASURE_MIN_NS / MEASURE_TRIALS);
+
+        uint64_t l_per_block = l_elapsed / l_reps;
+        if (l_per_block < l_best)
+            l_best = l_per_block;
+    }
+
+    return l_best;
+}
+
+static FIR_int_engine_t measure_best_engine(FIR_int_plan_t *p_plan)
+{
+    FIR_int_engine_t l_best = FIR_INT_ENGINE_MAC;
+    uint8_t *l_codes = arena_alloc(p_plan->block_len);
+    float32_t *l_output = arena_alloc(p_plan->block_len * sizeof(float32_t));
+
+    if (l_codes != NULL && l_output != NULL)
+    {
+        uint32_t l_seed = 12345U;
+        for (uint32_t i = 0; i < p_plan->block_len; i++)
+        {
+            l_seed = l_seed * 1664525U + 1013904223U;
+            l_codes[i] = (uint8_t)(l_seed >> 24);
+        }
+
+        uint64_t l_mac_ns = measure_engine(p_plan, FIR_INT_ENGINE_MAC, l_codes, l_output);
+        uint64_t l_lut_ns = measure_engine(p_plan, FIR_INT_ENGINE_LUT, l_codes, l_output);
+        if (l_lut_ns < l_mac_ns)
+            l_best = FIR_INT_ENGINE_LUT;
+    }
+
+    arena_free(l_codes);
+    arena_free(l_output);
+    reset_int_filter_plan(p_plan);
+    return l_best;
+}
+
+/**
+ * @brief Allocates an integer plan and its MAC plan; no engine is chosen yet.
+ */
+static FIR_int_plan_t *allocate_int_plan(FIR_filter_t *p_filter, uint32_t p_bits, const float32_t *p_values,
+                                         uint32_t p_block_len, FIR_plan_mode_t p_mode)
+{
+    if (p_bits == 0 || p_bits > LUT_INDEX_BITS)
+    {
+        printf("Error. Integer inputs must have 1 to %u bits, not %u.\n", LUT_INDEX_BITS, p_bits);
+        return NULL;
+    }
+
+    FIR_int_plan_t *l_plan = arena_calloc(1, sizeof(FIR_int_plan_t));
+    if (l_plan == NULL)
+        return NULL;
+
+    l_plan->bits = p_bits;
+    l_plan->block_len = p_block_len;
+    l_plan->rest_code = 1U << p_bits;
+    for (uint32_t c = 0; c < (1U << p_bits); c++)
+    {
+        l_plan->values[c] = (p_values != NULL) ? p_values[c] : (float32_t)c;
+        if (l_plan->values[c] == 0.0f && l_plan->rest_code > c)
+            l_plan->rest_code = c;
+    }
+    if (l_plan->rest_code == (1U << p_bits))
+        l_plan->rest_code = 0;
+
+    l_plan->plan = create_filter_plan(p_filter, p_block_len, p_mode);
+    if (l_plan->plan == NULL)
+    {
+        destroy_int_filter_plan(l_plan);
+        return NULL;
+    }
+
+    l_plan->group_len = LUT_INDEX_BITS / p_bits;
+    l_plan->group_count = (p_filter->coeff_b_len + l_plan->group_len - 1) / l_plan->group_len;
+    l_plan->table_len = 1U << (l_plan->group_len * p_bits);
+    reset_int_filter_plan(l_plan);
+    return l_plan;
+}
+
+/**
+ * @brief Creates a plan for filtering blocks of up to p_block_len integer codes.
+ *
+ * With FIR_PLAN_ESTIMATE or FIR_PLAN_REPRODUCIBLE the table engine is
+ * chosen when its reads per output, weighted by LUT_READ_COST, undercut the
+ * multiplies of the plan kernel. The narrower the codes, the more taps share
+ * a table, so this favours 1 and 2 bit inputs. With FIR_PLAN_MEASURE both
+ * engines are timed and the faster one is kept.
+ *
+ * @param[in] p_filter Pointer to the FIR filter; its coefficients are copied.
+ * @param[in] p_bits Bits per input code, 1 to LUT_INDEX_BITS.
+ * @param[in] p_values Sample value of each of the 1 << p_bits codes, or NULL
+ *            to use the code itself.
+ * @param[in] p_block_len Largest number of samples filtered at once.
+ * @param[in] p_mode How to choose the engine (and the MAC kernel).
+ *
+ * @return The new plan, or NULL on failure.
+ */
+FIR_int_plan_t *create_int_filter_plan(FIR_filter_t *p_filter, uint32_t p_bits, const float32_t *p_values,
+                                       uint32_t p_block_len, FIR_plan_mode_t p_mode)
+{
+    FIR_int_plan_t *l_plan = allocate_int_plan(p_filter, p_bits, p_values, p_block_len, p_mode);
+    if (l_plan == NULL)
+        return NULL;
+
+    // A table over a single tap is a multiply in disguise
+    if (l_plan->group_len < 2)
+    {
+        l_plan->engine = FIR_INT_ENGINE_MAC;
+        return l_plan;
+    }
+
+    if (!build_tables(l_plan, p_filter->coeff_b_ptr, p_filter->coeff_b_len))
+    {
+        destroy_int_filter_plan(l_plan);
+        return NULL;
+    }
+
+    if (p_mode == FIR_PLAN_MEASURE)
+        l_plan->engine = measure_best_engine(l_plan);
+    else if (l_plan->group_count * LUT_READ_COST < filter_plan_cost(l_plan->plan))
+        l_plan->engine = FIR_INT_ENGINE_LUT;
+    else
+        l_plan->engine = FIR_INT_ENGINE_MAC;
+
+    return l_plan;
+}
+
+/**
+ * @brief Creates an integer plan that always uses the given engine.
+ */
+FIR_int_plan_t *create_int_filter_plan_with_engine(FIR_filter_t *p_filter, uint32_t p_bits, const float32_t *p_values,
+                                                   uint32_t p_block_len, FIR_int_engine_t p_engine)
+{
+    FIR_int_plan_t *l_plan = allocate_int_plan(p_filter, p_bits, p_values, p_block_len, FIR_PLAN_ESTIMATE);
+    if (l_plan == NULL)
+        return NULL;
+
+    l_plan->engine = p_engine;
+    if (p_engine == FIR_INT_ENGINE_LUT && !build_tables(l_plan, p_filter->coeff_b_ptr, p_filter->coeff_b_len))
+    {
+        destroy_int_filter_plan(l_plan);
+        return NULL;
+    }
+
+    return l_plan;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Execution                                                                 */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Filters a signal of integer codes with the plan's engine.
+ *
+ * Like execute_filter_plan, the plan keeps the history between calls, so a
+ * long signal may be passed in pieces. Codes are masked to p_plan->bits.
+ *
+ * @param[in,out] p_plan Pointer to the integer plan.
+ * @param[in] p_codes Pointer to p_len input codes.
+ * @param[in] p_len Length of the input signal.
+ * @param[out] p_output Pointer to p_len float32 outputs.
+ *
+ * @return void
+ */
+void execute_int_filter_plan(FIR_int_plan_t *p_plan, const uint8_t *p_codes, uint64_t p_len, float32_t *p_output)
+{
+    uint32_t l_code_mask = (1U << p_plan->bits) - 1;
+
+    for (uint64_t l_done = 0; l_done < p_len; )
+    {
+        uint32_t l_len = p_plan->block_len;
+        if (p_len - l_done < l_len)
+            l_len = (uint32_t)(p_len - l_done);
+
+        if (p_plan->engine == FIR_INT_ENGINE_LUT)
+        {
+            uint32_t l_history_len = (p_plan->group_count - 1) * p_plan->group_len;
+
+            pack_windows(p_plan, &p_codes[l_done], l_len);
+            lut_kernel(p_plan, &p_plan->windows[l_history_len], l_len, &p_output[l_done]);
+            memmove(p_plan->windows, &p_plan->windows[l_len], l_history_len);
+        }
+        else
+        {
+            FIR_plan_t *l_mac = p_plan->plan;
+            uint32_t l_history_len = l_mac->coeff_len - 1;
+            float32_t *l_block = &l_mac->work[l_history_len];
+
+            for (uint32_t i = 0; i < l_len; i++)
+            {
+                l_block[i] = p_plan->values[p_codes[l_done + i] & l_code_mask];
+            }
+            l_mac->kernel_fn(l_mac, l_block, l_len, &p_output[l_done]);
+            memmove(l_mac->work, &l_mac->work[l_len], l_history_len * sizeof(float32_t));
+        }
+
+        l_done += l_len;
+    }
+}
+
+/**
+ * @brief Filters p_len codes once with the plan and returns the throughput.
+ *
+ * @return Samples per second. The plan is reset afterwards.
+ */
+double benchmark_int_filter_plan(FIR_int_plan_t *p_plan, const uint8_t *p_codes, uint64_t p_len, float32_t *p_output)
+{
+    reset_int_filter_plan(p_plan);
+
+    uint64_t l_start = telemetry_now_ns();
+    execute_int_filter_plan(p_plan, p_codes, p_len, p_output);
+    uint64_t l_elapsed = telemetry_now_ns() - l_start;
+
+    reset_int_filter_plan(p_plan);
+    return (double)p_len * 1e9 / (double)(l_elapsed ? l_elapsed : 1);
+}
+
+/**
+ * @brief Clears the history so the next call starts a new signal.
+ *
+ * The history is filled with rest_code, which is a zero sample whenever the
+ * alphabet has one.
+ */
+void reset_int_filter_plan(FIR_int_plan_t *p_plan)
+{
+    uint32_t l_window = 0;
+    for (uint32_t i = 0; i < p_plan->group_len; i++)
+    {
+        l_window = (l_window << p_plan->bits) | p_plan->rest_code;
+    }
+
+    p_plan->window = l_window;
+    if (p_plan->windows != NULL)
+        memset(p_plan->windows, (int)l_window, (p_plan->group_count - 1) * p_plan->group_len + p_plan->block_len);
+
+    FIR_plan_t *l_mac = p_plan->plan;
+    if (l_mac != NULL)
+    {
+        reset_filter_plan(l_mac);
+        for (uint32_t i = 0; i < l_mac->coeff_len - 1; i++)
+        {
+            l_mac->work[i] = p_plan->values[p_plan->rest_code];
+        }
+    }
+}
+
+/**
+ * @brief Releases an integer plan and everything it owns. Accepts NULL.
+ */
+void destroy_int_filter_plan(FIR_int_plan_t *p_plan)
+{
+    if (p_plan == NULL)
+        return;
+
+    destroy_filter_plan(p_plan->plan);
+    arena_free(p_plan->tables);
+    arena_free(p_plan->windows);
+    arena_free(p_plan);
+}
@@ -4,16 +4,53 @@
 */
 
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include "filter.h"
+#include "plan.h"
+#include "precision.h"
+#include "sample_io.h"
+#include "batch.h"
+#include "stream.h"
+#include "lut.h"
+#include "live.h"
+#include "multi.h"
+#include "pipeline.h"
+#include "telemetry.h"
+#include "arena.h"
+#include "tick.h"
+#include "realtime.h"
+#include "checkpoint.h"
+#include "hash.h"
 #include "data.h"
 
 #define DATA_FILE_1 "./data1.txt"
 #define DATA_FILE_2 "./data2.txt"
+#define DATA_FILE_SWAP "./data_swap.txt"
 
 #define REG_LENGTH    9U
 #define BUFF_SIZE     900U
 #define REG1_LAST4    8874U
 #define REG2_LAST4    4642U
+#define BENCH_LEN     (1U << 20)
+#define ARENA_ROUNDS  1000U
+#define BATCH_ROUNDS  50U
+#define MAX_SEGMENTS  8U
+#define TICK_LEN      (1U << 16)
+#define JITTER_LEN    (1U << 21)
+#define JITTER_BLOCK  256U
+#define CHECKPOINT_CHANNELS  256U
+#define CHECKPOINT_LEN       (1U << 16)  /* samples per channel */
+#define CHECKPOINT_BLOCK     1024U
+#define CHECKPOINT_BLOCKS    (CHECKPOINT_LEN / CHECKPOINT_BLOCK)
+#define CHECKPOINT_EVERY     8U          /* blocks between captures */
+#define CHECKPOINT_STOP      43U         /* blocks run before the restart */
 
 FIR_filter_t g_FIR_1 = 
 {
@@ -33,36 +70,1417 @@ FIR_filter_t g_FIR_2 =
     .coeff_b_ptr = Filter_2_b_fir
 };
 
+FIR_filter_t g_FIR_1_fixed =
+{
+    .symmetric = true,
+    .coeff_b_len = Filter_1_Fixed_N_FIR_B,
+    .coeff_a_len = Filter_1_Fixed_N_FIR_A,
+    .coeff_a_ptr = Filter_1_Fixed_a_fir,
+    .coeff_b_ptr = Filter_1_Fixed_b_fir
+};
+
+FIR_filter_t g_FIR_2_fixed =
+{
+    .symmetric = true,
+    .coeff_b_len = Filter_2_Fixed_N_FIR_B,
+    .coeff_a_len = Filter_2_Fixed_N_FIR_A,
+    .coeff_a_ptr = Filter_2_Fixed_a_fir,
+    .coeff_b_ptr = Filter_2_Fixed_b_fir
+};
+
+/* Filters that batch manifests can refer to by name */
+static FIR_bank_entry_t g_bank[] =
+{
+    { "filter1", &g_FIR_1 },
+    { "filter2", &g_FIR_2 },
+    { "filter1_fixed", &g_FIR_1_fixed },
+    { "filter2_fixed", &g_FIR_2_fixed },
+};
+
+#define BANK_LEN  (sizeof(g_bank) / sizeof(g_bank[0]))
+
+/**
+ * @brief Runs the jobs of a batch manifest and prints the throughput report.
+ */
+static int run_manifest(const char *p_manifest, uint32_t p_threads, FIR_plan_mode_t p_mode)
+{
+    FIR_batch_t l_batch;
+    FIR_batch_report_t l_report;
+    FIR_batch_config_t l_config = { .thread_count = p_threads, .block_len = 4096U, .plan_mode = p_mode };
+
+    if (!load_batch_manifest(p_manifest, g_bank, BANK_LEN, &l_batch))
+        return 1;
+
+    bool l_ok = run_batch(&l_batch, g_bank, BANK_LEN, &l_config, &l_report);
+    print_batch_report(&l_report);
+    free_batch(&l_batch);
+
+    return l_ok ? 0 : 1;
+}
+
+/**
+ * @brief Builds the pipeline described by p_spec from bank filters, runs it and prints its report.
+ */
+static int run_pipeline_spec(const char *p_spec, FIR_plan_mode_t p_mode)
+{
+    FIR_pipeline_report_t l_report;
+    FIR_pipeline_t *l_pipeline = parse_pipeline(p_spec, g_bank, BANK_LEN, PIPELINE_DEFAULT_BLOCK, p_mode);
+    if (l_pipeline == NULL)
+        return 1;
+
+    bool l_ok = run_pipeline(l_pipeline, &l_report);
+    print_pipeline_report(l_pipeline, &l_report);
+    destroy_pipeline(l_pipeline);
+
+    return l_ok ? 0 : 1;
+}
+
+/**
+ * @brief Streams one sample file through a bank filter, for files larger than memory.
+ */
+static int run_stream(const char *p_input, const char *p_filter, const char *p_output, FIR_plan_mode_t p_mode)
+{
+    FIR_stream_report_t l_report;
+    FIR_filter_t *l_filter = NULL;
+
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        if (strcmp(g_bank[i].name, p_filter) == 0)
+            l_filter = g_bank[i].filter;
+    }
+    if (l_filter == NULL)
+    {
+        printf("Error. Unknown filter %s.\n", p_filter);
+        return 1;
+    }
+
+    FIR_plan_t *l_plan = create_filter_plan(l_filter, 4096U, p_mode);
+    if (l_plan == NULL)
+        return 1;
+
+    attach_plan_telemetry(l_plan, register_telemetry(p_filter));
+    bool l_ok = stream_filter_file(l_plan, p_input, p_output, NULL, &l_report);
+    if (l_ok)
+        print_stream_report(&l_report);
+    destroy_filter_plan(l_plan);
+
+    return l_ok ? 0 : 1;
+}
+
+/**
+ * @brief Prints the error of fp16 and bf16 storage against the float32 output.
+ *
+ * Coefficients and samples are rounded to the narrow type and filtered with
+ * the same kernel as p_plan, so the difference is due to storage alone.
+ */
+static void report_precision(FIR_plan_t *p_plan, FIR_filter_t *p_filter, uint32_t *p_reg,
+                             const float32_t *p_reference, const char *p_name)
+{
+    float32_t l_x[BUFF_SIZE];
+    float32_t l_y[BUFF_SIZE];
+    uint16_t l_narrow[BUFF_SIZE];
+    float32_t l_coeffs[p_filter->coeff_b_len];
+
+    generate_signal(p_reg, REG_LENGTH, l_x, BUFF_SIZE);
+
+    for (FIR_sample_type_t l_type = FIR_SAMPLE_F16; l_type <= FIR_SAMPLE_BF16; l_type++)
+    {
+        FIR_filter_t l_filter = *p_filter;
+        round_samples(p_filter->coeff_b_ptr, p_filter->coeff_b_len, l_type, l_coeffs);
+        l_filter.coeff_b_ptr = l_coeffs;
+
+        FIR_plan_t *l_plan = create_filter_plan_with_kernel(&l_filter, BUFF_SIZE, p_plan->kernel);
+        if (l_plan == NULL)
+            continue;
+
+        narrow_samples(l_x, BUFF_SIZE, l_type, l_narrow);
+        execute_filter_plan_narrow(l_plan, l_type, l_narrow, BUFF_SIZE, l_narrow);
+        widen_samples(l_narrow, BUFF_SIZE, l_type, l_y);
+
+        char l_label[32];
+        snprintf(l_label, sizeof(l_label), "%s %s", p_name, sample_type_name(l_type));
+        print_precision_error(l_label, measure_precision_error(p_reference, l_y, BUFF_SIZE));
+
+        destroy_filter_plan(l_plan);
+    }
+}
+
+/**
+ * @brief Prints the throughput of the integer engines against the MAC kernels.
+ *
+ * The register digits are the codes behind generate_signal: 4 bit codes
+ * whose values are the mean-removed digits, with spare code 15 standing for
+ * the zero history. Random 1 and 2 bit codes show where the tables pay off.
+ * The error column is against p_reference, the float32 plan output.
+ */
+static void report_int_engines(FIR_filter_t *p_filter, uint32_t *p_reg, const float32_t *p_reference,
+                               const char *p_name, FIR_plan_mode_t p_mode)
+{
+    static uint8_t s_codes[BENCH_LEN];
+    static float32_t s_y[BENCH_LEN];
+    float32_t l_values[16] = { 0 };
+    float32_t l_mean;
+
+    calculate_mean(p_reg, REG_LENGTH, &l_mean);
+    for (uint32_t c = 0; c < 10; c++)
+    {
+        l_values[c] = (float32_t)c - l_mean;
+    }
+
+    for (uint32_t l_bits = 4; l_bits >= 1; l_bits /= 2)
+    {
+        uint32_t l_seed = 12345U;
+        for (uint32_t i = 0; i < BENCH_LEN; i++)
+        {
+            l_seed = l_seed * 1664525U + 1013904223U;
+            s_codes[i] = (l_bits == 4) ? (uint8_t)p_reg[i % REG_LENGTH] : (uint8_t)(l_seed >> (32 - l_bits));
+        }
+
+        FIR_int_plan_t *l_auto = create_int_filter_plan(p_filter, l_bits, (l_bits == 4) ? l_values : NULL,
+                                                        BUFF_SIZE, p_mode);
+        if (l_auto == NULL)
+            continue;
+
+        for (FIR_int_engine_t l_engine = FIR_INT_ENGINE_MAC; l_engine < FIR_INT_ENGINE_COUNT; l_engine++)
+        {
+            FIR_int_plan_t *l_plan = create_int_filter_plan_with_engine(p_filter, l_bits,
+                                                                        (l_bits == 4) ? l_values : NULL,
+                                                                        BUFF_SIZE, l_engine);
+            if (l_plan == NULL)
+                continue;
+
+            double l_rate = benchmark_int_filter_plan(l_plan, s_codes, BENCH_LEN, s_y);
+            char l_error[16] = "-";
+            if (l_bits == 4)
+            {
+                FIR_precision_error_t l_diff = measure_precision_error(p_reference, s_y, BUFF_SIZE);
+                snprintf(l_error, sizeof(l_error), "%.3e", l_diff.max_abs_error);
+            }
+
+            printf("| %-6s | %4u | %-3s%s | %12.2f | %12s |\n", p_name, l_bits, int_engine_name(l_engine),
+                   (l_auto->engine == l_engine) ? " *" : "  ", l_rate * 1e-6, l_error);
+            destroy_int_filter_plan(l_plan);
+        }
+
+        destroy_int_filter_plan(l_auto);
+    }
+}
+
+/**
+ * @brief Compares one filter bank pass with separate passes per filter.
+ *
+ * Every bank filter runs over BENCH_LEN samples of the first register
+ * signal, as separate direct-form plans (the summation order of the bank),
+ * as separate plans with the estimated kernel, and as one bank plan. The
+ * error column is the bank output against the separate direct-form outputs.
+ */
+static void report_filter_bank(uint32_t *p_reg)
+{
+    static float32_t s_x[BENCH_LEN];
+    static float32_t s_y[BANK_LEN][BENCH_LEN];
+    static float32_t s_reference[BANK_LEN][BENCH_LEN];
+    FIR_filter_t *l_filters[BANK_LEN];
+    float32_t *l_outputs[BANK_LEN];
+    uint32_t l_block_len = 4096U;
+
+    generate_signal(p_reg, REG_LENGTH, s_x, BENCH_LEN);
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        l_filters[i] = g_bank[i].filter;
+        l_outputs[i] = s_y[i];
+    }
+
+    printf("Filter Bank (%u filters, %u samples):\n", (unsigned)BANK_LEN, BENCH_LEN);
+    printf("|      Method      | Input Passes |  Input MB  |  Msamples/s  |  Max Error   |\n");
+    printf("|------------------|--------------|------------|--------------|--------------|\n");
+
+    for (uint32_t l_method = 0; l_method < 3; l_method++)
+    {
+        static const char *s_names[3] = { "separate direct", "separate planned", "bank" };
+        FIR_plan_t *l_plans[BANK_LEN] = { NULL };
+        FIR_multi_plan_t *l_bank = NULL;
+        uint64_t l_best_ns = UINT64_MAX;
+        bool l_ok = true;
+
+        if (l_method == 2)
+        {
+            l_bank = create_multi_filter_plan(l_filters, BANK_LEN, l_block_len);
+            l_ok = (l_bank != NULL);
+        }
+        for (uint32_t i = 0; l_method < 2 && i < BANK_LEN; i++)
+        {
+            l_plans[i] = (l_method == 0) ? create_filter_plan_with_kernel(l_filters[i], l_block_len, FIR_KERNEL_DIRECT)
+                                         : create_filter_plan(l_filters[i], l_block_len, FIR_PLAN_ESTIMATE);
+            l_ok = l_ok && (l_plans[i] != NULL);
+        }
+
+        for (uint32_t t = 0; l_ok && t < 3; t++)
+        {
+            uint64_t l_start = telemetry_now_ns();
+            if (l_bank != NULL)
+            {
+                reset_multi_filter_plan(l_bank);
+                execute_multi_filter_plan(l_bank, s_x, BENCH_LEN, l_outputs);
+            }
+            for (uint32_t i = 0; l_bank == NULL && i < BANK_LEN; i++)
+            {
+                reset_filter_plan(l_plans[i]);
+                execute_filter_plan(l_plans[i], s_x, BENCH_LEN, (l_method == 0) ? s_reference[i] : s_y[i]);
+            }
+            uint64_t l_elapsed = telemetry_now_ns() - l_start;
+            if (l_elapsed < l_best_ns)
+                l_best_ns = l_elapsed;
+        }
+
+        if (l_ok)
+        {
+            uint32_t l_passes = (l_bank != NULL) ? 1U : (uint32_t)BANK_LEN;
+            char l_error[16] = "-";
+            if (l_method > 0)
+            {
+                float32_t l_max = 0.0f;
+                for (uint32_t i = 0; i < BANK_LEN; i++)
+                {
+                    FIR_precision_error_t l_diff = measure_precision_error(s_reference[i], s_y[i], BENCH_LEN);
+                    if (l_diff.max_abs_error > l_max)
+                        l_max = l_diff.max_abs_error;
+                }
+                snprintf(l_error, sizeof(l_error), "%.3e", l_max);
+            }
+
+            printf("| %-16s | %12u | %10.1f | %12.2f | %12s |\n", s_names[l_method], l_passes,
+                   l_passes * (double)BENCH_LEN * sizeof(float32_t) / 1e6,
+                   (double)BENCH_LEN / (double)l_best_ns * 1e3, l_error);
+        }
+
+        for (uint32_t i = 0; i < BANK_LEN; i++)
+            destroy_filter_plan(l_plans[i]);
+        destroy_multi_filter_plan(l_bank);
+    }
+}
+
+/* Best of three passes over BENCH_LEN samples, in Msamples/s */
+static double time_filter_plan(FIR_plan_t *p_plan, const float32_t *p_x, float32_t *p_y)
+{
+    uint64_t l_best_ns = UINT64_MAX;
+
+    for (uint32_t t = 0; t < 3; t++)
+    {
+        reset_filter_plan(p_plan);
+        uint64_t l_start = telemetry_now_ns();
+        execute_filter_plan(p_plan, p_x, BENCH_LEN, p_y);
+        uint64_t l_elapsed = telemetry_now_ns() - l_start;
+        if (l_elapsed < l_best_ns)
+            l_best_ns = l_elapsed;
+    }
+    return (double)BENCH_LEN / (double)l_best_ns * 1e3;
+}
+
+/**
+ * @brief Filters the signal as p_segments independent pieces, as threads splitting it would.
+ *
+ * Each piece has its own plan, primed with the coeff_len-1 samples before it.
+ */
+static bool filter_in_segments(FIR_filter_t *p_filter, const float32_t *p_x, uint32_t p_segments, float32_t *p_y)
+{
+    static float32_t s_discard[BENCH_LEN];
+    uint64_t l_history = p_filter->coeff_b_len - 1;
+
+    for (uint32_t s = 0; s < p_segments; s++)
+    {
+        uint64_t l_start = (uint64_t)BENCH_LEN * s / p_segments;
+        uint64_t l_end = (uint64_t)BENCH_LEN * (s + 1) / p_segments;
+        uint64_t l_prime = (l_start < l_history) ? l_start : l_history;
+
+        FIR_plan_t *l_plan = create_filter_plan(p_filter, 4096U, FIR_PLAN_REPRODUCIBLE);
+        if (l_plan == NULL)
+            return false;
+        execute_filter_plan(l_plan, &p_x[l_start - l_prime], l_prime, s_discard);
+        execute_filter_plan(l_plan, &p_x[l_start], l_end - l_start, &p_y[l_start]);
+        destroy_filter_plan(l_plan);
+    }
+    return true;
+}
+
+/**
+ * @brief Compares reproducible plans with the scalar loops and the fastest kernel.
+ *
+ * The reproducible output is checked bit for bit against the scalar loop
+ * with the same summation order and against the same signal split into 2
+ * to MAX_SEGMENTS pieces. Its checksum can be compared across machines and
+ * builds. The fastest kernel is what FIR_PLAN_MEASURE would pick here.
+ */
+static void report_reproducibility(uint32_t *p_reg)
+{
+    static float32_t s_x[BENCH_LEN];
+    static float32_t s_y[BENCH_LEN];
+    static float32_t s_check[BENCH_LEN];
+
+    generate_signal(p_reg, REG_LENGTH, s_x, BENCH_LEN);
+
+    printf("Reproducible Plans (%u samples, block 4096):\n", BENCH_LEN);
+    printf("|    Filter     |  Kernel   | Scalar Ms/s | Repro Ms/s | Fastest Kernel | Fastest Ms/s | Cost  | Same Bits |     Checksum     |\n");
+    printf("|---------------|-----------|-------------|------------|----------------|--------------|-------|-----------|------------------|\n");
+
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        FIR_filter_t *l_filter = g_bank[i].filter;
+        FIR_plan_t *l_plan = create_filter_plan(l_filter, 4096U, FIR_PLAN_REPRODUCIBLE);
+        if (l_plan == NULL)
+            continue;
+
+        double l_repro_rate = time_filter_plan(l_plan, s_x, s_y);
+        uint64_t l_hash = fnv1a(s_y, BENCH_LEN * sizeof(float32_t));
+
+        // Scalar loop with the same summation order, where there is one
+        double l_scalar_rate = 0.0;
+        bool l_same = true;
+        if (l_plan->kernel == FIR_KERNEL_DIRECT || l_plan->kernel == FIR_KERNEL_SYMMETRIC)
+        {
+            uint64_t l_start = telemetry_now_ns();
+            if (l_plan->kernel == FIR_KERNEL_DIRECT)
+                filter_signal64(s_x, BENCH_LEN, l_filter, s_check);
+            else
+                symm_filter_signal64(s_x, BENCH_LEN, l_filter, s_check);
+            l_scalar_rate = (double)BENCH_LEN / (double)(telemetry_now_ns() - l_start) * 1e3;
+            l_same = (memcmp(s_check, s_y, sizeof(s_y)) == 0);
+        }
+        for (uint32_t l_segments = 2; l_same && l_segments <= MAX_SEGMENTS; l_segments++)
+        {
+            l_same = filter_in_segments(l_filter, s_x, l_segments, s_check)
+                     && memcmp(s_check, s_y, sizeof(s_y)) == 0;
+        }
+
+        FIR_kernel_t l_fastest = l_plan->kernel;
+        double l_fastest_rate = l_repro_rate;
+        uint32_t l_properties = analyse_coefficients(l_filter->coeff_b_ptr, l_filter->coeff_b_len);
+        for (uint32_t k = 0; k < FIR_KERNEL_COUNT; k++)
+        {
+            if (k == l_plan->kernel || !kernel_supported((FIR_kernel_t)k, l_properties))
+                continue;
+            FIR_plan_t *l_other = create_filter_plan_with_kernel(l_filter, 4096U, (FIR_kernel_t)k);
+            if (l_other == NULL)
+                continue;
+            double l_rate = time_filter_plan(l_other, s_x, s_check);
+            if (l_rate > l_fastest_rate)
+            {
+                l_fastest_rate = l_rate;
+                l_fastest = (FIR_kernel_t)k;
+            }
+            destroy_filter_plan(l_other);
+        }
+
+        char l_scalar[16] = "-";
+        if (l_scalar_rate > 0.0)
+            snprintf(l_scalar, sizeof(l_scalar), "%.2f", l_scalar_rate);
+        printf("| %-13s | %-9s | %11s | %10.2f | %-14s | %12.2f | %4.0f%% | %-9s | %016llx |\n", g_bank[i].name,
+               filter_kernel_name(l_plan->kernel), l_scalar, l_repro_rate, filter_kernel_name(l_fastest),
+               l_fastest_rate, (l_fastest_rate / l_repro_rate - 1.0) * 100.0, l_same ? "yes" : "NO",
+               (unsigned long long)l_hash);
+        destroy_filter_plan(l_plan);
+    }
+}
+
+/* Fast FIR decompositions compared by report_fast_fir(), innermost factor first */
+static const uint32_t g_ffa_factors[][FFA_MAX_LEVELS] =
+{
+    { 2 }, { 3 }, { 2, 2 }, { 2, 3 }, { 3, 3 }, { 2, 2, 2 }, { 2, 2, 3 }
+};
+
+#define FFA_CHOICES  (sizeof(g_ffa_factors) / sizeof(g_ffa_factors[0]))
+
+/* Prints one row of the fast FIR table; p_reference is the direct output */
+static void print_fast_fir_row(const char *p_name, const char *p_kernel, uint32_t p_multiplies, const FIR_plan_t *p_plan,
+                               double p_rate, double p_direct_rate, const float32_t *p_y, const float32_t *p_reference)
+{
+    float32_t l_max_error = 0.0f;
+    for (uint32_t n = 0; n < BENCH_LEN; n++)
+    {
+        float32_t l_error = fabsf(p_y[n] - p_reference[n]);
+        if (l_error > l_max_error)
+            l_max_error = l_error;
+    }
+
+    printf("| %-13s | %-13s | %10u | %5u | %9.2f | %8.2fx | %12.4e |\n", p_name, p_kernel, p_multiplies,
+           filter_plan_cost(p_plan), p_rate, p_rate / p_direct_rate, l_max_error);
+}
+
+/**
+ * @brief Benchmarks the fast FIR decompositions against the direct and folded kernels.
+ *
+ * Every decomposition of g_ffa_factors runs each bank filter; the one an
+ * estimated plan would build is marked with *. Errors are against the
+ * direct kernel's output.
+ */
+static void report_fast_fir(uint32_t *p_reg)
+{
+    static float32_t s_x[BENCH_LEN];
+    static float32_t s_y[BENCH_LEN];
+    static float32_t s_direct[BENCH_LEN];
+
+    generate_signal(p_reg, REG_LENGTH, s_x, BENCH_LEN);
+
+    printf("Fast FIR (%u samples, block 4096, * = chosen for the ffa kernel):\n", BENCH_LEN);
+    printf("|    Filter     |    Kernel     | Multiplies | Cost  |   Ms/s    | vs Direct |  Max Error   |\n");
+    printf("|---------------|---------------|------------|-------|-----------|-----------|--------------|\n");
+
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        FIR_filter_t *l_filter = g_bank[i].filter;
+        uint32_t N = l_filter->coeff_b_len;
+
+        FIR_plan_t *l_direct = create_filter_plan_with_kernel(l_filter, 4096U, FIR_KERNEL_DIRECT);
+        if (l_direct == NULL)
+            continue;
+        double l_direct_rate = time_filter_plan(l_direct, s_x, s_direct);
+        print_fast_fir_row(g_bank[i].name, "direct", N, l_direct, l_direct_rate, l_direct_rate, s_direct, s_direct);
+        destroy_filter_plan(l_direct);
+
+        uint32_t l_properties = analyse_coefficients(l_filter->coeff_b_ptr, N);
+        for (uint32_t k = FIR_KERNEL_SYMMETRIC; k <= FIR_KERNEL_ANTISYMMETRIC; k++)
+        {
+            if (!kernel_supported((FIR_kernel_t)k, l_properties))
+                continue;
+            FIR_plan_t *l_folded = create_filter_plan_with_kernel(l_filter, 4096U, (FIR_kernel_t)k);
+            if (l_folded == NULL)
+                continue;
+            double l_rate = time_filter_plan(l_folded, s_x, s_y);
+            print_fast_fir_row(g_bank[i].name, filter_kernel_name((FIR_kernel_t)k), (N + 1) / 2, l_folded, l_rate,
+                               l_direct_rate, s_y, s_direct);
+            destroy_filter_plan(l_folded);
+        }
+
+        uint32_t l_chosen[FFA_MAX_LEVELS];
+        uint32_t l_chosen_levels = choose_ffa_factors(N, l_chosen);
+        for (uint32_t c = 0; c < FFA_CHOICES; c++)
+        {
+            uint32_t l_levels = 0;
+            while (l_levels < FFA_MAX_LEVELS && g_ffa_factors[c][l_levels] != 0)
+                l_levels++;
+
+            FIR_plan_t *l_plan = create_filter_plan_with_ffa(l_filter, 4096U, g_ffa_factors[c], l_levels);
+            if (l_plan == NULL)
+                continue;
+            double l_rate = time_filter_plan(l_plan, s_x, s_y);
+
+            char l_name[16] = "ffa ";
+            describe_ffa(l_plan->ffa, &l_name[4], sizeof(l_name) - 5);
+            if (l_levels == l_chosen_levels && memcmp(l_chosen, g_ffa_factors[c], l_levels * sizeof(uint32_t)) == 0)
+                strcat(l_name, "*");
+            print_fast_fir_row(g_bank[i].name, l_name, ffa_multiplies(l_plan->ffa), l_plan, l_rate, l_direct_rate,
+                               s_y, s_direct);
+            destroy_filter_plan(l_plan);
+        }
+    }
+}
+
+/* Prints one row of the tick latency table */
+static void print_latency_row(const char *p_name, const char *p_form, const FIR_latency_histogram_t *p_histogram,
+                              const char *p_error)
+{
+    printf("| %-13s | %-10s | %7llu | %7llu | %8llu | %8.1f | %12s |\n", p_name, p_form,
+           (unsigned long long)latency_percentile(p_histogram, 50.0),
+           (unsigned long long)latency_percentile(p_histogram, 99.0), (unsigned long long)p_histogram->max_ns,
+           (double)p_histogram->sum_ns / (double)p_histogram->count, p_error);
+}
+
+/**
+ * @brief Times every push of TICK_LEN samples through each tick form of the bank filters.
+ *
+ * The first row times an empty interval, the clock floor included in
+ * every other row. Errors are against filter_signal64().
+ */
+static void report_tick_latency(uint32_t *p_reg)
+{
+    static float32_t s_x[TICK_LEN];
+    static float32_t s_y[TICK_LEN];
+    static float32_t s_reference[TICK_LEN];
+    static FIR_latency_histogram_t s_histogram;
+
+    generate_signal(p_reg, REG_LENGTH, s_x, TICK_LEN);
+
+    memset(&s_histogram, 0, sizeof(s_histogram));
+    for (uint32_t n = 0; n < TICK_LEN; n++)
+    {
+        uint64_t l_start = telemetry_now_ns();
+        record_latency(&s_histogram, telemetry_now_ns() - l_start);
+    }
+
+    printf("Tick Latency (%u samples pushed one at a time, ns per sample):\n", TICK_LEN);
+    printf("|    Filter     |    Form    |   p50   |   p99   |   Max    |   Mean   |  Max Error   |\n");
+    printf("|---------------|------------|---------|---------|----------|----------|--------------|\n");
+    print_latency_row("(clock)", "-", &s_histogram, "-");
+
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        FIR_filter_t *l_filter = g_bank[i].filter;
+        filter_signal64(s_x, TICK_LEN, l_filter, s_reference);
+
+        uint32_t l_properties = analyse_coefficients(l_filter->coeff_b_ptr, l_filter->coeff_b_len);
+        for (uint32_t f = 0; f < FIR_TICK_FORM_COUNT; f++)
+        {
+            if (f == FIR_TICK_SYMMETRIC && (l_properties & FIR_COEFF_SYMMETRIC) == 0)
+                continue;
+            FIR_tick_filter_t *l_tick = create_tick_filter(l_filter, (FIR_tick_form_t)f);
+            if (l_tick == NULL)
+                continue;
+
+            memset(&s_histogram, 0, sizeof(s_histogram));
+            measure_tick_latency(l_tick, s_x, TICK_LEN, s_y, &s_histogram);
+
+            float32_t l_max_error = 0.0f;
+            for (uint32_t n = 0; n < TICK_LEN; n++)
+            {
+                float32_t l_error = fabsf(s_y[n] - s_reference[n]);
+                if (l_error > l_max_error)
+                    l_max_error = l_error;
+            }
+
+            char l_error[16];
+            snprintf(l_error, sizeof(l_error), "%.4e", l_max_error);
+            print_latency_row(g_bank[i].name, tick_form_name((FIR_tick_form_t)f), &s_histogram, l_error);
+            destroy_tick_filter(l_tick);
+        }
+    }
+}
+
+/* Prints one row of the jitter table */
+static void print_jitter_row(const char *p_mode, const FIR_jitter_report_t *p_report)
+{
+    printf("| %-9s | %6llu | %7llu | %7llu | %7llu | %8llu | %7llu | %8llu | %7llu |\n", p_mode,
+           (unsigned long long)p_report->blocks,
+           (unsigned long long)latency_percentile(&p_report->histogram, 50.0),
+           (unsigned long long)latency_percentile(&p_report->histogram, 99.0),
+           (unsigned long long)latency_percentile(&p_report->histogram, 99.9),
+           (unsigned long long)p_report->histogram.max_ns,
+           (unsigned long long)(p_report->minor_faults + p_report->major_faults),
+           (unsigned long long)p_report->involuntary_switches, (unsigned long long)p_report->cpu_changes);
+}
+
+/* Creates a plan and an output buffer, as a filter thread would on start-up, and runs the timed loop */
+static bool run_jitter_loop(const float32_t *p_x, float32_t **p_y, FIR_jitter_report_t *p_report)
+{
+    FIR_plan_t *l_plan = create_filter_plan(&g_FIR_1, JITTER_BLOCK, FIR_PLAN_REPRODUCIBLE);
+    *p_y = arena_alloc(JITTER_LEN * sizeof(float32_t));
+    if (l_plan == NULL || *p_y == NULL)
+    {
+        destroy_filter_plan(l_plan);
+        return false;
+    }
+    prefault_memory(*p_y, JITTER_LEN * sizeof(float32_t));
+
+    bool l_ok = measure_plan_jitter(l_plan, p_x, JITTER_LEN, *p_y, p_report);
+    destroy_filter_plan(l_plan);
+    return l_ok;
+}
+
+/**
+ * @brief Times every block of a filtering loop in normal mode, then in real-time mode.
+ *
+ * Both loops start from a new plan and a new output buffer, like a filter
+ * thread that has just been started. The real-time settings are p_config,
+ * which is applied here and stays in effect for the rest of the run.
+ */
+static int report_jitter(uint32_t *p_reg, const FIR_realtime_config_t *p_config)
+{
+    static float32_t s_x[JITTER_LEN];
+    static FIR_jitter_report_t s_normal;
+    static FIR_jitter_report_t s_realtime;
+    float32_t *l_y_normal = NULL;
+    float32_t *l_y_realtime = NULL;
+
+    generate_signal(p_reg, REG_LENGTH, s_x, JITTER_LEN);
+
+    bool l_ok = run_jitter_loop(s_x, &l_y_normal, &s_normal);
+    l_ok = l_ok && configure_realtime(p_config);
+    if (l_ok)
+    {
+        enter_realtime_thread(0);
+        l_ok = run_jitter_loop(s_x, &l_y_realtime, &s_realtime);
+        leave_realtime_thread();
+    }
+    if (!l_ok)
+    {
+        arena_free(l_y_normal);
+        arena_free(l_y_realtime);
+        return 1;
+    }
+
+    printf("Filtering Loop Jitter (filter1, %u blocks of %u samples, ns per block):\n", JITTER_LEN / JITTER_BLOCK,
+           JITTER_BLOCK);
+    printf("|   Mode    | Blocks |   p50   |   p99   |  p99.9  |   Max    | Faults  | Switches | CPU Chg |\n");
+    printf("|-----------|--------|---------|---------|---------|----------|---------|----------|---------|\n");
+    print_jitter_row("normal", &s_normal);
+    print_jitter_row("real-time", &s_realtime);
+
+    double l_p99 = (double)latency_percentile(&s_realtime.histogram, 99.0);
+    double l_p999 = (double)latency_percentile(&s_realtime.histogram, 99.9);
+    double l_max = (double)s_realtime.histogram.max_ns;
+    printf("Tail reduction: p99 %.2fx, p99.9 %.2fx, max %.2fx\n",
+           (double)latency_percentile(&s_normal.histogram, 99.0) / (l_p99 > 0.0 ? l_p99 : 1.0),
+           (double)latency_percentile(&s_normal.histogram, 99.9) / (l_p999 > 0.0 ? l_p999 : 1.0),
+           (double)s_normal.histogram.max_ns / (l_max > 0.0 ? l_max : 1.0));
+    printf("Outputs identical: %s\n",
+           memcmp(l_y_normal, l_y_realtime, JITTER_LEN * sizeof(float32_t)) == 0 ? "yes" : "no");
+
+    FIR_realtime_stats_t l_stats;
+    read_realtime_stats(&l_stats);
+    print_realtime_stats(&l_stats);
+
+    arena_free(l_y_normal);
+    arena_free(l_y_realtime);
+    return 0;
+}
+
+/* Adds a block of samples to a statistics accumulator, one sample at a time */
+static void accumulate_stats(FIR_pipeline_stats_t *p_stats, const float32_t *p_y, uint32_t p_len)
+{
+    for (uint32_t n = 0; n < p_len; n++)
+    {
+        p_stats->sum += p_y[n];
+        p_stats->sum_sq += (double)p_y[n] * p_y[n];
+        if (p_y[n] < p_stats->min)
+            p_stats->min = p_y[n];
+        if (p_y[n] > p_stats->max)
+            p_stats->max = p_y[n];
+    }
+    p_stats->count += p_len;
+}
+
+/* One plan and accumulator per channel, cycling through the bank filters */
+static bool create_channels(FIR_plan_t **p_plans, FIR_pipeline_stats_t *p_stats, FIR_plan_mode_t p_mode)
+{
+    bool l_ok = true;
+
+    for (uint32_t c = 0; c < CHECKPOINT_CHANNELS; c++)
+    {
+        p_plans[c] = create_filter_plan(g_bank[c % BANK_LEN].filter, CHECKPOINT_BLOCK, p_mode);
+        l_ok = l_ok && (p_plans[c] != NULL);
+        memset(&p_stats[c], 0, sizeof(p_stats[c]));
+        p_stats[c].min = INFINITY;
+        p_stats[c].max = -INFINITY;
+    }
+    return l_ok;
+}
+
+static void destroy_channels(FIR_plan_t **p_plans)
+{
+    for (uint32_t c = 0; c < CHECKPOINT_CHANNELS; c++)
+    {
+        destroy_filter_plan(p_plans[c]);
+        p_plans[c] = NULL;
+    }
+}
+
+/* Filters blocks [p_first, p_last) of every channel, hashing each output block; captures every CHECKPOINT_EVERY blocks */
+static bool run_channels(FIR_plan_t **p_plans, FIR_pipeline_stats_t *p_stats, const float32_t *p_x,
+                         uint32_t p_first, uint32_t p_last, uint64_t (*p_hashes)[CHECKPOINT_BLOCKS],
+                         FIR_checkpoint_t *p_checkpoint)
+{
+    static float32_t s_y[CHECKPOINT_BLOCK];
+
+    for (uint32_t b = p_first; b < p_last; b++)
+    {
+        for (uint32_t c = 0; c < CHECKPOINT_CHANNELS; c++)
+        {
+            execute_filter_plan(p_plans[c], &p_x[b * CHECKPOINT_BLOCK], CHECKPOINT_BLOCK, s_y);
+            accumulate_stats(&p_stats[c], s_y, CHECKPOINT_BLOCK);
+            p_hashes[c][b] = fnv1a(s_y, CHECKPOINT_BLOCK * sizeof(float32_t));
+        }
+        if (p_checkpoint != NULL && (b + 1) % CHECKPOINT_EVERY == 0
+            && !capture_checkpoint(p_checkpoint, (uint64_t)(b + 1) * CHECKPOINT_BLOCK))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* A checkpoint tracking every channel's plan and accumulator */
+static FIR_checkpoint_t *track_channels(const char *p_filename, FIR_plan_t **p_plans, FIR_pipeline_stats_t *p_stats)
+{
+    FIR_checkpoint_t *l_checkpoint = create_checkpoint(p_filename);
+    bool l_ok = (l_checkpoint != NULL);
+
+    for (uint32_t c = 0; c < CHECKPOINT_CHANNELS && l_ok; c++)
+    {
+        char l_name[CHECKPOINT_NAME_MAX];
+        snprintf(l_name, sizeof(l_name), "channel%u", c);
+        l_ok = checkpoint_track_plan(l_checkpoint, l_name, p_plans[c])
+               && checkpoint_track_stats(l_checkpoint, l_name, &p_stats[c]);
+    }
+    if (!l_ok)
+    {
+        destroy_checkpoint(l_checkpoint);
+        return NULL;
+    }
+    return l_checkpoint;
+}
+
+/**
+ * @brief Stops a checkpointed multi-channel stream part way, restarts it from its checkpoint
+ *        and compares the rest with an uninterrupted run.
+ *
+ * The restarted plans are created by estimate, so a kernel chosen by
+ * measurement in the first run only comes back through the checkpoint.
+ */
+static int run_checkpoint_restart(uint32_t *p_reg, const char *p_filename, FIR_plan_mode_t p_mode)
+{
+    static float32_t s_x[CHECKPOINT_LEN];
+    static FIR_plan_t *s_plans[CHECKPOINT_CHANNELS];
+    static FIR_pipeline_stats_t s_stats[CHECKPOINT_CHANNELS];
+    static FIR_pipeline_stats_t s_reference_stats[CHECKPOINT_CHANNELS];
+    static uint64_t s_hashes[CHECKPOINT_CHANNELS][CHECKPOINT_BLOCKS];
+    static uint64_t s_reference[CHECKPOINT_CHANNELS][CHECKPOINT_BLOCKS];
+    FIR_checkpoint_report_t l_report;
+
+    generate_signal(p_reg, REG_LENGTH, s_x, CHECKPOINT_LEN);
+
+    // Uninterrupted run
+    bool l_ok = create_channels(s_plans, s_reference_stats, p_mode)
+                && run_channels(s_plans, s_reference_stats, s_x, 0, CHECKPOINT_BLOCKS, s_reference, NULL);
+    destroy_channels(s_plans);
+
+    // Checkpointed run, stopped after CHECKPOINT_STOP blocks
+    FIR_checkpoint_t *l_checkpoint = NULL;
+    l_ok = l_ok && create_channels(s_plans, s_stats, p_mode);
+    l_ok = l_ok && (l_checkpoint = track_channels(p_filename, s_plans, s_stats)) != NULL;
+    uint64_t l_start = telemetry_now_ns();
+    l_ok = l_ok && run_channels(s_plans, s_stats, s_x, 0, CHECKPOINT_STOP, s_hashes, l_checkpoint);
+    double l_run_ms = (double)(telemetry_now_ns() - l_start) * 1e-6;
+    if (l_checkpoint != NULL)
+    {
+        l_ok = flush_checkpoint(l_checkpoint) && l_ok;
+        read_checkpoint_report(l_checkpoint, &l_report);
+    }
+    destroy_checkpoint(l_checkpoint);
+    destroy_channels(s_plans);
+
+    // Restart: new plans and accumulators, state from the mapped checkpoint
+    uint64_t l_position = 0;
+    l_checkpoint = NULL;
+    l_ok = l_ok && create_channels(s_plans, s_stats, FIR_PLAN_ESTIMATE);
+    l_start = telemetry_now_ns();
+    l_ok = l_ok && (l_checkpoint = track_channels(p_filename, s_plans, s_stats)) != NULL
+           && restore_checkpoint(l_checkpoint, &l_position);
+    double l_restore_ms = (double)(telemetry_now_ns() - l_start) * 1e-6;
+
+    uint32_t l_resume = (uint32_t)(l_position / CHECKPOINT_BLOCK);
+    l_ok = l_ok && l_position % CHECKPOINT_BLOCK == 0 && l_resume <= CHECKPOINT_BLOCKS
+           && run_channels(s_plans, s_stats, s_x, l_resume, CHECKPOINT_BLOCKS, s_hashes, NULL);
+    destroy_checkpoint(l_checkpoint);
+    destroy_channels(s_plans);
+    if (!l_ok)
+        return 1;
+
+    uint32_t l_mismatched = 0;
+    uint32_t l_stats_mismatched = 0;
+    for (uint32_t c = 0; c < CHECKPOINT_CHANNELS; c++)
+    {
+        for (uint32_t b = l_resume; b < CHECKPOINT_BLOCKS; b++)
+        {
+            l_mismatched += (s_hashes[c][b] != s_reference[c][b]);
+        }
+        l_stats_mismatched += (s_stats[c].count != s_reference_stats[c].count
+                               || s_stats[c].sum != s_reference_stats[c].sum
+                               || s_stats[c].sum_sq != s_reference_stats[c].sum_sq
+                               || s_stats[c].min != s_reference_stats[c].min
+                               || s_stats[c].max != s_reference_stats[c].max);
+    }
+
+    printf("Checkpoint and Restart (%u channels of %u samples, blocks of %u, a capture every %u blocks):\n",
+           CHECKPOINT_CHANNELS, CHECKPOINT_LEN, CHECKPOINT_BLOCK, CHECKPOINT_EVERY);
+    print_checkpoint_report(&l_report);
+    printf("Stopped after sample %u (%.1f ms of filtering), restarted from sample %llu\n",
+           CHECKPOINT_STOP * CHECKPOINT_BLOCK, l_run_ms, (unsigned long long)l_position);
+    printf("Restore (map, check and copy): %.3f ms\n", l_restore_ms);
+    printf("Output after restart: %s (%u of %u blocks differ)\n", l_mismatched == 0 ? "identical" : "DIFFERENT",
+           l_mismatched, CHECKPOINT_CHANNELS * (CHECKPOINT_BLOCKS - l_resume));
+    printf("Statistics: %s (%u of %u channels differ)\n", l_stats_mismatched == 0 ? "identical" : "DIFFERENT",
+           l_stats_mismatched, CHECKPOINT_CHANNELS);
+
+    return (l_mismatched == 0 && l_stats_mismatched == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Creates, runs and destroys one plan per bank filter, a bank plan and a pipeline.
+ */
+static bool run_arena_cycle(uint32_t *p_reg, FIR_plan_mode_t p_mode)
+{
+    static float32_t s_x[BUFF_SIZE];
+    static float32_t s_y[BANK_LEN][BUFF_SIZE];
+    FIR_filter_t *l_filters[BANK_LEN];
+    float32_t *l_outputs[BANK_LEN];
+    bool l_ok = true;
+
+    generate_signal(p_reg, REG_LENGTH, s_x, BUFF_SIZE);
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        l_filters[i] = g_bank[i].filter;
+        l_outputs[i] = s_y[i];
+
+        FIR_plan_t *l_plan = create_filter_plan(l_filters[i], BUFF_SIZE, p_mode);
+        l_ok = l_ok && (l_plan != NULL);
+        if (l_plan != NULL)
+            execute_filter_plan(l_plan, s_x, BUFF_SIZE, s_y[i]);
+        destroy_filter_plan(l_plan);
+    }
+
+    FIR_multi_plan_t *l_bank = create_multi_filter_plan(l_filters, BANK_LEN, BUFF_SIZE);
+    l_ok = l_ok && (l_bank != NULL);
+    if (l_bank != NULL)
+        execute_multi_filter_plan(l_bank, s_x, BUFF_SIZE, l_outputs);
+    destroy_multi_filter_plan(l_bank);
+
+    FIR_pipeline_report_t l_report;
+    FIR_pipeline_t *l_pipeline = create_pipeline(0);
+    l_ok = l_ok && l_pipeline != NULL && pipeline_add_generator(l_pipeline, p_reg, REG_LENGTH, BUFF_SIZE)
+           && pipeline_add_fir(l_pipeline, &g_FIR_1, p_mode) && pipeline_add_stats(l_pipeline, "y1")
+           && pipeline_add_array_sink(l_pipeline, s_y[0], BUFF_SIZE) && run_pipeline(l_pipeline, &l_report);
+    destroy_pipeline(l_pipeline);
+
+    return l_ok;
+}
+
+/**
+ * @brief Writes one float32 input file per bank filter and a manifest filtering each, in p_dir.
+ *
+ * @return false if a file could not be written.
+ */
+static bool write_arena_batch(uint32_t *p_reg, const char *p_dir, char *p_manifest, size_t p_manifest_len)
+{
+    static float32_t s_x[4 * BUFF_SIZE];
+    char l_input[BATCH_PATH_MAX];
+
+    generate_signal(p_reg, REG_LENGTH, s_x, 4 * BUFF_SIZE);
+    snprintf(p_manifest, p_manifest_len, "%s/manifest.txt", p_dir);
+    FILE *l_manifest = fopen(p_manifest, "w");
+    if (l_manifest == NULL)
+        return false;
+
+    bool l_ok = true;
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        snprintf(l_input, sizeof(l_input), "%s/in%u.f32", p_dir, i);
+        l_ok = l_ok && write_sample_file(l_input, FIR_SAMPLE_F32, s_x, 4 * BUFF_SIZE);
+        fprintf(l_manifest, "%s %s %s/out%u.f32\n", l_input, g_bank[i].name, p_dir, i);
+    }
+    return (fclose(l_manifest) == 0) && l_ok;
+}
+
+static void remove_arena_batch(const char *p_dir, const char *p_manifest)
+{
+    char l_path[BATCH_PATH_MAX];
+
+    for (uint32_t i = 0; i < BANK_LEN; i++)
+    {
+        snprintf(l_path, sizeof(l_path), "%s/in%u.f32", p_dir, i);
+        unlink(l_path);
+        snprintf(l_path, sizeof(l_path), "%s/out%u.f32", p_dir, i);
+        unlink(l_path);
+    }
+    unlink(p_manifest);
+    rmdir(p_dir);
+}
+
+/**
+ * @brief Loads the manifest and runs it on two short-lived worker threads.
+ */
+static bool run_arena_batch(const char *p_manifest, FIR_plan_mode_t p_mode)
+{
+    FIR_batch_t l_batch;
+    FIR_batch_report_t l_report;
+    FIR_batch_config_t l_config = { .thread_count = 2, .block_len = BUFF_SIZE, .plan_mode = p_mode };
+
+    if (!load_batch_manifest(p_manifest, g_bank, BANK_LEN, &l_batch))
+        return false;
+    bool l_ok = run_batch(&l_batch, g_bank, BANK_LEN, &l_config, &l_report);
+    free_batch(&l_batch);
+    return l_ok;
+}
+
+static FIR_arena_stats_t arena_stats_since(const FIR_arena_stats_t *p_before, const FIR_arena_stats_t *p_after)
+{
+    FIR_arena_stats_t l_diff = {
+        .chunks = p_after->chunks - p_before->chunks,
+        .chunk_bytes = p_after->chunk_bytes - p_before->chunk_bytes,
+        .huge_chunks = p_after->huge_chunks - p_before->huge_chunks,
+        .allocs = p_after->allocs - p_before->allocs,
+        .frees = p_after->frees - p_before->frees,
+        .reused = p_after->reused - p_before->reused,
+        .carved = p_after->carved - p_before->carved,
+        .live_bytes = p_after->live_bytes - p_before->live_bytes,
+        .pools = p_after->pools - p_before->pools,
+    };
+    return l_diff;
+}
+
+/**
+ * @brief Shows that once the filter objects have been allocated once, creating
+ *        and destroying them again is served entirely from the arena pools.
+ */
+static void report_arena(uint32_t *p_reg, FIR_plan_mode_t p_mode)
+{
+    FIR_arena_stats_t l_start, l_warm, l_end;
+
+    read_arena_stats(&l_start);
+    bool l_ok = run_arena_cycle(p_reg, p_mode);
+    read_arena_stats(&l_warm);
+
+    uint64_t l_begin_ns = telemetry_now_ns();
+    for (uint32_t r = 0; l_ok && r < ARENA_ROUNDS; r++)
+        l_ok = run_arena_cycle(p_reg, p_mode);
+    uint64_t l_elapsed_ns = telemetry_now_ns() - l_begin_ns;
+    read_arena_stats(&l_end);
+
+    FIR_arena_stats_t l_first = arena_stats_since(&l_start, &l_warm);
+    FIR_arena_stats_t l_steady = arena_stats_since(&l_warm, &l_end);
+
+    printf("Arena (cycles of %u plans, a bank plan and a pipeline, created, run and destroyed):\n",
+           (unsigned)BANK_LEN);
+    printf("|     Phase      | Chunks | Mapped MiB | Huge |  Allocs   |  Reused   | Carved  |   Frees   |  Live KiB  |\n");
+    printf("|----------------|--------|------------|------|-----------|-----------|---------|-----------|------------|\n");
+    print_arena_stats("first cycle", &l_first);
+    print_arena_stats("steady state", &l_steady);
+    print_arena_stats("total", &l_end);
+    printf("Steady state: %u cycles, %.1f us per cycle, %llu chunks mapped, %llu blocks carved\n", ARENA_ROUNDS,
+           (double)l_elapsed_ns / ARENA_ROUNDS / 1e3, (unsigned long long)l_steady.chunks, (unsigned long long)l_steady.carved);
+    if (l_steady.chunks != 0 || l_steady.carved != 0)
+        printf("Error. The steady state took memory from the arena's chunks instead of reusing blocks.\n");
+    if (!l_ok)
+        printf("Error. An arena cycle failed.\n");
+
+    // Batches: new worker threads every run, adopting the pools of the last run's workers
+    char l_dir[] = "/tmp/fir_arena_XXXXXX";
+    char l_manifest[BATCH_PATH_MAX];
+    if (mkdtemp(l_dir) == NULL || !write_arena_batch(p_reg, l_dir, l_manifest, sizeof(l_manifest)))
+    {
+        printf("Error. Not able to write the arena batch files.\n");
+        return;
+    }
+
+    read_arena_stats(&l_start);
+    l_ok = run_arena_batch(l_manifest, p_mode);
+    read_arena_stats(&l_warm);
+    l_begin_ns = telemetry_now_ns();
+    for (uint32_t r = 0; l_ok && r < BATCH_ROUNDS; r++)
+        l_ok = run_arena_batch(l_manifest, p_mode);
+    l_elapsed_ns = telemetry_now_ns() - l_begin_ns;
+    read_arena_stats(&l_end);
+    remove_arena_batch(l_dir, l_manifest);
+
+    l_first = arena_stats_since(&l_start, &l_warm);
+    l_steady = arena_stats_since(&l_warm, &l_end);
+    printf("Arena (batches of %u jobs on 2 worker threads, loaded, run and freed):\n", (unsigned)BANK_LEN);
+    printf("|     Phase      | Chunks | Mapped MiB | Huge |  Allocs   |  Reused   | Carved  |   Frees   |  Live KiB  |\n");
+    printf("|----------------|--------|------------|------|-----------|-----------|---------|-----------|------------|\n");
+    print_arena_stats("first batch", &l_first);
+    print_arena_stats("steady state", &l_steady);
+    printf("Steady state: %u batches, %.1f us per batch, %llu chunks mapped, %llu blocks carved\n", BATCH_ROUNDS,
+           (double)l_elapsed_ns / BATCH_ROUNDS / 1e3, (unsigned long long)l_steady.chunks, (unsigned long long)l_steady.carved);
+    if (l_steady.chunks != 0 || l_steady.carved != 0)
+        printf("Error. The steady state took memory from the arena's chunks instead of reusing blocks.\n");
+    if (!l_ok)
+        printf("Error. A batch cycle failed.\n");
+}
+
+/* Shared by the data (main) and control threads of run_live_swap() */
+typedef struct {
+    FIR_live_filter_t *live;
+    FIR_plan_mode_t    mode;
+    uint32_t           swap_at;   /* sample after which the control thread publishes filter 2 */
+    _Atomic uint64_t   streamed;  /* samples the data thread has filtered */
+    _Atomic bool       done;      /* the data thread has stopped */
+    bool               published;
+} live_swap_t;
+
+/* Control thread: publishes filter 2 once the stream has passed swap_at, then frees what the data thread retires */
+static void *live_control_main(void *p_arg)
+{
+    live_swap_t *l_swap = p_arg;
+
+    while (!atomic_load(&l_swap->done) && atomic_load(&l_swap->streamed) < l_swap->swap_at)
+        sched_yield();
+    if (!atomic_load(&l_swap->done))
+        l_swap->published = publish_live_filter(l_swap->live, &g_FIR_2, l_swap->mode);
+
+    while (!atomic_load(&l_swap->done))
+    {
+        reclaim_live_filter(l_swap->live);
+        sched_yield();
+    }
+    reclaim_live_filter(l_swap->live);
+    return NULL;
+}
+
+/* Counts the samples in [p_from, p_to) where two outputs differ in any bit */
+static uint32_t count_mismatches(const float32_t *p_a, const float32_t *p_b, uint32_t p_from, uint32_t p_to)
+{
+    uint32_t l_count = 0;
+    for (uint32_t n = p_from; n < p_to; n++)
+    {
+        if (memcmp(&p_a[n], &p_b[n], sizeof(float32_t)) != 0)
+            l_count++;
+    }
+    return l_count;
+}
+
+/**
+ * @brief Streams the first register signal through filter 1 and hot-swaps to
+ *        filter 2 half way, writing the output to DATA_FILE_SWAP.
+ *
+ * The main thread streams block by block while a control thread publishes
+ * filter 2 and frees the plan that is retired, so the plans cross between
+ * threads through the live filter's mailboxes. The output is compared
+ * with uninterrupted plans of both filters over the same input: up to the
+ * block that adopts filter 2 it must equal filter 1's, and after the
+ * crossfade filter 2's. With a crossfade shorter than filter 2, the first
+ * outputs compared read inputs from before the swap, so they only match if
+ * the history carried over.
+ */
+static int run_live_swap(uint32_t *p_reg, uint32_t p_crossfade_len, FIR_plan_mode_t p_mode)
+{
+    static float32_t s_x[4 * BUFF_SIZE];
+    static float32_t s_y[4 * BUFF_SIZE];
+    static float32_t s_y1[4 * BUFF_SIZE];
+    static float32_t s_y2[4 * BUFF_SIZE];
+    uint32_t l_len_total = 4 * BUFF_SIZE;
+    uint32_t l_max_taps = (g_FIR_1.coeff_b_len > g_FIR_2.coeff_b_len) ? g_FIR_1.coeff_b_len : g_FIR_2.coeff_b_len;
+    uint32_t l_block_len = 64U;
+    live_swap_t l_swap = { .mode = p_mode, .swap_at = (2 * BUFF_SIZE / l_block_len) * l_block_len };
+    pthread_t l_control;
+
+    generate_signal(p_reg, REG_LENGTH, s_x, l_len_total);
+
+    // References: each filter uninterrupted, in the same blocks as the live filter
+    FIR_plan_t *l_plan1 = create_filter_plan(&g_FIR_1, l_block_len, p_mode);
+    FIR_plan_t *l_plan2 = create_filter_plan(&g_FIR_2, l_block_len, p_mode);
+    l_swap.live = create_live_filter(&g_FIR_1, l_max_taps, l_block_len, p_crossfade_len, p_mode);
+    if (l_plan1 == NULL || l_plan2 == NULL || l_swap.live == NULL)
+    {
+        destroy_filter_plan(l_plan1);
+        destroy_filter_plan(l_plan2);
+        destroy_live_filter(l_swap.live);
+        return 1;
+    }
+    execute_filter_plan(l_plan1, s_x, l_len_total, s_y1);
+    execute_filter_plan(l_plan2, s_x, l_len_total, s_y2);
+    destroy_filter_plan(l_plan1);
+    destroy_filter_plan(l_plan2);
+
+    atomic_init(&l_swap.streamed, 0);
+    atomic_init(&l_swap.done, false);
+    if (pthread_create(&l_control, NULL, live_control_main, &l_swap) != 0)
+    {
+        printf("Error. Not able to start the control thread.\n");
+        destroy_live_filter(l_swap.live);
+        return 1;
+    }
+
+    // Data thread: one block at a time, yielding between blocks as a paced stream would
+    uint32_t l_adopted_at = l_len_total;
+    for (uint32_t n = 0; n < l_len_total; n += l_block_len)
+    {
+        uint32_t l_len = (l_len_total - n < l_block_len) ? l_len_total - n : l_block_len;
+        execute_live_filter(l_swap.live, &s_x[n], l_len, &s_y[n]);
+        if (l_adopted_at == l_len_total && live_filter_swaps(l_swap.live) > 0)
+            l_adopted_at = n;
+        atomic_store(&l_swap.streamed, (uint64_t)n + l_len);
+        sched_yield();
+    }
+    atomic_store(&l_swap.done, true);
+    pthread_join(l_control, NULL);
+
+    record_output(s_y, l_len_total, DATA_FILE_SWAP);
+
+    uint32_t l_settled = (l_adopted_at + p_crossfade_len < l_len_total) ? l_adopted_at + p_crossfade_len : l_len_total;
+    uint32_t l_before = count_mismatches(s_y, s_y1, 0, l_adopted_at);
+    uint32_t l_after = count_mismatches(s_y, s_y2, l_settled, l_len_total);
+    bool l_ok = l_swap.published && l_adopted_at < l_len_total && l_before == 0 && l_after == 0;
+
+    printf("Live Swap:\n");
+    printf("Swaps: %llu\n", (unsigned long long)live_filter_swaps(l_swap.live));
+    printf("Published after sample: %u (control thread)\n", l_swap.swap_at);
+    printf("Adopted at sample: %u (data thread)\n", l_adopted_at);
+    printf("Crossfade: %u samples\n", p_crossfade_len);
+    printf("Before the swap: %s filter 1 (%u of %u samples differ)\n", l_before == 0 ? "identical to" : "DIFFERENT from",
+           l_before, l_adopted_at);
+    printf("After the crossfade: %s an uninterrupted filter 2 (%u of %u samples differ)\n",
+           l_after == 0 ? "identical to" : "DIFFERENT from", l_after, l_len_total - l_settled);
+    if (!l_ok)
+        printf("Error. The hot swap did not continue the stream exactly.\n");
+
+    destroy_live_filter(l_swap.live);
+    return l_ok ? 0 : 1;
+}
+
+static void print_usage(const char *p_program)
+{
+    printf("Usage: %s [-w wisdom_file | -R] [-p] [-l] [-k] [-d] [-f] [-T] [-a] [-H] [-b manifest [-t threads]]\n"
+           "       [-r cpu[:priority]] [-J] [-K checkpoint] [-s input filter output] [-x crossfade]\n"
+           "       [-g pipeline] [-m metrics_file | -m :port]\n", p_program);
+    printf("  -w wisdom_file  time the kernels and cache the choices in wisdom_file\n");
+    printf("  -R              reproducible plans: the same output bits on every machine, ignoring wisdom\n");
+    printf("  -p              report the error of fp16/bf16 storage against float32\n");
+    printf("  -l              compare the lookup-table engine for integer inputs with the MAC kernels\n");
+    printf("  -k              compare one filter bank pass with a pass per filter\n");
+    printf("  -d              compare reproducible plans with the scalar loops and the fastest kernel\n");
+    printf("  -f              benchmark the fast FIR decompositions against the direct and folded kernels\n");
+    printf("  -T              time every sample pushed through the tick filters: p50/p99/max ns\n");
+    printf("  -a              count the arena allocations of repeatedly created filter objects\n");
+    printf("  -H              back the arena with huge pages where the system allows\n");
+    printf("  -r cpu[:priority] real-time mode: pin filter threads from cpu on, lock and prefault\n");
+    printf("                  memory, and run them under SCHED_FIFO at priority if given\n");
+    printf("  -J              time every block of a filtering loop in normal and in real-time mode\n");
+    printf("                  (the -r settings, else CPU 0 with normal scheduling): tail latency\n");
+    printf("  -K checkpoint   stop a checkpointed %u-channel stream part way, restart it from the\n"
+           "                  checkpoint file and compare with an uninterrupted run\n", CHECKPOINT_CHANNELS);
+    printf("  -b manifest     run the '<input> <filter> <output>' jobs in manifest instead of the\n");
+    printf("                  reference signals (filters: filter1, filter2, filter1_fixed, filter2_fixed)\n");
+    printf("  -t threads      batch worker threads, default one per CPU\n");
+    printf("  -s input filter output\n");
+    printf("                  stream a sample file of any size through filter in windows\n");
+    printf("  -x crossfade    hot-swap filter1 to filter2 half way through a live stream,\n");
+    printf("                  fading over crossfade samples, and write %s\n", DATA_FILE_SWAP);
+    printf("  -g pipeline     run a block-by-block chain of comma separated stages, e.g.\n");
+    printf("                  gen:202118874:900,fir:filter1,gain:2,stats:y1,text:out.txt\n");
+    printf("                  (sources gen:digits:len, read:file, unzip:file; fir:, iir:, gain:g[:offset],\n");
+    printf("                  stats:label; sinks text:file, write:file, zip:file[:max_error])\n");
+    printf("  -m metrics_file export Prometheus metrics to metrics_file every second\n");
+    printf("  -m :port        serve Prometheus metrics on 127.0.0.1:port\n");
+}
+
 /**
  * main.c
+ *
+ * Without arguments the kernels are chosen by estimate, which keeps the
+ * output reproducible. With -w the kernels are timed on this machine and
+ * the choices are cached in wisdom_file for later runs.
  */
-int main(void)
+int main(int argc, char *argv[])
 {
     uint32_t l_reg1[REG_LENGTH] = { 2, 0, 2, 1, 1, 8, 8, 7, 4 }; // 202118874
     uint32_t l_reg2[REG_LENGTH] = { 2, 0, 2, 1, 1, 4, 6, 4, 2 }; // 202114642
 
-    float32_t l_x1[BUFF_SIZE] = { 0 };
-    float32_t l_x2[BUFF_SIZE] = { 0 };
+    const char *l_wisdom_file = NULL;
+    FIR_plan_mode_t l_mode = FIR_PLAN_ESTIMATE;
+    bool l_report_precision = false;
+    bool l_report_engines = false;
+    bool l_report_bank = false;
+    bool l_report_arena = false;
+    bool l_report_repro = false;
+    bool l_report_ffa = false;
+    bool l_report_tick = false;
+    bool l_report_jitter = false;
+    FIR_realtime_config_t l_realtime = { -1, 0, true, true };
+    bool l_realtime_set = false;
+    const char *l_checkpoint = NULL;
+    FIR_arena_config_t l_arena = { false, 0 };
+    const char *l_manifest = NULL;
+    uint32_t l_threads = 0;
+    char **l_stream = NULL;
+    int64_t l_crossfade = -1;
+    const char *l_pipeline = NULL;
+    FIR_telemetry_config_t l_metrics = { NULL, 0, 0 };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            l_wisdom_file = argv[++i];
+            l_mode = FIR_PLAN_MEASURE;
+            load_filter_wisdom(l_wisdom_file);
+        }
+        else if (strcmp(argv[i], "-p") == 0)
+        {
+            l_report_precision = true;
+        }
+        else if (strcmp(argv[i], "-l") == 0)
+        {
+            l_report_engines = true;
+        }
+        else if (strcmp(argv[i], "-k") == 0)
+        {
+            l_report_bank = true;
+        }
+        else if (strcmp(argv[i], "-R") == 0)
+        {
+            l_mode = FIR_PLAN_REPRODUCIBLE;
+        }
+        else if (strcmp(argv[i], "-d") == 0)
+        {
+            l_report_repro = true;
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            l_report_ffa = true;
+        }
+        else if (strcmp(argv[i], "-T") == 0)
+        {
+            l_report_tick = true;
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            char *l_end;
+            l_realtime.first_cpu = (int32_t)strtol(argv[++i], &l_end, 10);
+            if (*l_end == ':')
+                l_realtime.fifo_priority = (int32_t)strtol(l_end + 1, NULL, 10);
+            l_realtime_set = true;
+        }
+        else if (strcmp(argv[i], "-J") == 0)
+        {
+            l_report_jitter = true;
+        }
+        else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc)
+        {
+            l_checkpoint = argv[++i];
+        }
+        else if (strcmp(argv[i], "-a") == 0)
+        {
+            l_report_arena = true;
+        }
+        else if (strcmp(argv[i], "-H") == 0)
+        {
+            l_arena.huge_pages = true;
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            l_manifest = argv[++i];
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 3 < argc)
+        {
+            l_stream = &argv[i + 1];
+            i += 3;
+        }
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc)
+        {
+            l_crossfade = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            l_pipeline = argv[++i];
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            const char *l_target = argv[++i];
+            if (l_target[0] == ':')
+                l_metrics.port = (uint16_t)strtoul(&l_target[1], NULL, 10);
+            else
+                l_metrics.file = l_target;
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            l_threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (l_arena.huge_pages && !configure_arena(&l_arena))
+        return 1;
+
+    // -J measures the normal mode first and applies the real-time one itself
+    if (l_report_jitter)
+    {
+        if (!l_realtime_set)
+            l_realtime.first_cpu = 0;
+        return report_jitter(l_reg1, &l_realtime);
+    }
+    if (l_realtime_set)
+    {
+        if (!configure_realtime(&l_realtime))
+            return 1;
+        enter_realtime_thread(0);
+    }
+
+    if ((l_metrics.file != NULL || l_metrics.port != 0) && !start_telemetry_exporter(&l_metrics))
+        return 1;
+
+    if (l_manifest != NULL || l_stream != NULL || l_crossfade >= 0 || l_pipeline != NULL || l_checkpoint != NULL)
+    {
+        int l_status;
+        if (l_checkpoint != NULL)
+            l_status = run_checkpoint_restart(l_reg1, l_checkpoint, l_mode);
+        else if (l_manifest != NULL)
+            l_status = run_manifest(l_manifest, l_threads, l_mode);
+        else if (l_stream != NULL)
+            l_status = run_stream(l_stream[0], l_stream[1], l_stream[2], l_mode);
+        else if (l_pipeline != NULL)
+            l_status = run_pipeline_spec(l_pipeline, l_mode);
+        else
+            l_status = run_live_swap(l_reg1, (uint32_t)l_crossfade, l_mode);
+
+        if (l_wisdom_file != NULL)
+            save_filter_wisdom(l_wisdom_file);
+        stop_telemetry_exporter();
+        return l_status;
+    }
+
+    // Signals are filtered in place by the plans
     float32_t l_y1[BUFF_SIZE] = { 0 };
     float32_t l_y2[BUFF_SIZE] = { 0 };
 
-    generate_signal(l_reg1, REG_LENGTH, l_x1, BUFF_SIZE);
-    generate_signal(l_reg2, REG_LENGTH, l_x2, BUFF_SIZE);
-    
-    if(g_FIR_1.symmetric == true) 
-        symm_filter_signal(l_x1, BUFF_SIZE, &g_FIR_1, l_y1);
-    else
-        filter_signal(l_x1, BUFF_SIZE, &g_FIR_1, l_y1);
-
-    if(g_FIR_2.symmetric == true) 
-        symm_filter_signal(l_x2, BUFF_SIZE, &g_FIR_2, l_y2);
-    else
-        filter_signal(l_x2, BUFF_SIZE, &g_FIR_2, l_y2);    
-    
+    FIR_plan_t *l_plan1 = create_filter_plan(&g_FIR_1, BUFF_SIZE, l_mode);
+    FIR_plan_t *l_plan2 = create_filter_plan(&g_FIR_2, BUFF_SIZE, l_mode);
+    if (l_plan1 == NULL || l_plan2 == NULL)
+        return 1;
+
+    attach_plan_telemetry(l_plan1, register_telemetry("filter1"));
+    attach_plan_telemetry(l_plan2, register_telemetry("filter2"));
+
+    if (l_wisdom_file != NULL)
+        save_filter_wisdom(l_wisdom_file);
+
+    generate_signal(l_reg1, REG_LENGTH, l_y1, BUFF_SIZE);
+    generate_signal(l_reg2, REG_LENGTH, l_y2, BUFF_SIZE);
+
+    execute_filter_plan(l_plan1, l_y1, BUFF_SIZE, l_y1);
+    execute_filter_plan(l_plan2, l_y2, BUFF_SIZE, l_y2);
+
     record_output(l_y1, BUFF_SIZE, DATA_FILE_1);
     record_output(l_y2, BUFF_SIZE, DATA_FILE_2);
 
     print_statistics(l_y1, l_y2, BUFF_SIZE, 860, 50);
+
+    if (l_report_precision)
+    {
+        printf("Precision Against float32:\n");
+        printf("|   Signal   |  Max Error   |  RMS Error   |     SNR     |\n");
+        printf("|------------|--------------|--------------|-------------|\n");
+        report_precision(l_plan1, &g_FIR_1, l_reg1, l_y1, "y1");
+        report_precision(l_plan2, &g_FIR_2, l_reg2, l_y2, "y2");
+    }
+
+    if (l_report_engines)
+    {
+        printf("Integer Engines (* = chosen automatically):\n");
+        printf("| Signal | Bits | Engine |  Msamples/s  |  Max Error   |\n");
+        printf("|--------|------|--------|--------------|--------------|\n");
+        report_int_engines(&g_FIR_1, l_reg1, l_y1, "y1", l_mode);
+        report_int_engines(&g_FIR_2, l_reg2, l_y2, "y2", l_mode);
+    }
+
+    if (l_report_bank)
+        report_filter_bank(l_reg1);
+
+    if (l_report_repro)
+        report_reproducibility(l_reg1);
+
+    if (l_report_ffa)
+        report_fast_fir(l_reg1);
+
+    if (l_report_tick)
+        report_tick_latency(l_reg1);
+
+    if (l_report_arena)
+        report_arena(l_reg1, l_mode);
+
+    destroy_filter_plan(l_plan1);
+    destroy_filter_plan(l_plan2);
+    stop_telemetry_exporter();
     
 	return 0;
 }
@@ -0,0 +1,210 @@
+/**
+ * @file multi.c
+ * @brief Filter bank plans: several filters over one input in a single pass.
+ */
+
+#include "multi.h"
+#include "fir_target.h"
+#include "arena.h"
+#include "realtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* ------------------------------------------------------------------------- */
+/* Kernel                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * A tile is FIR_TILE consecutive outputs of the MULTI_GROUP filters of one
+ * group. The taps are walked in the outer loop as in direct_tile; at each
+ * tap the FIR_TILE input samples are loaded once and multiplied by the
+ * group's MULTI_GROUP interleaved coefficients. Outputs of the padding
+ * filters of the last group are computed but not stored.
+ */
+static inline __attribute__((always_inline))
+void multi_tile(const float32_t *p_x, uint32_t p_width, const float32_t *p_h, uint32_t N,
+                float32_t *const *p_y, uint32_t p_count, uint64_t p_offset)
+{
+    float32_t l_acc[MULTI_GROUP][FIR_TILE] = { { 0.0f } };
+
+    for (uint32_t k = 0; k < N; k++)
+    {
+        const float32_t *l_xk = p_x - k;
+        const float32_t *l_hk = &p_h[k * MULTI_GROUP];
+        #pragma GCC unroll 4  /* MULTI_GROUP: keeps the accumulators in registers */
+        for (uint32_t g = 0; g < MULTI_GROUP; g++)
+        {
+            for (uint32_t j = 0; j < p_width; j++)
+            {
+                l_acc[g][j] += l_xk[j] * l_hk[g];
+            }
+        }
+    }
+
+    for (uint32_t g = 0; g < p_count; g++)
+    {
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            p_y[g][p_offset + j] = l_acc[g][j];
+        }
+    }
+}
+
+/**
+ * @brief Runs one group of filters over a staged block.
+ *
+ * @param[in] p_x Block in the work buffer, preceded by coeff_len-1 history samples.
+ * @param[out] p_y The group's output arrays; output n of the block goes to p_y[g][p_offset + n].
+ */
+FIR_MULTIVERSION
+static void multi_kernel(const float32_t *p_x, uint32_t p_len, const float32_t *p_h, uint32_t N,
+                         float32_t *const *p_y, uint32_t p_count, uint64_t p_offset)
+{
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        multi_tile(&p_x[n], FIR_TILE, p_h, N, p_y, p_count, p_offset + n);
+    if (n < p_len)
+        multi_tile(&p_x[n], p_len - n, p_h, N, p_y, p_count, p_offset + n);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Plans                                                                     */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Creates a filter bank plan for blocks of up to p_block_len samples.
+ *
+ * The block is the cache tile: every filter runs over one staged block
+ * before the next is read, so p_block_len should keep the block and the
+ * longest filter's history within L2 (a few thousand samples).
+ *
+ * @param[in] p_filters The filters of the bank; their coefficients are copied.
+ * @param[in] p_filter_count Number of filters, K.
+ * @param[in] p_block_len Largest number of samples staged at once.
+ *
+ * @return The new plan, or NULL on failure.
+ */
+FIR_multi_plan_t *create_multi_filter_plan(FIR_filter_t *const *p_filters, uint32_t p_filter_count,
+                                           uint32_t p_block_len)
+{
+    if (p_filter_count == 0 || p_block_len == 0)
+    {
+        printf("Error. A filter bank needs at least one filter and a non-empty block.\n");
+        return NULL;
+    }
+
+    uint32_t N = 0;
+    for (uint32_t i = 0; i < p_filter_count; i++)
+    {
+        if (p_filters[i]->coeff_b_len == 0)
+        {
+            printf("Error. Filter %u of the bank has no coefficients.\n", i);
+            return NULL;
+        }
+        if (p_filters[i]->coeff_b_len > N)
+            N = p_filters[i]->coeff_b_len;
+    }
+
+    FIR_multi_plan_t *l_plan = arena_calloc(1, sizeof(FIR_multi_plan_t));
+    if (l_plan == NULL)
+        return NULL;
+
+    l_plan->filter_count = p_filter_count;
+    l_plan->group_count = (p_filter_count + MULTI_GROUP - 1) / MULTI_GROUP;
+    l_plan->coeff_len = N;
+    l_plan->block_len = p_block_len;
+
+    size_t l_coeffs_len = (size_t)l_plan->group_count * N * MULTI_GROUP;
+    l_plan->coeffs = arena_alloc(l_coeffs_len * sizeof(float32_t));
+    l_plan->work = arena_alloc((N - 1 + p_block_len) * sizeof(float32_t));
+    if (l_plan->coeffs == NULL || l_plan->work == NULL)
+    {
+        printf("Error. Not able to allocate a bank of %u filters of %u taps.\n", p_filter_count, N);
+        destroy_multi_filter_plan(l_plan);
+        return NULL;
+    }
+    prefault_memory(l_plan->work, (N - 1 + p_block_len) * sizeof(float32_t));
+
+    // Group-major, then tap, then filter within the group
+    memset(l_plan->coeffs, 0, l_coeffs_len * sizeof(float32_t));
+    for (uint32_t i = 0; i < p_filter_count; i++)
+    {
+        float32_t *l_group = &l_plan->coeffs[(size_t)(i / MULTI_GROUP) * N * MULTI_GROUP];
+        for (uint32_t k = 0; k < p_filters[i]->coeff_b_len; k++)
+        {
+            l_group[k * MULTI_GROUP + i % MULTI_GROUP] = p_filters[i]->coeff_b_ptr[k];
+        }
+    }
+
+    reset_multi_filter_plan(l_plan);
+    return l_plan;
+}
+
+/**
+ * @brief Filters one signal with every filter of the bank.
+ *
+ * The input is read once, one block at a time, whatever the number of
+ * filters. As with execute_filter_plan the history is kept between calls,
+ * so a long signal may be passed in pieces, and any output may alias the input.
+ *
+ * @param[in,out] p_plan Pointer to the bank plan.
+ * @param[in] p_input Pointer to the input signal array.
+ * @param[in] p_input_len Length of the input signal.
+ * @param[out] p_outputs One output array of p_input_len samples per filter, in bank order.
+ *
+ * @return void
+ */
+void execute_multi_filter_plan(FIR_multi_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len,
+                               float32_t *const *p_outputs)
+{
+    uint32_t N = p_plan->coeff_len;
+    uint32_t l_history_len = N - 1;
+    float32_t *l_block = &p_plan->work[l_history_len];
+
+    for (uint64_t l_done = 0; l_done < p_input_len; )
+    {
+        uint32_t l_len = p_plan->block_len;
+        if (p_input_len - l_done < l_len)
+            l_len = (uint32_t)(p_input_len - l_done);
+
+        memcpy(l_block, &p_input[l_done], l_len * sizeof(float32_t));
+        for (uint32_t g = 0; g < p_plan->group_count; g++)
+        {
+            uint32_t l_first = g * MULTI_GROUP;
+            uint32_t l_count = p_plan->filter_count - l_first;
+            if (l_count > MULTI_GROUP)
+                l_count = MULTI_GROUP;
+
+            multi_kernel(l_block, l_len, &p_plan->coeffs[(size_t)g * N * MULTI_GROUP], N,
+                         &p_outputs[l_first], l_count, l_done);
+        }
+
+        memmove(p_plan->work, &p_plan->work[l_len], l_history_len * sizeof(float32_t));
+        l_done += l_len;
+    }
+}
+
+/**
+ * @brief Clears the bank's history so the next call starts a new signal.
+ */
+void reset_multi_filter_plan(FIR_multi_plan_t *p_plan)
+{
+    memset(p_plan->work, 0, (p_plan->coeff_len - 1 + p_plan->block_len) * sizeof(float32_t));
+}
+
+/**
+ * @brief Releases a filter bank plan. Accepts NULL.
+ */
+void destroy_multi_filter_plan(FIR_multi_plan_t *p_plan)
+{
+    if (p_plan == NULL)
+        return;
+
+    arena_free(p_plan->coeffs);
+    arena_free(p_plan->work);
+    arena_free(p_plan);
+}
@@ -0,0 +1,921 @@
+/**
+ * @file pipeline.c
+ * @brief Block-by-block processing chains with fused elementwise stages.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+#include "fir_target.h"
+#include "sample_io.h"
+#include "codec.h"
+#include "stream.h"
+#include "arena.h"
+#include "realtime.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef enum {
+    STAGE_GENERATOR = 0,
+    STAGE_SOURCE,
+    STAGE_FILE_SOURCE,
+    STAGE_CODEC_SOURCE,
+    STAGE_FIR,
+    STAGE_IIR,
+    STAGE_GAIN,
+    STAGE_STATS,
+    STAGE_ARRAY_SINK,
+    STAGE_TEXT_SINK,
+    STAGE_FILE_SINK,
+    STAGE_CODEC_SINK
+} stage_kind_t;
+
+typedef struct {
+    stage_kind_t         kind;
+    uint32_t             run_len;      /* elementwise stages: stages in the fused run starting here */
+    /* sources */
+    const float32_t     *samples;      /* source array or generator digits */
+    void                *owned;        /* buffer freed with the stage */
+    FIR_sample_type_t    type;
+    uint64_t             len;          /* samples the source produces */
+    uint32_t             period;       /* generator: number of digits */
+    uint32_t             phase;        /* generator: index of the next digit */
+    /* filters */
+    FIR_plan_t          *plan;
+    uint32_t             order;        /* IIR: number of state variables */
+    float32_t           *b;            /* IIR: order+1 coefficients each, normalised by a[0] */
+    float32_t           *a;
+    float32_t           *state;
+    /* gain */
+    float32_t            gain;
+    float32_t            offset;
+    /* statistics, accumulated per lane and folded into stats at the end of the run */
+    FIR_pipeline_stats_t stats;
+    double               lane_sum[FIR_TILE];
+    double               lane_sq[FIR_TILE];
+    float32_t            lane_min[FIR_TILE];
+    float32_t            lane_max[FIR_TILE];
+    /* sinks */
+    float32_t           *output;
+    uint64_t             capacity;
+    uint64_t             written;
+    FILE                *file;
+    char                 filename[BATCH_PATH_MAX];
+    FIR_stream_reader_t *stream;       /* sample file source, read a block at a time */
+    /* compressed files */
+    FIR_codec_reader_t  *reader;
+    FIR_codec_writer_t  *writer;
+    FIR_codec_report_t   codec_report;
+    bool                 failed;
+} stage_t;
+
+struct FIR_pipeline {
+    uint32_t   block_len;
+    uint32_t   stage_count;
+    stage_t    stages[PIPELINE_MAX_STAGES];
+    float32_t *block;
+    uint64_t   produced;   /* samples taken from the source so far */
+    bool       done;
+};
+
+static bool is_source(stage_kind_t p_kind)
+{
+    return p_kind == STAGE_GENERATOR || p_kind == STAGE_SOURCE || p_kind == STAGE_FILE_SOURCE
+           || p_kind == STAGE_CODEC_SOURCE;
+}
+
+static bool is_elementwise(stage_kind_t p_kind)
+{
+    return p_kind == STAGE_GAIN || p_kind == STAGE_STATS;
+}
+
+/**
+ * @brief Appends a stage of the given kind, checking that sources come first and only once.
+ */
+static stage_t *add_stage(FIR_pipeline_t *p_pipeline, stage_kind_t p_kind)
+{
+    if (p_pipeline->stage_count == PIPELINE_MAX_STAGES)
+    {
+        printf("Error. A pipeline holds at most %u stages.\n", PIPELINE_MAX_STAGES);
+        return NULL;
+    }
+    if (is_source(p_kind) != (p_pipeline->stage_count == 0))
+    {
+        printf("Error. A pipeline starts with exactly one source.\n");
+        return NULL;
+    }
+
+    stage_t *l_stage = &p_pipeline->stages[p_pipeline->stage_count++];
+    memset(l_stage, 0, sizeof(*l_stage));
+    l_stage->kind = p_kind;
+    return l_stage;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Building                                                                  */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Creates an empty pipeline processing p_block_len samples at a time.
+ *
+ * @param[in] p_block_len Samples per block, 0 for PIPELINE_DEFAULT_BLOCK.
+ *
+ * @return The new pipeline, or NULL on failure.
+ */
+FIR_pipeline_t *create_pipeline(uint32_t p_block_len)
+{
+    FIR_pipeline_t *l_pipeline = arena_calloc(1, sizeof(FIR_pipeline_t));
+    if (l_pipeline == NULL)
+        return NULL;
+
+    l_pipeline->block_len = p_block_len ? p_block_len : PIPELINE_DEFAULT_BLOCK;
+    l_pipeline->block = arena_alloc(l_pipeline->block_len * sizeof(float32_t));
+    if (l_pipeline->block == NULL)
+    {
+        printf("Error. Not able to allocate a pipeline block of %u samples.\n", l_pipeline->block_len);
+        arena_free(l_pipeline);
+        return NULL;
+    }
+    prefault_memory(l_pipeline->block, l_pipeline->block_len * sizeof(float32_t));
+
+    return l_pipeline;
+}
+
+/**
+ * @brief Adds the source of generate_signal: the mean-centred digits, repeated.
+ *
+ * As with generate_signal only whole repetitions are produced, so the
+ * source yields p_len rounded down to a multiple of p_digit_len samples.
+ */
+bool pipeline_add_generator(FIR_pipeline_t *p_pipeline, const uint32_t *p_digits, uint32_t p_digit_len,
+                            uint64_t p_len)
+{
+    if (p_digit_len == 0)
+    {
+        printf("Error. A generator needs at least one digit.\n");
+        return false;
+    }
+
+    float32_t *l_values = arena_alloc(p_digit_len * sizeof(float32_t));
+    if (l_values == NULL)
+        return false;
+
+    float32_t l_mean;
+    calculate_mean((uint32_t *)p_digits, p_digit_len, &l_mean);
+    for (uint32_t i = 0; i < p_digit_len; i++)
+    {
+        l_values[i] = (float32_t)p_digits[i] - l_mean;
+    }
+
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_GENERATOR);
+    if (l_stage == NULL)
+    {
+        arena_free(l_values);
+        return false;
+    }
+    l_stage->samples = l_values;
+    l_stage->owned = l_values;
+    l_stage->period = p_digit_len;
+    l_stage->len = p_len - p_len % p_digit_len;
+    return true;
+}
+
+/**
+ * @brief Adds a source reading p_len samples from a caller array, which must outlive the run.
+ */
+bool pipeline_add_source(FIR_pipeline_t *p_pipeline, const float32_t *p_samples, uint64_t p_len)
+{
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_SOURCE);
+    if (l_stage == NULL)
+        return false;
+
+    l_stage->samples = p_samples;
+    l_stage->type = FIR_SAMPLE_F32;
+    l_stage->len = p_len;
+    return true;
+}
+
+/**
+ * @brief Adds a source reading a sample file of any sample type; blocks are widened to float32 as they are read.
+ *
+ * The file is mapped and read one block at a time through a stream reader
+ * (stream.h), which prefetches ahead and drops what has been read, so the
+ * memory used does not grow with the file.
+ */
+bool pipeline_add_file_source(FIR_pipeline_t *p_pipeline, const char *p_filename)
+{
+    FIR_stream_reader_t *l_reader = open_stream_reader(p_filename, p_pipeline->block_len, true);
+    if (l_reader == NULL)
+        return false;
+
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_FILE_SOURCE);
+    if (l_stage == NULL)
+    {
+        close_stream_reader(l_reader);
+        return false;
+    }
+    l_stage->stream = l_reader;
+    l_stage->type = stream_reader_type(l_reader);
+    l_stage->len = stream_reader_samples(l_reader);
+    return true;
+}
+
+/**
+ * @brief Adds a source decoding a compressed signal file block by block.
+ */
+bool pipeline_add_codec_source(FIR_pipeline_t *p_pipeline, const char *p_filename)
+{
+    FIR_codec_reader_t *l_reader = open_codec_reader(p_filename);
+    if (l_reader == NULL)
+        return false;
+
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_CODEC_SOURCE);
+    if (l_stage == NULL)
+    {
+        close_codec_reader(l_reader);
+        return false;
+    }
+    l_stage->reader = l_reader;
+    l_stage->len = codec_sample_count(l_reader);
+    return true;
+}
+
+/**
+ * @brief Adds an FIR filter, run through a plan sized to the pipeline block.
+ */
+bool pipeline_add_fir(FIR_pipeline_t *p_pipeline, FIR_filter_t *p_filter, FIR_plan_mode_t p_mode)
+{
+    FIR_plan_t *l_plan = create_filter_plan(p_filter, p_pipeline->block_len, p_mode);
+    if (l_plan == NULL)
+        return false;
+
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_FIR);
+    if (l_stage == NULL)
+    {
+        destroy_filter_plan(l_plan);
+        return false;
+    }
+    l_stage->plan = l_plan;
+    return true;
+}
+
+/**
+ * @brief Adds a recursive filter using both the b and a coefficients of p_filter.
+ *
+ * The filter runs in direct form II transposed with max(b_len, a_len) - 1
+ * state variables; the coefficients are normalised by a[0].
+ */
+bool pipeline_add_iir(FIR_pipeline_t *p_pipeline, FIR_filter_t *p_filter)
+{
+    uint32_t l_nb = p_filter->coeff_b_len;
+    uint32_t l_na = p_filter->coeff_a_len;
+    if (l_nb == 0 || l_na == 0 || p_filter->coeff_a_ptr[0] == 0.0f)
+    {
+        printf("Error. An IIR stage needs b coefficients and a non-zero a[0].\n");
+        return false;
+    }
+
+    uint32_t l_order = ((l_nb > l_na) ? l_nb : l_na) - 1;
+    float32_t *l_coeffs = arena_calloc(2 * (l_order + 1) + (l_order ? l_order : 1), sizeof(float32_t));
+    if (l_coeffs == NULL)
+        return false;
+
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_IIR);
+    if (l_stage == NULL)
+    {
+        arena_free(l_coeffs);
+        return false;
+    }
+
+    l_stage->owned = l_coeffs;
+    l_stage->order = l_order;
+    l_stage->b = l_coeffs;
+    l_stage->a = &l_coeffs[l_order + 1];
+    l_stage->state = &l_coeffs[2 * (l_order + 1)];
+
+    float32_t l_a0 = p_filter->coeff_a_ptr[0];
+    for (uint32_t k = 0; k < l_nb; k++)
+    {
+        l_stage->b[k] = p_filter->coeff_b_ptr[k] / l_a0;
+    }
+    for (uint32_t k = 0; k < l_na; k++)
+    {
+        l_stage->a[k] = p_filter->coeff_a_ptr[k] / l_a0;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds y = p_gain * x + p_offset.
+ */
+bool pipeline_add_gain(FIR_pipeline_t *p_pipeline, float32_t p_gain, float32_t p_offset)
+{
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_GAIN);
+    if (l_stage == NULL)
+        return false;
+
+    l_stage->gain = p_gain;
+    l_stage->offset = p_offset;
+    return true;
+}
+
+/**
+ * @brief Adds a statistics tap; samples pass through unchanged. See pipeline_stats().
+ */
+bool pipeline_add_stats(FIR_pipeline_t *p_pipeline, const char *p_label)
+{
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_STATS);
+    if (l_stage == NULL)
+        return false;
+
+    snprintf(l_stage->stats.label, sizeof(l_stage->stats.label), "%s", p_label);
+    l_stage->stats.min = INFINITY;
+    l_stage->stats.max = -INFINITY;
+    for (uint32_t j = 0; j < FIR_TILE; j++)
+    {
+        l_stage->lane_min[j] = INFINITY;
+        l_stage->lane_max[j] = -INFINITY;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a sink copying up to p_capacity samples into a caller array.
+ */
+bool pipeline_add_array_sink(FIR_pipeline_t *p_pipeline, float32_t *p_samples, uint64_t p_capacity)
+{
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_ARRAY_SINK);
+    if (l_stage == NULL)
+        return false;
+
+    l_stage->output = p_samples;
+    l_stage->capacity = p_capacity;
+    return true;
+}
+
+static bool add_file_sink(FIR_pipeline_t *p_pipeline, stage_kind_t p_kind, const char *p_filename)
+{
+    FILE *l_file = fopen(p_filename, (p_kind == STAGE_FILE_SINK) ? "wb" : "w");
+    if (l_file == NULL)
+    {
+        printf("Error. Not able to open file %s for writing.\n", p_filename);
+        return false;
+    }
+
+    stage_t *l_stage = add_stage(p_pipeline, p_kind);
+    if (l_stage == NULL)
+    {
+        fclose(l_file);
+        return false;
+    }
+    l_stage->file = l_file;
+    snprintf(l_stage->filename, sizeof(l_stage->filename), "%s", p_filename);
+
+    if (p_kind == STAGE_FILE_SINK)
+    {
+        // The sample count is filled in when the run ends
+        FIR_sample_header_t l_header = { .version = SAMPLE_FILE_VERSION, .sample_type = FIR_SAMPLE_F32 };
+        memcpy(l_header.magic, SAMPLE_FILE_MAGIC, sizeof(l_header.magic));
+        fwrite(&l_header, sizeof(l_header), 1, l_file);
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a sink writing comma separated text in the format of record_output.
+ */
+bool pipeline_add_text_sink(FIR_pipeline_t *p_pipeline, const char *p_filename)
+{
+    return add_file_sink(p_pipeline, STAGE_TEXT_SINK, p_filename);
+}
+
+/**
+ * @brief Adds a sink writing a float32 sample file.
+ */
+bool pipeline_add_file_sink(FIR_pipeline_t *p_pipeline, const char *p_filename)
+{
+    return add_file_sink(p_pipeline, STAGE_FILE_SINK, p_filename);
+}
+
+
+/**
+ * @brief Adds a sink writing a compressed signal file; see codec.h.
+ *
+ * @param[in] p_max_error Largest absolute error allowed per sample, 0 for lossless.
+ */
+bool pipeline_add_codec_sink(FIR_pipeline_t *p_pipeline, const char *p_filename, float32_t p_max_error)
+{
+    FIR_codec_writer_t *l_writer = open_codec_writer(p_filename, p_max_error, 0);
+    if (l_writer == NULL)
+        return false;
+
+    stage_t *l_stage = add_stage(p_pipeline, STAGE_CODEC_SINK);
+    if (l_stage == NULL)
+    {
+        close_codec_writer(l_writer, NULL);
+        return false;
+    }
+    l_stage->writer = l_writer;
+    snprintf(l_stage->filename, sizeof(l_stage->filename), "%s", p_filename);
+    return true;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Parsing                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static FIR_filter_t *find_bank_filter(const FIR_bank_entry_t *p_bank, uint32_t p_bank_len, const char *p_name)
+{
+    for (uint32_t i = 0; i < p_bank_len; i++)
+    {
+        if (strcmp(p_bank[i].name, p_name) == 0)
+            return p_bank[i].filter;
+    }
+    printf("Error. Unknown filter '%s'.\n", p_name);
+    return NULL;
+}
+
+/**
+ * @brief Adds the stage described by one "kind:argument" element of a pipeline spec.
+ */
+static bool add_parsed_stage(FIR_pipeline_t *p_pipeline, char *p_element, const FIR_bank_entry_t *p_bank,
+                             uint32_t p_bank_len, FIR_plan_mode_t p_mode)
+{
+    char *l_arg = strchr(p_element, ':');
+    if (l_arg != NULL)
+        *l_arg++ = '\0';
+    else
+        l_arg = "";
+
+    if (strcmp(p_element, "gen") == 0)
+    {
+        uint32_t l_digits[64];
+        uint32_t l_digit_len = 0;
+        char *l_end = l_arg;
+        while (*l_end >= '0' && *l_end <= '9' && l_digit_len < 64)
+            l_digits[l_digit_len++] = (uint32_t)(*l_end++ - '0');
+        if (*l_end != ':')
+        {
+            printf("Error. Expected gen:<digits>:<length>.\n");
+            return false;
+        }
+        return pipeline_add_generator(p_pipeline, l_digits, l_digit_len, strtoull(l_end + 1, NULL, 10));
+    }
+    if (strcmp(p_element, "read") == 0)
+        return pipeline_add_file_source(p_pipeline, l_arg);
+    if (strcmp(p_element, "fir") == 0 || strcmp(p_element, "iir") == 0)
+    {
+        FIR_filter_t *l_filter = find_bank_filter(p_bank, p_bank_len, l_arg);
+        if (l_filter == NULL)
+            return false;
+        return (p_element[0] == 'f') ? pipeline_add_fir(p_pipeline, l_filter, p_mode)
+                                     : pipeline_add_iir(p_pipeline, l_filter);
+    }
+    if (strcmp(p_element, "gain") == 0)
+    {
+        char *l_end;
+        float32_t l_gain = strtof(l_arg, &l_end);
+        float32_t l_offset = (*l_end == ':') ? strtof(l_end + 1, NULL) : 0.0f;
+        return pipeline_add_gain(p_pipeline, l_gain, l_offset);
+    }
+    if (strcmp(p_element, "stats") == 0)
+        return pipeline_add_stats(p_pipeline, l_arg);
+    if (strcmp(p_element, "text") == 0)
+        return pipeline_add_text_sink(p_pipeline, l_arg);
+    if (strcmp(p_element, "write") == 0)
+        return pipeline_add_file_sink(p_pipeline, l_arg);
+    if (strcmp(p_element, "unzip") == 0)
+        return pipeline_add_codec_source(p_pipeline, l_arg);
+    if (strcmp(p_element, "zip") == 0)
+    {
+        // An error bound after the last ':' is optional; file names may contain ':'
+        char *l_bound = strrchr(l_arg, ':');
+        float32_t l_max_error = 0.0f;
+        if (l_bound != NULL)
+        {
+            char *l_end;
+            float32_t l_value = strtof(l_bound + 1, &l_end);
+            if (l_end != l_bound + 1 && *l_end == '\0')
+            {
+                *l_bound = '\0';
+                l_max_error = l_value;
+            }
+        }
+        return pipeline_add_codec_sink(p_pipeline, l_arg, l_max_error);
+    }
+
+    printf("Error. Unknown pipeline stage '%s'.\n", p_element);
+    return false;
+}
+
+/**
+ * @brief Builds a pipeline from its text description; see pipeline.h for the syntax.
+ *
+ * @param[in] p_spec Stages separated by commas, source first.
+ * @param[in] p_bank Filters that fir: and iir: stages refer to by name.
+ * @param[in] p_bank_len Number of bank entries.
+ * @param[in] p_block_len Samples per block, 0 for PIPELINE_DEFAULT_BLOCK.
+ * @param[in] p_mode How FIR stages choose their kernel.
+ *
+ * @return The new pipeline, or NULL if the description is invalid.
+ */
+FIR_pipeline_t *parse_pipeline(const char *p_spec, const FIR_bank_entry_t *p_bank, uint32_t p_bank_len,
+                               uint32_t p_block_len, FIR_plan_mode_t p_mode)
+{
+    FIR_pipeline_t *l_pipeline = create_pipeline(p_block_len);
+    char *l_spec = strdup(p_spec);
+    if (l_pipeline == NULL || l_spec == NULL)
+    {
+        destroy_pipeline(l_pipeline);
+        free(l_spec);
+        return NULL;
+    }
+
+    char *l_save = NULL;
+    for (char *l_element = strtok_r(l_spec, ",", &l_save); l_element != NULL;
+         l_element = strtok_r(NULL, ",", &l_save))
+    {
+        if (!add_parsed_stage(l_pipeline, l_element, p_bank, p_bank_len, p_mode))
+        {
+            destroy_pipeline(l_pipeline);
+            free(l_spec);
+            return NULL;
+        }
+    }
+
+    free(l_spec);
+    return l_pipeline;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Running                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Fills the block from the source and returns the number of samples, 0 at the end.
+ */
+static uint32_t produce_block(FIR_pipeline_t *p_pipeline, stage_t *p_source)
+{
+    uint64_t l_left = p_source->len - p_pipeline->produced;
+    uint32_t l_len = (l_left < p_pipeline->block_len) ? (uint32_t)l_left : p_pipeline->block_len;
+    float32_t *l_block = p_pipeline->block;
+
+    if (p_source->kind == STAGE_CODEC_SOURCE)
+    {
+        // A damaged block ends the signal early; the reader reports it
+        l_len = (uint32_t)read_codec_samples(p_source->reader, l_block, l_len);
+    }
+    else if (p_source->kind == STAGE_GENERATOR)
+    {
+        uint32_t l_phase = p_source->phase;
+        for (uint32_t n = 0; n < l_len; n++)
+        {
+            l_block[n] = p_source->samples[l_phase];
+            if (++l_phase == p_source->period)
+                l_phase = 0;
+        }
+        p_source->phase = l_phase;
+    }
+    else if (p_source->kind == STAGE_FILE_SOURCE)
+    {
+        // A read error ends the signal early; run_pipeline() reports it
+        if (l_len > 0 && !read_stream_samples(p_source->stream, l_block, l_len))
+        {
+            p_source->failed = true;
+            l_len = 0;
+        }
+    }
+    else
+    {
+        memcpy(l_block, &p_source->samples[p_pipeline->produced], l_len * sizeof(float32_t));
+    }
+
+    p_pipeline->produced += l_len;
+    return l_len;
+}
+
+static void iir_block(stage_t *p_stage, float32_t *p_block, uint32_t p_len)
+{
+    uint32_t M = p_stage->order;
+    const float32_t *b = p_stage->b;
+    const float32_t *a = p_stage->a;
+    float32_t *z = p_stage->state;
+
+    for (uint32_t n = 0; n < p_len; n++)
+    {
+        float32_t x = p_block[n];
+        float32_t y = b[0] * x + ((M > 0) ? z[0] : 0.0f);
+        for (uint32_t i = 0; i + 1 < M; i++)
+        {
+            z[i] = z[i + 1] + b[i + 1] * x - a[i + 1] * y;
+        }
+        if (M > 0)
+            z[M - 1] = b[M] * x - a[M] * y;
+        p_block[n] = y;
+    }
+}
+
+/*
+ * One tile of a fused elementwise run: the FIR_TILE samples are loaded
+ * once, pass through every stage of the run and are stored once.
+ */
+static inline __attribute__((always_inline))
+void elementwise_tile(stage_t *p_run, uint32_t p_run_len, float32_t *p_x, uint32_t p_width)
+{
+    float32_t l_v[FIR_TILE];
+
+    for (uint32_t j = 0; j < p_width; j++)
+        l_v[j] = p_x[j];
+
+    for (uint32_t s = 0; s < p_run_len; s++)
+    {
+        stage_t *l_stage = &p_run[s];
+        if (l_stage->kind == STAGE_GAIN)
+        {
+            for (uint32_t j = 0; j < p_width; j++)
+                l_v[j] = l_v[j] * l_stage->gain + l_stage->offset;
+        }
+        else
+        {
+            for (uint32_t j = 0; j < p_width; j++)
+            {
+                l_stage->lane_sum[j] += l_v[j];
+                l_stage->lane_sq[j] += (double)l_v[j] * l_v[j];
+                l_stage->lane_min[j] = (l_v[j] < l_stage->lane_min[j]) ? l_v[j] : l_stage->lane_min[j];
+                l_stage->lane_max[j] = (l_v[j] > l_stage->lane_max[j]) ? l_v[j] : l_stage->lane_max[j];
+            }
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+        p_x[j] = l_v[j];
+}
+
+/**
+ * @brief Runs a fused run of elementwise stages over the block in one loop.
+ */
+FIR_MULTIVERSION
+static void elementwise_block(stage_t *p_run, uint32_t p_run_len, float32_t *p_block, uint32_t p_len)
+{
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        elementwise_tile(p_run, p_run_len, &p_block[n], FIR_TILE);
+    if (n < p_len)
+        elementwise_tile(p_run, p_run_len, &p_block[n], p_len - n);
+    for (uint32_t s = 0; s < p_run_len; s++)
+    {
+        if (p_run[s].kind == STAGE_STATS)
+            p_run[s].stats.count += p_len;
+    }
+}
+
+/* Epilogue of a FIR stage: the elementwise run after it, applied to each kernel tile */
+static void elementwise_epilogue(void *p_context, float32_t *p_y, uint32_t p_len)
+{
+    stage_t *l_run = p_context;
+    elementwise_block(l_run, l_run->run_len, p_y, p_len);
+}
+
+static void consume_block(stage_t *p_stage, const float32_t *p_block, uint32_t p_len)
+{
+    switch (p_stage->kind)
+    {
+        case STAGE_ARRAY_SINK:
+        {
+            uint64_t l_room = p_stage->capacity - p_stage->written;
+            uint64_t l_len = (p_len < l_room) ? p_len : l_room;
+            memcpy(&p_stage->output[p_stage->written], p_block, l_len * sizeof(float32_t));
+            p_stage->written += l_len;
+            break;
+        }
+        case STAGE_TEXT_SINK:
+            for (uint32_t n = 0; n < p_len; n++)
+            {
+                fprintf(p_stage->file, (p_stage->written + n == 0) ? "%f" : ",%f", p_block[n]);
+            }
+            p_stage->written += p_len;
+            break;
+        case STAGE_FILE_SINK:
+            fwrite(p_block, sizeof(float32_t), p_len, p_stage->file);
+            p_stage->written += p_len;
+            break;
+        case STAGE_CODEC_SINK:
+            if (!p_stage->failed && !write_codec_samples(p_stage->writer, p_block, p_len))
+                p_stage->failed = true;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Folds the lane accumulators of the statistics taps and closes the sinks.
+ */
+static bool finish_stages(FIR_pipeline_t *p_pipeline)
+{
+    bool l_ok = true;
+
+    for (uint32_t i = 0; i < p_pipeline->stage_count; i++)
+    {
+        stage_t *l_stage = &p_pipeline->stages[i];
+        if (l_stage->kind == STAGE_STATS)
+        {
+            for (uint32_t j = 0; j < FIR_TILE; j++)
+            {
+                l_stage->stats.sum += l_stage->lane_sum[j];
+                l_stage->stats.sum_sq += l_stage->lane_sq[j];
+                if (l_stage->lane_min[j] < l_stage->stats.min)
+                    l_stage->stats.min = l_stage->lane_min[j];
+                if (l_stage->lane_max[j] > l_stage->stats.max)
+                    l_stage->stats.max = l_stage->lane_max[j];
+            }
+        }
+        else if (l_stage->writer != NULL)
+        {
+            if (!close_codec_writer(l_stage->writer, &l_stage->codec_report) || l_stage->failed)
+                l_ok = false;
+            l_stage->writer = NULL;
+        }
+        else if (l_stage->file != NULL)
+        {
+            bool l_written = true;
+            if (l_stage->kind == STAGE_FILE_SINK)
+            {
+                FIR_sample_header_t l_header = { .version = SAMPLE_FILE_VERSION, .sample_type = FIR_SAMPLE_F32,
+                                                 .sample_count = l_stage->written };
+                memcpy(l_header.magic, SAMPLE_FILE_MAGIC, sizeof(l_header.magic));
+                l_written = fseek(l_stage->file, 0, SEEK_SET) == 0
+                            && fwrite(&l_header, sizeof(l_header), 1, l_stage->file) == 1;
+            }
+            // Closed whatever happened, and only this sink's own failure is reported
+            l_written = !ferror(l_stage->file) && l_written;
+            l_written = (fclose(l_stage->file) == 0) && l_written;
+            if (!l_written)
+            {
+                printf("Error. Not able to write %s.\n", l_stage->filename);
+                l_ok = false;
+            }
+            l_stage->file = NULL;
+        }
+    }
+
+    return l_ok;
+}
+
+/**
+ * @brief Runs the pipeline until its source is exhausted. A pipeline runs once.
+ *
+ * @param[in,out] p_pipeline Pointer to the pipeline.
+ * @param[out] p_report Where to store the run summary, or NULL.
+ *
+ * @return false if the pipeline has no source, has already run, or its source could not be read or a
+ *         sink written.
+ */
+bool run_pipeline(FIR_pipeline_t *p_pipeline, FIR_pipeline_report_t *p_report)
+{
+    if (p_pipeline->stage_count == 0 || p_pipeline->done)
+    {
+        printf("Error. The pipeline has no source or has already run.\n");
+        return false;
+    }
+
+    // Group consecutive elementwise stages into fused runs; a run right after a FIR stage joins its pass
+    uint32_t l_passes = 1;
+    for (uint32_t i = 1; i < p_pipeline->stage_count; )
+    {
+        uint32_t l_end = i;
+        while (l_end < p_pipeline->stage_count && is_elementwise(p_pipeline->stages[l_end].kind))
+            l_end++;
+        p_pipeline->stages[i].run_len = l_end - i;
+        if (l_end == i || p_pipeline->stages[i - 1].kind != STAGE_FIR)
+            l_passes++;
+        i = (l_end > i) ? l_end : i + 1;
+    }
+
+    uint64_t l_start = telemetry_now_ns();
+    uint64_t l_blocks = 0;
+    stage_t *l_source = &p_pipeline->stages[0];
+    float32_t *l_block = p_pipeline->block;
+
+    for (uint32_t l_len; (l_len = produce_block(p_pipeline, l_source)) > 0; l_blocks++)
+    {
+        for (uint32_t i = 1; i < p_pipeline->stage_count; i++)
+        {
+            stage_t *l_stage = &p_pipeline->stages[i];
+            switch (l_stage->kind)
+            {
+                case STAGE_FIR:
+                    if (i + 1 < p_pipeline->stage_count && is_elementwise(l_stage[1].kind))
+                    {
+                        execute_filter_plan_fused(l_stage->plan, l_block, l_len, l_block, elementwise_epilogue,
+                                                  &l_stage[1]);
+                        i += l_stage[1].run_len;
+                    }
+                    else
+                        execute_filter_plan(l_stage->plan, l_block, l_len, l_block);
+                    break;
+                case STAGE_IIR:
+                    iir_block(l_stage, l_block, l_len);
+                    break;
+                case STAGE_GAIN:
+                case STAGE_STATS:
+                    elementwise_block(l_stage, l_stage->run_len, l_block, l_len);
+                    i += l_stage->run_len - 1;
+                    break;
+                default:
+                    consume_block(l_stage, l_block, l_len);
+                    break;
+            }
+        }
+    }
+
+    p_pipeline->done = true;
+    bool l_ok = finish_stages(p_pipeline) && !l_source->failed;
+
+    if (p_report != NULL)
+    {
+        p_report->samples = p_pipeline->produced;
+        p_report->blocks = l_blocks;
+        p_report->stages = p_pipeline->stage_count;
+        p_report->passes = l_passes;
+        p_report->wall_s = (double)(telemetry_now_ns() - l_start) * 1e-9;
+    }
+    return l_ok;
+}
+
+/**
+ * @brief Returns the p_index-th statistics tap of the pipeline, or NULL if there is none.
+ */
+const FIR_pipeline_stats_t *pipeline_stats(const FIR_pipeline_t *p_pipeline, uint32_t p_index)
+{
+    for (uint32_t i = 0; i < p_pipeline->stage_count; i++)
+    {
+        if (p_pipeline->stages[i].kind == STAGE_STATS && p_index-- == 0)
+            return &p_pipeline->stages[i].stats;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Prints the run summary and the statistics taps of a pipeline.
+ */
+void print_pipeline_report(const FIR_pipeline_t *p_pipeline, const FIR_pipeline_report_t *p_report)
+{
+    printf("Pipeline:\n");
+    printf("Stages: %u in %u passes per block\n", p_report->stages, p_report->passes);
+    printf("Samples: %llu in %llu blocks of %u\n", (unsigned long long)p_report->samples,
+           (unsigned long long)p_report->blocks, p_pipeline->block_len);
+    printf("Wall time: %.3f s (%.2f Msamples/s)\n", p_report->wall_s,
+           (p_report->wall_s > 0.0) ? (double)p_report->samples / p_report->wall_s * 1e-6 : 0.0);
+
+    for (uint32_t i = 0; i < p_pipeline->stage_count; i++)
+    {
+        if (p_pipeline->stages[i].kind == STAGE_CODEC_SINK)
+            print_codec_report(p_pipeline->stages[i].filename, &p_pipeline->stages[i].codec_report);
+    }
+
+    const FIR_pipeline_stats_t *l_stats = pipeline_stats(p_pipeline, 0);
+    if (l_stats == NULL)
+        return;
+
+    printf("|    Tap     |    Count     |     Mean     |     RMS      |     Min      |     Max      |\n");
+    printf("|------------|--------------|--------------|--------------|--------------|--------------|\n");
+    for (uint32_t i = 0; (l_stats = pipeline_stats(p_pipeline, i)) != NULL; i++)
+    {
+        double l_count = (l_stats->count > 0) ? (double)l_stats->count : 1.0;
+        printf("| %-10s | %12llu | %12.6f | %12.6f | %12.6f | %12.6f |\n", l_stats->label,
+               (unsigned long long)l_stats->count, l_stats->sum / l_count, sqrt(l_stats->sum_sq / l_count),
+               l_stats->min, l_stats->max);
+    }
+}
+
+/**
+ * @brief Releases a pipeline, its plans and buffers, closing any sink not yet closed. Accepts NULL.
+ */
+void destroy_pipeline(FIR_pipeline_t *p_pipeline)
+{
+    if (p_pipeline == NULL)
+        return;
+
+    for (uint32_t i = 0; i < p_pipeline->stage_count; i++)
+    {
+        stage_t *l_stage = &p_pipeline->stages[i];
+        destroy_filter_plan(l_stage->plan);
+        arena_free(l_stage->owned);
+        if (l_stage->file != NULL)
+            fclose(l_stage->file);
+        close_codec_reader(l_stage->reader);
+        close_stream_reader(l_stage->stream);
+        if (l_stage->writer != NULL)
+            close_codec_writer(l_stage->writer, NULL);
+    }
+    arena_free(p_pipeline->block);
+    arena_free(p_pipeline);
+}
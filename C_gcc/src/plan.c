@@ -0,0 +1,974 @@
+/**
+ * @file plan.c
+ * @brief FIR filter plan creation, kernels and wisdom handling.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "plan.h"
+#include "telemetry.h"
+#include "fir_target.h"
+#include "arena.h"
+#include "hash.h"
+#include "realtime.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WISDOM_CAPACITY       64U
+#define WISDOM_HEADER         "# FIR wisdom v1"
+#define MEASURE_TRIALS        5U
+#define MEASURE_MIN_NS        2000000ULL
+
+typedef struct {
+    uint64_t     coeff_hash;
+    uint32_t     coeff_len;
+    uint32_t     block_len;
+    FIR_kernel_t kernel;
+} wisdom_entry_t;
+
+static wisdom_entry_t g_wisdom[WISDOM_CAPACITY];
+static uint32_t g_wisdom_count = 0;
+
+static const char *g_kernel_names[FIR_KERNEL_COUNT] = {
+    "direct",
+    "symmetric",
+    "antisymmetric",
+    "sparse",
+    "halfband",
+    "ffa"
+};
+
+
+/* ------------------------------------------------------------------------- */
+/* Kernels                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Each kernel computes FIR_TILE consecutive outputs at once, walking the taps
+ * in the outer loop and the outputs in the inner one. Every output still
+ * accumulates its taps in ascending order, so the result is identical to the
+ * one-output-at-a-time loop, but the inner loop maps onto SIMD lanes in each
+ * multiversioned clone. The *_tile helpers are forced inline so the
+ * full-width call sites see a constant trip count.
+ */
+
+#define TILE_INLINE static inline __attribute__((always_inline))
+
+TILE_INLINE void direct_tile(const float32_t *p_x, uint32_t p_width, const float32_t *h, uint32_t N, float32_t *p_y)
+{
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+
+    for (uint32_t k = 0; k < N; k++)
+    {
+        const float32_t *l_xk = p_x - k;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_xk[j] * h[k];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[j] = l_acc[j];
+    }
+}
+
+/**
+ * @brief Direct form: N multiplies per output, same summation order as filter_signal.
+ */
+FIR_MULTIVERSION
+static void kernel_direct(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        direct_tile(&p_x[n], FIR_TILE, p_plan->coeffs, p_plan->coeff_len, &p_y[n]);
+    if (n < p_len)
+        direct_tile(&p_x[n], p_len - n, p_plan->coeffs, p_plan->coeff_len, &p_y[n]);
+}
+
+/*
+ * Folded tile shared by the symmetric (p_sign = +1) and antisymmetric
+ * (p_sign = -1) kernels. Only the first N/2 taps are visited; p_centre adds
+ * the middle tap of an odd-length symmetric filter.
+ */
+TILE_INLINE void folded_tile(const float32_t *p_x, uint32_t p_width, const float32_t *h, uint32_t N,
+                             float32_t p_sign, bool p_centre, float32_t *p_y)
+{
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+    const float32_t *l_oldest = p_x - (N - 1);
+    uint32_t l_half_len = N / 2;
+
+    for (uint32_t k = 0; k < l_half_len; k++)
+    {
+        const float32_t *l_new = p_x - k;
+        const float32_t *l_old = l_oldest + k;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += (l_new[j] + p_sign * l_old[j]) * h[k];
+        }
+    }
+
+    if (p_centre)
+    {
+        const float32_t *l_mid = p_x - l_half_len;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_mid[j] * h[l_half_len];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[j] = l_acc[j];
+    }
+}
+
+/**
+ * @brief Folded form for h[k] = h[N-1-k]: N/2 multiplies per output.
+ */
+FIR_MULTIVERSION
+static void kernel_symmetric(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t N = p_plan->coeff_len;
+    bool l_is_odd = (N % 2 != 0);
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        folded_tile(&p_x[n], FIR_TILE, p_plan->coeffs, N, 1.0f, l_is_odd, &p_y[n]);
+    if (n < p_len)
+        folded_tile(&p_x[n], p_len - n, p_plan->coeffs, N, 1.0f, l_is_odd, &p_y[n]);
+}
+
+/**
+ * @brief Folded form for h[k] = -h[N-1-k]; the centre tap of an odd filter is zero.
+ */
+FIR_MULTIVERSION
+static void kernel_antisymmetric(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t N = p_plan->coeff_len;
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        folded_tile(&p_x[n], FIR_TILE, p_plan->coeffs, N, -1.0f, false, &p_y[n]);
+    if (n < p_len)
+        folded_tile(&p_x[n], p_len - n, p_plan->coeffs, N, -1.0f, false, &p_y[n]);
+}
+
+TILE_INLINE void sparse_tile(const float32_t *p_x, uint32_t p_width, const uint32_t *p_idx,
+                             const float32_t *p_val, uint32_t p_count, float32_t *p_y)
+{
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+
+    for (uint32_t i = 0; i < p_count; i++)
+    {
+        const float32_t *l_xk = p_x - p_idx[i];
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += l_xk[j] * p_val[i];
+        }
+    }
+
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[j] = l_acc[j];
+    }
+}
+
+/**
+ * @brief Only visits the non-zero taps, gathered at plan creation.
+ */
+FIR_MULTIVERSION
+static void kernel_sparse(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        sparse_tile(&p_x[n], FIR_TILE, p_plan->nonzero_idx, p_plan->nonzero_val, p_plan->nonzero_count, &p_y[n]);
+    if (n < p_len)
+        sparse_tile(&p_x[n], p_len - n, p_plan->nonzero_idx, p_plan->nonzero_val, p_plan->nonzero_count, &p_y[n]);
+}
+
+TILE_INLINE void halfband_tile(const float32_t *p_x, uint32_t p_width, const float32_t *h, uint32_t N, float32_t *p_y)
+{
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+    const float32_t *l_oldest = p_x - (N - 1);
+    uint32_t l_centre = (N - 1) / 2;
+
+    // Only taps an odd distance from the centre are non-zero
+    for (uint32_t k = (l_centre % 2 != 0) ? 0U : 1U; k < l_centre; k += 2)
+    {
+        const float32_t *l_new = p_x - k;
+        const float32_t *l_old = l_oldest + k;
+        for (uint32_t j = 0; j < p_width; j++)
+        {
+            l_acc[j] += (l_new[j] + l_old[j]) * h[k];
+        }
+    }
+
+    const float32_t *l_mid = p_x - l_centre;
+    for (uint32_t j = 0; j < p_width; j++)
+    {
+        p_y[j] = l_acc[j] + l_mid[j] * h[l_centre];
+    }
+}
+
+/**
+ * @brief Half-band form: folded pairs on the odd offsets from the centre plus the centre tap.
+ */
+FIR_MULTIVERSION
+static void kernel_halfband(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t n = 0;
+
+    for (; n + FIR_TILE <= p_len; n += FIR_TILE)
+        halfband_tile(&p_x[n], FIR_TILE, p_plan->coeffs, p_plan->coeff_len, &p_y[n]);
+    if (n < p_len)
+        halfband_tile(&p_x[n], p_len - n, p_plan->coeffs, p_plan->coeff_len, &p_y[n]);
+}
+
+/**
+ * @brief Parallel fast FIR decomposition (ffa.h), down to 4N/9 multiplies per output.
+ *
+ * The decomposition covers the largest multiple of its parallelism; the
+ * few outputs left over at the end of a short block use the direct form.
+ */
+static void kernel_ffa(const FIR_plan_t *p_plan, const float32_t *p_x, uint32_t p_len, float32_t *p_y)
+{
+    uint32_t n = run_ffa(p_plan->ffa, p_x, p_len, p_y);
+
+    if (n < p_len)
+        kernel_direct(p_plan, &p_x[n], p_len - n, &p_y[n]);
+}
+
+static const FIR_kernel_fn g_kernel_fns[FIR_KERNEL_COUNT] = {
+    kernel_direct,
+    kernel_symmetric,
+    kernel_antisymmetric,
+    kernel_sparse,
+    kernel_halfband,
+    kernel_ffa
+};
+
+
+/* ------------------------------------------------------------------------- */
+/* Coefficient analysis                                                      */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Inspects a coefficient set for structure the kernels can exploit.
+ *
+ * Comparisons are exact: a coefficient set that is only nearly symmetric is
+ * not reported as symmetric, so it is never sent down a folded kernel.
+ *
+ * @param[in] p_coeffs Pointer to the filter coefficients.
+ * @param[in] p_coeff_len Number of coefficients.
+ *
+ * @return Bitwise OR of the FIR_COEFF_* properties that hold.
+ */
+uint32_t analyse_coefficients(const float32_t *p_coeffs, uint32_t p_coeff_len)
+{
+    uint32_t N = p_coeff_len;
+    bool l_symmetric = true;
+    bool l_antisymmetric = true;
+    uint32_t l_nonzero = 0;
+
+    for (uint32_t k = 0; k < N; k++)
+    {
+        if (p_coeffs[k] != p_coeffs[N - 1 - k])
+            l_symmetric = false;
+        if (p_coeffs[k] != -p_coeffs[N - 1 - k])
+            l_antisymmetric = false;
+        if (p_coeffs[k] != 0.0f)
+            l_nonzero++;
+    }
+
+    uint32_t l_properties = 0;
+    if (l_symmetric)
+        l_properties |= FIR_COEFF_SYMMETRIC;
+    if (l_antisymmetric && l_nonzero > 0)
+        l_properties |= FIR_COEFF_ANTISYMMETRIC;
+    if (l_nonzero * 2 <= N)
+        l_properties |= FIR_COEFF_SPARSE;
+
+    if (l_symmetric && (N % 2 != 0) && N >= 3)
+    {
+        uint32_t l_centre = (N - 1) / 2;
+        bool l_halfband = true;
+        for (uint32_t k = 0; k < l_centre; k++)
+        {
+            if (((l_centre - k) % 2 == 0) && p_coeffs[k] != 0.0f)
+            {
+                l_halfband = false;
+                break;
+            }
+        }
+        if (l_halfband)
+            l_properties |= FIR_COEFF_HALFBAND;
+    }
+
+    return l_properties;
+}
+
+/**
+ * @brief Tells whether a kernel gives the exact convolution for coefficients with the given properties.
+ */
+bool kernel_supported(FIR_kernel_t p_kernel, uint32_t p_properties)
+{
+    switch (p_kernel)
+    {
+        case FIR_KERNEL_DIRECT:        return true;
+        case FIR_KERNEL_SYMMETRIC:     return (p_properties & FIR_COEFF_SYMMETRIC) != 0;
+        case FIR_KERNEL_ANTISYMMETRIC: return (p_properties & FIR_COEFF_ANTISYMMETRIC) != 0;
+        case FIR_KERNEL_SPARSE:        return (p_properties & FIR_COEFF_SPARSE) != 0;
+        case FIR_KERNEL_HALFBAND:      return (p_properties & FIR_COEFF_HALFBAND) != 0;
+        case FIR_KERNEL_FFA:           return true;
+        default:                       return false;
+    }
+}
+
+/**
+ * @brief Returns the printable name of a kernel, as used in wisdom files.
+ */
+const char *filter_kernel_name(FIR_kernel_t p_kernel)
+{
+    if (p_kernel >= FIR_KERNEL_COUNT)
+        return "unknown";
+    return g_kernel_names[p_kernel];
+}
+
+/**
+ * @brief Multiplies per output sample, used to rank kernels without timing them.
+ *
+ * The fast FIR kernel also counts its pre- and post-additions, which is
+ * what its multiplies are traded for (ffa_cost()).
+ */
+static uint32_t estimate_kernel_cost(const FIR_plan_t *p_plan, FIR_kernel_t p_kernel)
+{
+    uint32_t N = p_plan->coeff_len;
+    uint32_t l_factors[FFA_MAX_LEVELS];
+
+    switch (p_kernel)
+    {
+        case FIR_KERNEL_FFA:
+            if (p_plan->ffa != NULL)
+                return ffa_plan_cost(p_plan->ffa);
+            return ffa_cost(N, l_factors, choose_ffa_factors(N, l_factors));
+        case FIR_KERNEL_SYMMETRIC:
+        case FIR_KERNEL_ANTISYMMETRIC: return (N + 1) / 2;
+        case FIR_KERNEL_SPARSE:        return p_plan->nonzero_count;
+        case FIR_KERNEL_HALFBAND:      return (N + 1) / 4 + 1;
+        case FIR_KERNEL_DIRECT:
+        default:                       return N;
+    }
+}
+
+/**
+ * @brief Estimated multiplies per output of the kernel a plan runs.
+ */
+uint32_t filter_plan_cost(const FIR_plan_t *p_plan)
+{
+    return estimate_kernel_cost(p_plan, p_plan->kernel);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Wisdom                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static wisdom_entry_t *find_wisdom(uint64_t p_hash, uint32_t p_coeff_len, uint32_t p_block_len)
+{
+    for (uint32_t i = 0; i < g_wisdom_count; i++)
+    {
+        wisdom_entry_t *l_entry = &g_wisdom[i];
+        if (l_entry->coeff_hash == p_hash && l_entry->coeff_len == p_coeff_len
+            && l_entry->block_len == p_block_len)
+        {
+            return l_entry;
+        }
+    }
+    return NULL;
+}
+
+static void remember_wisdom(uint64_t p_hash, uint32_t p_coeff_len, uint32_t p_block_len, FIR_kernel_t p_kernel)
+{
+    wisdom_entry_t *l_entry = find_wisdom(p_hash, p_coeff_len, p_block_len);
+
+    if (l_entry == NULL)
+    {
+        if (g_wisdom_count == WISDOM_CAPACITY)
+            return;
+        l_entry = &g_wisdom[g_wisdom_count++];
+    }
+
+    l_entry->coeff_hash = p_hash;
+    l_entry->coeff_len = p_coeff_len;
+    l_entry->block_len = p_block_len;
+    l_entry->kernel = p_kernel;
+}
+
+/**
+ * @brief Loads kernel choices saved by save_filter_wisdom().
+ *
+ * Entries are merged with the wisdom already held in memory. Unknown kernel
+ * names are skipped so that wisdom from a newer build does not break an older one.
+ *
+ * @param[in] p_filename Path of the wisdom file.
+ *
+ * @return true if the file was read, false if it could not be opened or is not a wisdom file.
+ */
+bool load_filter_wisdom(const char *p_filename)
+{
+    FILE *l_file = fopen(p_filename, "r");
+    if (l_file == NULL)
+        return false;
+
+    char l_line[128];
+    if (fgets(l_line, sizeof(l_line), l_file) == NULL
+        || strncmp(l_line, WISDOM_HEADER, strlen(WISDOM_HEADER)) != 0)
+    {
+        printf("Error. %s is not a FIR wisdom file.\n", p_filename);
+        fclose(l_file);
+        return false;
+    }
+
+    while (fgets(l_line, sizeof(l_line), l_file) != NULL)
+    {
+        unsigned long long l_hash;
+        unsigned int l_coeff_len, l_block_len;
+        char l_name[32];
+
+        if (sscanf(l_line, "%llx %u %u %31s", &l_hash, &l_coeff_len, &l_block_len, l_name) != 4)
+            continue;
+
+        for (uint32_t k = 0; k < FIR_KERNEL_COUNT; k++)
+        {
+            if (strcmp(l_name, g_kernel_names[k]) == 0)
+            {
+                remember_wisdom(l_hash, l_coeff_len, l_block_len, (FIR_kernel_t)k);
+                break;
+            }
+        }
+    }
+
+    fclose(l_file);
+    return true;
+}
+
+/**
+ * @brief Writes the kernel choices gathered by measured planning to a file.
+ *
+ * @param[in] p_filename Path of the wisdom file. The file will be created or overwritten.
+ *
+ * @return true on success, false if the file could not be written.
+ */
+bool save_filter_wisdom(const char *p_filename)
+{
+    FILE *l_file = fopen(p_filename, "w");
+    if (l_file == NULL)
+    {
+        printf("Error. Not able to open file %s for writing.\n", p_filename);
+        return false;
+    }
+
+    fprintf(l_file, "%s\n", WISDOM_HEADER);
+    for (uint32_t i = 0; i < g_wisdom_count; i++)
+    {
+        fprintf(l_file, "%016llx %u %u %s\n", (unsigned long long)g_wisdom[i].coeff_hash,
+                g_wisdom[i].coeff_len, g_wisdom[i].block_len, g_kernel_names[g_wisdom[i].kernel]);
+    }
+
+    fclose(l_file);
+    return true;
+}
+
+/**
+ * @brief Drops all wisdom held in memory.
+ */
+void forget_filter_wisdom(void)
+{
+    g_wisdom_count = 0;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Plans                                                                     */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Times one kernel over a block of noise and returns the best ns per block.
+ */
+static uint64_t measure_kernel(FIR_plan_t *p_plan, FIR_kernel_t p_kernel, float32_t *p_scratch)
+{
+    uint32_t l_history_len = p_plan->coeff_len - 1;
+    FIR_kernel_fn l_fn = g_kernel_fns[p_kernel];
+    uint64_t l_best = UINT64_MAX;
+
+    for (uint32_t t = 0; t < MEASURE_TRIALS; t++)
+    {
+        uint32_t l_reps = 0;
+        uint64_t l_start = telemetry_now_ns();
+        uint64_t l_elapsed;
+        do
+        {
+            l_fn(p_plan, &p_plan->work[l_history_len], p_plan->block_len, p_scratch);
+            l_reps++;
+            l_elapsed = telemetry_now_ns() - l_start;
+        } while (l_elapsed < MEASURE_MIN_NS / MEASURE_TRIALS);
+
+        uint64_t l_per_block = l_elapsed / l_reps;
+        if (l_per_block < l_best)
+            l_best = l_per_block;
+    }
+
+    return l_best;
+}
+
+/**
+ * @brief Builds the cheapest fast FIR decomposition for the plan's length.
+ */
+static bool attach_default_ffa(FIR_plan_t *p_plan)
+{
+    uint32_t l_factors[FFA_MAX_LEVELS];
+    uint32_t l_levels = choose_ffa_factors(p_plan->coeff_len, l_factors);
+
+    p_plan->ffa = create_ffa(p_plan->coeffs, p_plan->coeff_len, p_plan->block_len, l_factors, l_levels);
+    return p_plan->ffa != NULL;
+}
+
+/**
+ * @brief Benchmarks every kernel valid for the plan's coefficients and returns the fastest.
+ */
+static FIR_kernel_t measure_best_kernel(FIR_plan_t *p_plan)
+{
+    uint32_t l_work_len = p_plan->coeff_len - 1 + p_plan->block_len;
+    FIR_kernel_t l_best = FIR_KERNEL_DIRECT;
+
+    uint32_t l_seed = 12345U;
+    for (uint32_t i = 0; i < l_work_len; i++)
+    {
+        l_seed = l_seed * 1664525U + 1013904223U;
+        p_plan->work[i] = (float32_t)(l_seed >> 8) / 16777216.0f - 0.5f;
+    }
+
+    uint64_t l_best_ns = UINT64_MAX;
+    for (uint32_t k = 0; k < FIR_KERNEL_COUNT; k++)
+    {
+        if (!kernel_supported((FIR_kernel_t)k, p_plan->properties))
+            continue;
+        if (k == FIR_KERNEL_FFA && p_plan->ffa == NULL && !attach_default_ffa(p_plan))
+            continue;
+
+        uint64_t l_ns = measure_kernel(p_plan, (FIR_kernel_t)k, p_plan->scratch);
+        if (l_ns < l_best_ns)
+        {
+            l_best_ns = l_ns;
+            l_best = (FIR_kernel_t)k;
+        }
+    }
+
+    reset_filter_plan(p_plan);
+    return l_best;
+}
+
+/**
+ * @brief Allocates a plan, copies and analyses the coefficients; no kernel is chosen yet.
+ */
+static FIR_plan_t *allocate_plan(FIR_filter_t *p_filter, uint32_t p_block_len)
+{
+    uint32_t N = p_filter->coeff_b_len;
+
+    if (N == 0 || p_block_len == 0)
+    {
+        printf("Error. A filter plan needs at least one coefficient and a non-empty block.\n");
+        return NULL;
+    }
+
+    FIR_plan_t *l_plan = arena_calloc(1, sizeof(FIR_plan_t));
+    if (l_plan == NULL)
+        return NULL;
+
+    l_plan->coeff_len = N;
+    l_plan->block_len = p_block_len;
+    l_plan->coeffs = arena_alloc(N * sizeof(float32_t));
+    l_plan->work = arena_calloc(FFA_SLACK + N - 1 + p_block_len, sizeof(float32_t));
+    l_plan->scratch = arena_alloc(p_block_len * sizeof(float32_t));
+    l_plan->nonzero_idx = arena_alloc(N * sizeof(uint32_t));
+    l_plan->nonzero_val = arena_alloc(N * sizeof(float32_t));
+
+    if (l_plan->work != NULL)
+        l_plan->work += FFA_SLACK;
+
+    if (l_plan->coeffs == NULL || l_plan->work == NULL || l_plan->scratch == NULL
+        || l_plan->nonzero_idx == NULL || l_plan->nonzero_val == NULL)
+    {
+        printf("Error. Not able to allocate a filter plan of %u taps.\n", N);
+        destroy_filter_plan(l_plan);
+        return NULL;
+    }
+
+    prefault_memory(l_plan->work - FFA_SLACK, (FFA_SLACK + N - 1 + p_block_len) * sizeof(float32_t));
+    prefault_memory(l_plan->scratch, p_block_len * sizeof(float32_t));
+    prefault_memory(l_plan->nonzero_idx, N * sizeof(uint32_t));
+    prefault_memory(l_plan->nonzero_val, N * sizeof(float32_t));
+
+    memcpy(l_plan->coeffs, p_filter->coeff_b_ptr, N * sizeof(float32_t));
+    l_plan->properties = analyse_coefficients(l_plan->coeffs, N);
+
+    for (uint32_t k = 0; k < N; k++)
+    {
+        if (l_plan->coeffs[k] != 0.0f)
+        {
+            l_plan->nonzero_idx[l_plan->nonzero_count] = k;
+            l_plan->nonzero_val[l_plan->nonzero_count] = l_plan->coeffs[k];
+            l_plan->nonzero_count++;
+        }
+    }
+
+    reset_filter_plan(l_plan);
+    return l_plan;
+}
+
+/**
+ * @brief Switches the plan to a kernel, building or dropping its fast FIR decomposition.
+ *
+ * @return false if the decomposition could not be built.
+ */
+static bool select_kernel(FIR_plan_t *p_plan, FIR_kernel_t p_kernel)
+{
+    if (p_kernel == FIR_KERNEL_FFA && p_plan->ffa == NULL && !attach_default_ffa(p_plan))
+        return false;
+    if (p_kernel != FIR_KERNEL_FFA)
+    {
+        destroy_ffa(p_plan->ffa);
+        p_plan->ffa = NULL;
+    }
+
+    p_plan->kernel = p_kernel;
+    p_plan->kernel_fn = g_kernel_fns[p_kernel];
+    return true;
+}
+
+/*
+ * The valid kernel with the fewest multiplies; depends on the coefficients
+ * only. Reproducible plans leave out the fast FIR kernel, whose sums have
+ * no scalar reference.
+ */
+static FIR_kernel_t estimate_best_kernel(const FIR_plan_t *p_plan, bool p_reproducible)
+{
+    FIR_kernel_t l_best = FIR_KERNEL_DIRECT;
+    for (uint32_t k = 0; k < FIR_KERNEL_COUNT; k++)
+    {
+        if (p_reproducible && k == FIR_KERNEL_FFA)
+            continue;
+        if (kernel_supported((FIR_kernel_t)k, p_plan->properties)
+            && estimate_kernel_cost(p_plan, (FIR_kernel_t)k) < estimate_kernel_cost(p_plan, l_best))
+        {
+            l_best = (FIR_kernel_t)k;
+        }
+    }
+    return l_best;
+}
+
+/**
+ * @brief Creates a plan for filtering blocks of up to p_block_len samples.
+ *
+ * With FIR_PLAN_ESTIMATE the kernel with the fewest multiplies per output
+ * is chosen. With FIR_PLAN_MEASURE every kernel valid for the coefficients is
+ * timed on this machine and the fastest is chosen and remembered as wisdom;
+ * later plans for the same coefficients and block size reuse that choice
+ * without measuring again. With FIR_PLAN_REPRODUCIBLE the estimate is used
+ * and wisdom is neither read nor written, so the output does not depend on
+ * the machine (see plan.h). Only kernels that are exact for the coefficients
+ * are ever considered, whatever p_filter->symmetric says.
+ *
+ * @param[in] p_filter Pointer to the FIR filter; its coefficients are copied.
+ * @param[in] p_block_len Largest number of samples the kernel is run over at once.
+ * @param[in] p_mode How to choose the kernel.
+ *
+ * @return The new plan, or NULL on failure.
+ *
+ * @note Planning touches global wisdom and is not thread-safe; executing
+ *       distinct plans from different threads is.
+ */
+FIR_plan_t *create_filter_plan(FIR_filter_t *p_filter, uint32_t p_block_len, FIR_plan_mode_t p_mode)
+{
+#ifdef __FAST_MATH__
+    // -ffast-math lets the compiler reassociate the sums differently in each clone
+    if (p_mode == FIR_PLAN_REPRODUCIBLE)
+    {
+        printf("Error. Reproducible plans need a build without -ffast-math.\n");
+        return NULL;
+    }
+#endif
+
+    FIR_plan_t *l_plan = allocate_plan(p_filter, p_block_len);
+    if (l_plan == NULL)
+        return NULL;
+
+    FIR_kernel_t l_kernel;
+
+    if (p_mode == FIR_PLAN_REPRODUCIBLE)
+    {
+        l_kernel = estimate_best_kernel(l_plan, true);
+    }
+    else
+    {
+        uint64_t l_hash = fnv1a(l_plan->coeffs, (uint64_t)l_plan->coeff_len * sizeof(float32_t));
+        wisdom_entry_t *l_wisdom = find_wisdom(l_hash, l_plan->coeff_len, p_block_len);
+
+        if (l_wisdom != NULL && kernel_supported(l_wisdom->kernel, l_plan->properties))
+        {
+            l_kernel = l_wisdom->kernel;
+        }
+        else if (p_mode == FIR_PLAN_MEASURE)
+        {
+            l_kernel = measure_best_kernel(l_plan);
+            remember_wisdom(l_hash, l_plan->coeff_len, p_block_len, l_kernel);
+        }
+        else
+        {
+            l_kernel = estimate_best_kernel(l_plan, false);
+        }
+    }
+
+    if (!select_kernel(l_plan, l_kernel))
+    {
+        destroy_filter_plan(l_plan);
+        return NULL;
+    }
+
+    return l_plan;
+}
+
+/**
+ * @brief Creates a plan that always uses the given kernel, bypassing planning.
+ *
+ * @return The new plan, or NULL if the kernel is not exact for the coefficients.
+ */
+FIR_plan_t *create_filter_plan_with_kernel(FIR_filter_t *p_filter, uint32_t p_block_len, FIR_kernel_t p_kernel)
+{
+    FIR_plan_t *l_plan = allocate_plan(p_filter, p_block_len);
+    if (l_plan == NULL)
+        return NULL;
+
+    if (!kernel_supported(p_kernel, l_plan->properties))
+    {
+        printf("Error. The %s kernel does not suit these coefficients.\n", filter_kernel_name(p_kernel));
+        destroy_filter_plan(l_plan);
+        return NULL;
+    }
+
+    if (!select_kernel(l_plan, p_kernel))
+    {
+        destroy_filter_plan(l_plan);
+        return NULL;
+    }
+
+    return l_plan;
+}
+
+/**
+ * @brief Creates a plan running the fast FIR kernel with a given decomposition.
+ *
+ * @param[in] p_filter Pointer to the FIR filter; its coefficients are copied.
+ * @param[in] p_block_len Largest number of samples the kernel is run over at once.
+ * @param[in] p_factors Factors of the levels, innermost first, each 2 or 3 (see ffa.h).
+ * @param[in] p_levels Number of levels.
+ *
+ * @return The new plan, or NULL if the decomposition is not valid.
+ */
+FIR_plan_t *create_filter_plan_with_ffa(FIR_filter_t *p_filter, uint32_t p_block_len, const uint32_t *p_factors,
+                                        uint32_t p_levels)
+{
+    FIR_plan_t *l_plan = allocate_plan(p_filter, p_block_len);
+    if (l_plan == NULL)
+        return NULL;
+
+    l_plan->ffa = create_ffa(l_plan->coeffs, l_plan->coeff_len, p_block_len, p_factors, p_levels);
+    if (l_plan->ffa == NULL || !select_kernel(l_plan, FIR_KERNEL_FFA))
+    {
+        destroy_filter_plan(l_plan);
+        return NULL;
+    }
+
+    return l_plan;
+}
+
+/**
+ * @brief Switches an existing plan to another kernel, keeping its history.
+ *
+ * Used to give a plan the kernel another plan chose, e.g. when restoring a
+ * checkpoint, so that the output continues bit for bit.
+ *
+ * @param[in,out] p_plan Pointer to the plan.
+ * Nothing is allocated, so a caller that has checked the kernel and built
+ * the decomposition beforehand cannot see it fail half-way through.
+ *
+ * @param[in] p_kernel Kernel to run from now on.
+ * @param[in] p_ffa For the fast FIR kernel, a decomposition made by
+ *            create_ffa() from the plan's coefficients and block length,
+ *            which the plan takes over; NULL for the other kernels.
+ *
+ * @return false, with the plan unchanged and p_ffa still the caller's, if
+ *         the kernel does not suit the coefficients or has no decomposition.
+ */
+bool set_filter_plan_kernel(FIR_plan_t *p_plan, FIR_kernel_t p_kernel, FIR_ffa_t *p_ffa)
+{
+    if (p_kernel >= FIR_KERNEL_COUNT || !kernel_supported(p_kernel, p_plan->properties)
+        || (p_kernel == FIR_KERNEL_FFA) != (p_ffa != NULL))
+    {
+        printf("Error. The %s kernel does not suit these coefficients.\n", filter_kernel_name(p_kernel));
+        return false;
+    }
+
+    if (p_ffa != NULL)
+    {
+        destroy_ffa(p_plan->ffa);
+        p_plan->ffa = p_ffa;
+    }
+
+    select_kernel(p_plan, p_kernel);
+    telemetry_set_kernel(p_plan->telemetry, filter_kernel_name(p_kernel));
+    return true;
+}
+
+/**
+ * @brief Filters a signal with the kernel chosen for the plan.
+ *
+ * The plan keeps the last N-1 inputs between calls, so a long signal may be
+ * passed in pieces. Input is staged through the plan's work buffer one block
+ * at a time, which makes p_output == p_input valid (in-place filtering).
+ *
+ * @param[in,out] p_plan Pointer to the plan.
+ * @param[in] p_input Pointer to the input signal array.
+ * @param[in] p_input_len Length of the input signal; 64-bit, the kernels
+ *            only ever see one block of it.
+ * @param[out] p_output Pointer to the output signal array; may alias p_input.
+ *
+ * @return void
+ */
+void execute_filter_plan(FIR_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len, float32_t *p_output)
+{
+    execute_filter_plan_fused(p_plan, p_input, p_input_len, p_output, NULL, NULL);
+}
+
+/**
+ * @brief Filters a signal as execute_filter_plan() does, passing each tile of output through an epilogue.
+ *
+ * The kernel is run FIR_TILE outputs at a time and p_epilogue is applied to
+ * every tile as soon as it is stored, while it is still in L1, instead of
+ * in a second pass over the block. The tiles are the ones the kernel
+ * computes over a whole block, so the outputs are bit-identical. The fast
+ * FIR kernel computes a block's outputs together and gets the epilogue
+ * once per block.
+ *
+ * @param[in,out] p_plan Pointer to the plan.
+ * @param[in] p_input Pointer to the input signal array.
+ * @param[in] p_input_len Length of the input signal.
+ * @param[out] p_output Pointer to the output signal array; may alias p_input.
+ * @param[in] p_epilogue Function applied in place to the outputs, NULL for none.
+ * @param[in,out] p_context Passed to p_epilogue.
+ *
+ * @return void
+ */
+void execute_filter_plan_fused(FIR_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len,
+                               float32_t *p_output, FIR_epilogue_fn p_epilogue, void *p_context)
+{
+    uint32_t l_history_len = p_plan->coeff_len - 1;
+    float32_t *l_block = &p_plan->work[l_history_len];
+    uint64_t l_start = (p_plan->telemetry != NULL) ? telemetry_now_ns() : 0;
+    uint64_t l_blocks = 0;
+    uint32_t l_len = 0;
+
+    for (uint64_t l_done = 0; l_done < p_input_len; l_blocks++)
+    {
+        l_len = p_plan->block_len;
+        if (p_input_len - l_done < l_len)
+            l_len = (uint32_t)(p_input_len - l_done);
+
+        memcpy(l_block, &p_input[l_done], l_len * sizeof(float32_t));
+        if (p_epilogue == NULL)
+            p_plan->kernel_fn(p_plan, l_block, l_len, &p_output[l_done]);
+        else
+        {
+            uint32_t l_tile = (p_plan->kernel == FIR_KERNEL_FFA) ? l_len : FIR_TILE;
+            for (uint32_t n = 0; n < l_len; n += l_tile)
+            {
+                uint32_t l_width = (l_len - n < l_tile) ? l_len - n : l_tile;
+                p_plan->kernel_fn(p_plan, &l_block[n], l_width, &p_output[l_done + n]);
+                p_epilogue(p_context, &p_output[l_done + n], l_width);
+            }
+        }
+
+        // The last N-1 inputs become the history of the next block
+        memmove(p_plan->work, &p_plan->work[l_len], l_history_len * sizeof(float32_t));
+        l_done += l_len;
+    }
+
+    if (p_plan->telemetry != NULL)
+        report_plan_telemetry(p_plan, l_blocks, p_input_len, l_start, &p_output[p_input_len - l_len], l_len);
+}
+
+/**
+ * @brief Clears the plan's history so the next call starts a new signal.
+ */
+void reset_filter_plan(FIR_plan_t *p_plan)
+{
+    memset(p_plan->work, 0, (p_plan->coeff_len - 1 + p_plan->block_len) * sizeof(float32_t));
+}
+
+/**
+ * @brief Reports the plan's work to a telemetry instance from now on; NULL detaches.
+ *
+ * Each execute call then costs two clock reads and one pass over its last
+ * output block (for the RMS gauge), independent of the signal length.
+ */
+void attach_plan_telemetry(FIR_plan_t *p_plan, FIR_telemetry_t *p_telemetry)
+{
+    p_plan->telemetry = p_telemetry;
+    telemetry_set_kernel(p_telemetry, filter_kernel_name(p_plan->kernel));
+}
+
+/**
+ * @brief Reports one execute call of a plan with telemetry attached.
+ *
+ * @param[in] p_plan Plan that did the work.
+ * @param[in] p_blocks Kernel calls made.
+ * @param[in] p_samples Samples filtered.
+ * @param[in] p_start_ns telemetry_now_ns() when the call started.
+ * @param[in] p_last_block Last output block, for the RMS gauge.
+ * @param[in] p_last_len Length of p_last_block.
+ */
+void report_plan_telemetry(const FIR_plan_t *p_plan, uint64_t p_blocks, uint64_t p_samples, uint64_t p_start_ns,
+                           const float32_t *p_last_block, uint32_t p_last_len)
+{
+    double l_sum = 0.0;
+    for (uint32_t i = 0; i < p_last_len; i++)
+    {
+        l_sum += (double)p_last_block[i] * p_last_block[i];
+    }
+
+    float32_t l_rms = p_last_len ? (float32_t)sqrt(l_sum / p_last_len) : 0.0f;
+    telemetry_record_blocks(p_plan->telemetry, p_blocks, p_samples, telemetry_now_ns() - p_start_ns, l_rms);
+}
+
+/**
+ * @brief Releases a plan and everything it owns. Accepts NULL.
+ */
+void destroy_filter_plan(FIR_plan_t *p_plan)
+{
+    if (p_plan == NULL)
+        return;
+
+    arena_free(p_plan->coeffs);
+    if (p_plan->work != NULL)
+        arena_free(p_plan->work - FFA_SLACK);
+    arena_free(p_plan->scratch);
+    arena_free(p_plan->nonzero_idx);
+    arena_free(p_plan->nonzero_val);
+    destroy_ffa(p_plan->ffa);
+    arena_free(p_plan);
+}
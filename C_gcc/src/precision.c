@@ -0,0 +1,366 @@
+/**
+ * @file precision.c
+ * @brief fp16 / bf16 conversions and reduced-precision plan execution.
+ */
+
+#include "precision.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define PRECISION_X86 1
+#endif
+
+static const char *g_sample_type_names[FIR_SAMPLE_TYPE_COUNT] = { "f32", "f16", "bf16" };
+
+
+/* ------------------------------------------------------------------------- */
+/* Scalar conversions (round to nearest, ties to even)                       */
+/* ------------------------------------------------------------------------- */
+
+static inline uint32_t float_bits(float32_t p_value)
+{
+    uint32_t l_bits;
+    memcpy(&l_bits, &p_value, sizeof(l_bits));
+    return l_bits;
+}
+
+static inline float32_t bits_float(uint32_t p_bits)
+{
+    float32_t l_value;
+    memcpy(&l_value, &p_bits, sizeof(l_value));
+    return l_value;
+}
+
+static float16_t float_to_f16(float32_t p_value)
+{
+    uint32_t l_bits = float_bits(p_value);
+    uint16_t l_sign = (uint16_t)((l_bits >> 16) & 0x8000U);
+    uint32_t l_mag = l_bits & 0x7FFFFFFFU;
+
+    if (l_mag >= 0x7F800000U)
+    {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        return l_sign | 0x7C00U | ((l_mag > 0x7F800000U) ? (0x0200U | ((l_mag >> 13) & 0x03FFU)) : 0U);
+    }
+    if (l_mag >= 0x477FF000U)
+    {
+        // 65520 and above round to infinity
+        return l_sign | 0x7C00U;
+    }
+    if (l_mag < 0x38800000U)
+    {
+        // Below 2^-14: subnormal half, or zero below 2^-25
+        if (l_mag <= 0x33000000U)
+            return l_sign;
+
+        uint32_t l_shift = 126U - (l_mag >> 23);
+        uint32_t l_mant = (l_mag & 0x007FFFFFU) | 0x00800000U;
+        uint32_t l_half = l_mant >> l_shift;
+        uint32_t l_rem = l_mant & ((1U << l_shift) - 1U);
+        uint32_t l_tie = 1U << (l_shift - 1U);
+        if (l_rem > l_tie || (l_rem == l_tie && (l_half & 1U)))
+            l_half++;
+        return l_sign | (uint16_t)l_half;
+    }
+
+    // Normal: rebias the exponent from 127 to 15 and round off 13 mantissa bits
+    uint32_t l_rebased = l_mag - 0x38000000U;
+    return l_sign | (uint16_t)((l_rebased + 0x0FFFU + ((l_rebased >> 13) & 1U)) >> 13);
+}
+
+static float32_t f16_to_float(float16_t p_half)
+{
+    uint32_t l_sign = ((uint32_t)p_half & 0x8000U) << 16;
+    uint32_t l_exp = ((uint32_t)p_half >> 10) & 0x1FU;
+    uint32_t l_mant = (uint32_t)p_half & 0x03FFU;
+
+    if (l_exp == 0)
+    {
+        if (l_mant == 0)
+            return bits_float(l_sign);
+
+        // Subnormal half: normalise into a float32 exponent
+        int32_t l_e = -14;
+        while ((l_mant & 0x0400U) == 0)
+        {
+            l_mant <<= 1;
+            l_e--;
+        }
+        l_mant &= 0x03FFU;
+        return bits_float(l_sign | ((uint32_t)(l_e + 127) << 23) | (l_mant << 13));
+    }
+    if (l_exp == 0x1FU)
+        return bits_float(l_sign | 0x7F800000U | (l_mant << 13) | (l_mant ? 0x00400000U : 0U));
+
+    return bits_float(l_sign | ((l_exp + 112U) << 23) | (l_mant << 13));
+}
+
+static bfloat16_t float_to_bf16(float32_t p_value)
+{
+    uint32_t l_bits = float_bits(p_value);
+
+    if ((l_bits & 0x7FFFFFFFU) > 0x7F800000U)
+        return (bfloat16_t)((l_bits >> 16) | 0x0040U);
+
+    return (bfloat16_t)((l_bits + 0x7FFFU + ((l_bits >> 16) & 1U)) >> 16);
+}
+
+static inline float32_t bf16_to_float(bfloat16_t p_value)
+{
+    return bits_float((uint32_t)p_value << 16);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Vector conversions                                                        */
+/* ------------------------------------------------------------------------- */
+
+#ifdef PRECISION_X86
+
+__attribute__((target("avx,f16c")))
+static uint64_t narrow_f16_f16c(const float32_t *p_input, uint64_t p_count, float16_t *p_output)
+{
+    uint64_t i = 0;
+    for (; i + 8 <= p_count; i += 8)
+    {
+        __m128i l_half = _mm256_cvtps_ph(_mm256_loadu_ps(&p_input[i]), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)&p_output[i], l_half);
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+static uint64_t widen_f16_f16c(const float16_t *p_input, uint64_t p_count, float32_t *p_output)
+{
+    uint64_t i = 0;
+    for (; i + 8 <= p_count; i += 8)
+    {
+        __m128i l_half = _mm_loadu_si128((const __m128i *)&p_input[i]);
+        _mm256_storeu_ps(&p_output[i], _mm256_cvtph_ps(l_half));
+    }
+    return i;
+}
+
+/*
+ * VCVTNEPS2BF16 rounds to nearest even like float_to_bf16, but treats
+ * float32 denormal inputs as zero; they are far below the signal levels
+ * handled here.
+ */
+__attribute__((target("avx512f,avx512bf16")))
+static uint64_t narrow_bf16_avx512(const float32_t *p_input, uint64_t p_count, bfloat16_t *p_output)
+{
+    uint64_t i = 0;
+    for (; i + 16 <= p_count; i += 16)
+    {
+        __m256bh l_narrow = _mm512_cvtneps_pbh(_mm512_loadu_ps(&p_input[i]));
+        _mm256_storeu_si256((__m256i *)&p_output[i], (__m256i)l_narrow);
+    }
+    return i;
+}
+
+#endif  /* PRECISION_X86 */
+
+/**
+ * @brief Returns the storage size in bytes of one sample of the given type.
+ */
+size_t sample_type_size(FIR_sample_type_t p_type)
+{
+    return (p_type == FIR_SAMPLE_F32) ? sizeof(float32_t) : sizeof(uint16_t);
+}
+
+/**
+ * @brief Returns the printable name of a sample type.
+ */
+const char *sample_type_name(FIR_sample_type_t p_type)
+{
+    if (p_type >= FIR_SAMPLE_TYPE_COUNT)
+        return "unknown";
+    return g_sample_type_names[p_type];
+}
+
+/**
+ * @brief Converts float32 samples to the given storage type.
+ *
+ * @param[in] p_input Pointer to the float32 samples.
+ * @param[in] p_count Number of samples.
+ * @param[in] p_type Storage type to convert to.
+ * @param[out] p_output Pointer to p_count samples of p_type.
+ *
+ * @return void
+ */
+void narrow_samples(const float32_t *p_input, uint64_t p_count, FIR_sample_type_t p_type, void *p_output)
+{
+    uint64_t i = 0;
+
+    if (p_type == FIR_SAMPLE_F16)
+    {
+        float16_t *l_out = p_output;
+#ifdef PRECISION_X86
+        if (__builtin_cpu_supports("f16c"))
+            i = narrow_f16_f16c(p_input, p_count, l_out);
+#endif
+        for (; i < p_count; i++)
+            l_out[i] = float_to_f16(p_input[i]);
+    }
+    else if (p_type == FIR_SAMPLE_BF16)
+    {
+        bfloat16_t *l_out = p_output;
+#ifdef PRECISION_X86
+        if (__builtin_cpu_supports("avx512bf16"))
+            i = narrow_bf16_avx512(p_input, p_count, l_out);
+#endif
+        for (; i < p_count; i++)
+            l_out[i] = float_to_bf16(p_input[i]);
+    }
+    else if (p_output != p_input)
+    {
+        memmove(p_output, p_input, p_count * sizeof(float32_t));
+    }
+}
+
+/**
+ * @brief Converts samples of the given storage type to float32. The conversion is exact.
+ *
+ * @param[in] p_input Pointer to p_count samples of p_type.
+ * @param[in] p_count Number of samples.
+ * @param[in] p_type Storage type of the input.
+ * @param[out] p_output Pointer to the float32 samples.
+ *
+ * @return void
+ */
+void widen_samples(const void *p_input, uint64_t p_count, FIR_sample_type_t p_type, float32_t *p_output)
+{
+    uint64_t i = 0;
+
+    if (p_type == FIR_SAMPLE_F16)
+    {
+        const float16_t *l_in = p_input;
+#ifdef PRECISION_X86
+        if (__builtin_cpu_supports("f16c"))
+            i = widen_f16_f16c(l_in, p_count, p_output);
+#endif
+        for (; i < p_count; i++)
+            p_output[i] = f16_to_float(l_in[i]);
+    }
+    else if (p_type == FIR_SAMPLE_BF16)
+    {
+        const bfloat16_t *l_in = p_input;
+        for (; i < p_count; i++)
+            p_output[i] = bf16_to_float(l_in[i]);
+    }
+    else if (p_output != p_input)
+    {
+        memmove(p_output, p_input, p_count * sizeof(float32_t));
+    }
+}
+
+/**
+ * @brief Rounds float32 samples to the values representable in the given type.
+ *
+ * Useful for building a coefficient set that matches what a narrow store
+ * would hold. p_output may alias p_input.
+ */
+void round_samples(const float32_t *p_input, uint64_t p_count, FIR_sample_type_t p_type, float32_t *p_output)
+{
+    for (uint64_t i = 0; i < p_count; i++)
+    {
+        if (p_type == FIR_SAMPLE_F16)
+            p_output[i] = f16_to_float(float_to_f16(p_input[i]));
+        else if (p_type == FIR_SAMPLE_BF16)
+            p_output[i] = bf16_to_float(float_to_bf16(p_input[i]));
+        else
+            p_output[i] = p_input[i];
+    }
+}
+
+/**
+ * @brief Filters narrow samples with a plan, accumulating in float32.
+ *
+ * Each block of input is widened into the plan's work buffer, filtered by
+ * the plan's kernel into its scratch block and narrowed into p_output. Only
+ * narrow data crosses memory; the float32 copies stay within one block.
+ * The history is kept in float32 and is exact, since it holds widened
+ * narrow values. Like execute_filter_plan, p_output may alias p_input.
+ *
+ * @param[in,out] p_plan Pointer to the plan.
+ * @param[in] p_type Storage type of both input and output.
+ * @param[in] p_input Pointer to p_input_len samples of p_type.
+ * @param[in] p_input_len Length of the input signal.
+ * @param[out] p_output Pointer to p_input_len samples of p_type.
+ *
+ * @return void
+ */
+void execute_filter_plan_narrow(FIR_plan_t *p_plan, FIR_sample_type_t p_type, const void *p_input,
+                                uint64_t p_input_len, void *p_output)
+{
+    uint32_t l_history_len = p_plan->coeff_len - 1;
+    float32_t *l_block = &p_plan->work[l_history_len];
+    size_t l_size = sample_type_size(p_type);
+    const uint8_t *l_in = p_input;
+    uint8_t *l_out = p_output;
+
+    uint64_t l_start = (p_plan->telemetry != NULL) ? telemetry_now_ns() : 0;
+    uint64_t l_blocks = 0;
+    uint32_t l_len = 0;
+
+    for (uint64_t l_done = 0; l_done < p_input_len; l_blocks++)
+    {
+        l_len = p_plan->block_len;
+        if (p_input_len - l_done < l_len)
+            l_len = (uint32_t)(p_input_len - l_done);
+
+        widen_samples(&l_in[(size_t)l_done * l_size], l_len, p_type, l_block);
+        p_plan->kernel_fn(p_plan, l_block, l_len, p_plan->scratch);
+        narrow_samples(p_plan->scratch, l_len, p_type, &l_out[(size_t)l_done * l_size]);
+
+        memmove(p_plan->work, &p_plan->work[l_len], l_history_len * sizeof(float32_t));
+        l_done += l_len;
+    }
+
+    if (p_plan->telemetry != NULL)
+        report_plan_telemetry(p_plan, l_blocks, p_input_len, l_start, p_plan->scratch, l_len);
+}
+
+/**
+ * @brief Compares a signal against a float32 reference.
+ *
+ * @param[in] p_reference Pointer to the reference signal.
+ * @param[in] p_test Pointer to the signal under test.
+ * @param[in] p_len Length of both signals.
+ *
+ * @return Maximum and RMS absolute error and the signal-to-error ratio in dB
+ *         (INFINITY when the signals are identical).
+ */
+FIR_precision_error_t measure_precision_error(const float32_t *p_reference, const float32_t *p_test, uint64_t p_len)
+{
+    FIR_precision_error_t l_error = { 0.0f, 0.0f, INFINITY };
+    double l_signal = 0.0, l_noise = 0.0;
+
+    for (uint64_t i = 0; i < p_len; i++)
+    {
+        double l_diff = (double)p_test[i] - (double)p_reference[i];
+        if (fabs(l_diff) > l_error.max_abs_error)
+            l_error.max_abs_error = (float32_t)fabs(l_diff);
+        l_signal += (double)p_reference[i] * (double)p_reference[i];
+        l_noise += l_diff * l_diff;
+    }
+
+    if (p_len > 0)
+        l_error.rms_error = (float32_t)sqrt(l_noise / (double)p_len);
+    if (l_noise > 0.0)
+        l_error.snr_db = (float32_t)(10.0 * log10(l_signal / l_noise));
+
+    return l_error;
+}
+
+/**
+ * @brief Prints one line of a precision report.
+ */
+void print_precision_error(const char *p_label, FIR_precision_error_t p_error)
+{
+    printf("| %-10s | %12.3e | %12.3e | %8.2f dB |\n", p_label, p_error.max_abs_error,
+           p_error.rms_error, p_error.snr_db);
+}
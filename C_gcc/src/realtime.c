@@ -0,0 +1,310 @@
+/**
+ * @file realtime.c
+ * @brief Real-time mode for filter threads and the block jitter measurement.
+ */
+
+#define _GNU_SOURCE  /* sched_getcpu, RUSAGE_THREAD */
+
+#include "realtime.h"
+#include "telemetry.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#define REALTIME_PAGE  4096U
+
+static FIR_realtime_config_t g_config = { -1, 0, false, false };
+static bool g_enabled = false;
+static bool g_memory_locked = false;
+static _Atomic uint32_t g_threads_entered;
+static _Atomic uint32_t g_threads_pinned;
+static _Atomic uint32_t g_pin_fallbacks;
+static _Atomic uint32_t g_threads_fifo;
+static _Atomic uint32_t g_fifo_fallbacks;
+static _Atomic uint64_t g_prefaulted_bytes;
+
+/* What enter_realtime_thread() changed, for leave_realtime_thread() to put back */
+static _Thread_local bool t_entered = false;
+static _Thread_local bool t_mask_saved = false;
+static _Thread_local cpu_set_t t_saved_mask;
+static _Thread_local int t_saved_policy;
+static _Thread_local struct sched_param t_saved_param;
+
+/**
+ * @brief Sets the real-time mode of the process and locks its memory if asked to.
+ *
+ * Call it before creating the plans and threads it should apply to. A
+ * refused mlockall() is not an error: the memory stays unlocked, prefaulting
+ * still applies and read_realtime_stats() reports the fallback.
+ *
+ * @param[in] p_config Pinning, scheduling and memory options.
+ *
+ * @return false if the options are out of range.
+ */
+bool configure_realtime(const FIR_realtime_config_t *p_config)
+{
+    int l_max_priority = sched_get_priority_max(SCHED_FIFO);
+
+    if (p_config->first_cpu < -1 || p_config->fifo_priority < 0
+        || (p_config->fifo_priority > 0 && p_config->fifo_priority > l_max_priority))
+    {
+        printf("Error. Real-time mode needs a CPU of 0 or more (-1 for none) and a SCHED_FIFO priority of 1 to %d.\n",
+               l_max_priority);
+        return false;
+    }
+
+    g_config = *p_config;
+    g_enabled = true;
+
+    if (g_config.lock_memory && !g_memory_locked)
+        g_memory_locked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+
+    return true;
+}
+
+/**
+ * @brief Whether configure_realtime() has been called.
+ */
+bool realtime_enabled(void)
+{
+    return g_enabled;
+}
+
+/* Touches the stack the thread will grow into, so deep calls do not fault later */
+static void __attribute__((noinline)) prefault_stack(void)
+{
+    volatile uint8_t l_stack[REALTIME_STACK_PREFAULT];
+
+    for (uint32_t i = 0; i < REALTIME_STACK_PREFAULT; i += REALTIME_PAGE)
+    {
+        l_stack[i] = 0;
+    }
+    __asm__ volatile("" : : "r"(l_stack) : "memory");
+}
+
+/* Pins the calling thread to CPU first_cpu + index, which must be in its affinity mask */
+static bool pin_thread(uint32_t p_thread_index)
+{
+    cpu_set_t l_target;
+    uint64_t l_cpu = (uint64_t)g_config.first_cpu + p_thread_index;
+
+    if (!t_mask_saved || l_cpu >= CPU_SETSIZE || !CPU_ISSET((int)l_cpu, &t_saved_mask))
+    {
+        printf("Error. CPU %llu is not one this thread may run on; thread %u is not pinned.\n",
+               (unsigned long long)l_cpu, p_thread_index);
+        return false;
+    }
+
+    CPU_ZERO(&l_target);
+    CPU_SET((int)l_cpu, &l_target);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(l_target), &l_target) != 0)
+    {
+        printf("Error. Not able to pin thread %u to CPU %llu.\n", p_thread_index, (unsigned long long)l_cpu);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies the real-time mode to the calling filter thread.
+ *
+ * Pins the thread, switches it to SCHED_FIFO and prefaults its stack, as
+ * configured. Each step that is refused leaves the thread as it was and is
+ * counted as a fallback. Does nothing unless configure_realtime() was called.
+ *
+ * @param[in] p_thread_index Index of the thread among the filter threads,
+ *            which picks its CPU.
+ *
+ * @return false if a requested step fell back.
+ */
+bool enter_realtime_thread(uint32_t p_thread_index)
+{
+    bool l_ok = true;
+
+    if (!g_enabled)
+        return true;
+
+    atomic_fetch_add_explicit(&g_threads_entered, 1, memory_order_relaxed);
+    if (!t_entered)
+    {
+        t_mask_saved = pthread_getaffinity_np(pthread_self(), sizeof(t_saved_mask), &t_saved_mask) == 0;
+        if (pthread_getschedparam(pthread_self(), &t_saved_policy, &t_saved_param) != 0)
+        {
+            t_saved_policy = SCHED_OTHER;
+            t_saved_param.sched_priority = 0;
+        }
+        t_entered = true;
+    }
+
+    if (g_config.first_cpu >= 0)
+    {
+        if (pin_thread(p_thread_index))
+            atomic_fetch_add_explicit(&g_threads_pinned, 1, memory_order_relaxed);
+        else
+        {
+            atomic_fetch_add_explicit(&g_pin_fallbacks, 1, memory_order_relaxed);
+            l_ok = false;
+        }
+    }
+
+    if (g_config.fifo_priority > 0)
+    {
+        struct sched_param l_param = { .sched_priority = g_config.fifo_priority };
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &l_param) == 0)
+            atomic_fetch_add_explicit(&g_threads_fifo, 1, memory_order_relaxed);
+        else
+        {
+            atomic_fetch_add_explicit(&g_fifo_fallbacks, 1, memory_order_relaxed);
+            l_ok = false;
+        }
+    }
+
+    if (g_config.prefault)
+        prefault_stack();
+
+    return l_ok;
+}
+
+/**
+ * @brief Returns the calling thread to the scheduling and CPUs it had before enter_realtime_thread().
+ *
+ * For threads that go on to do non-filtering work; memory stays locked.
+ * Does nothing on a thread that has not entered the real-time mode.
+ */
+void leave_realtime_thread(void)
+{
+    if (!t_entered)
+        return;
+
+    pthread_setschedparam(pthread_self(), t_saved_policy, &t_saved_param);
+    if (t_mask_saved)
+        pthread_setaffinity_np(pthread_self(), sizeof(t_saved_mask), &t_saved_mask);
+    t_entered = false;
+}
+
+/**
+ * @brief Touches every page of a buffer so that its first use does not fault.
+ *
+ * Called by the creators of plans and buffers on the memory they allocate;
+ * does nothing unless the real-time mode asks for prefaulting. The contents
+ * are left as they are.
+ *
+ * @param[in,out] p_ptr Start of the buffer; NULL is ignored.
+ * @param[in] p_bytes Length of the buffer.
+ */
+void prefault_memory(void *p_ptr, size_t p_bytes)
+{
+    if (!g_enabled || !g_config.prefault || p_ptr == NULL || p_bytes == 0)
+        return;
+
+    volatile uint8_t *l_bytes = p_ptr;
+    size_t l_first = (REALTIME_PAGE - ((uintptr_t)p_ptr & (REALTIME_PAGE - 1))) & (REALTIME_PAGE - 1);
+
+    // A write, not a read: reading a fresh page maps the shared zero page
+    l_bytes[0] = l_bytes[0];
+    for (size_t i = l_first; i < p_bytes; i += REALTIME_PAGE)
+    {
+        l_bytes[i] = l_bytes[i];
+    }
+    atomic_fetch_add_explicit(&g_prefaulted_bytes, p_bytes, memory_order_relaxed);
+}
+
+/**
+ * @brief Reads what the real-time mode has applied so far.
+ */
+void read_realtime_stats(FIR_realtime_stats_t *p_stats)
+{
+    p_stats->enabled = g_enabled;
+    p_stats->memory_locked = g_memory_locked;
+    p_stats->threads_entered = atomic_load_explicit(&g_threads_entered, memory_order_relaxed);
+    p_stats->threads_pinned = atomic_load_explicit(&g_threads_pinned, memory_order_relaxed);
+    p_stats->pin_fallbacks = atomic_load_explicit(&g_pin_fallbacks, memory_order_relaxed);
+    p_stats->threads_fifo = atomic_load_explicit(&g_threads_fifo, memory_order_relaxed);
+    p_stats->fifo_fallbacks = atomic_load_explicit(&g_fifo_fallbacks, memory_order_relaxed);
+    p_stats->prefaulted_bytes = atomic_load_explicit(&g_prefaulted_bytes, memory_order_relaxed);
+}
+
+/**
+ * @brief Prints which parts of the real-time mode took effect and which fell back.
+ */
+void print_realtime_stats(const FIR_realtime_stats_t *p_stats)
+{
+    if (!p_stats->enabled)
+    {
+        printf("Real-time mode: off\n");
+        return;
+    }
+
+    printf("Real-time mode:\n");
+    if (g_config.lock_memory)
+        printf("Memory: %s\n", p_stats->memory_locked ? "locked" : "not locked (mlockall refused), prefaulting only");
+    printf("Threads: %u entered, %u pinned, %u pinning fallbacks\n", p_stats->threads_entered,
+           p_stats->threads_pinned, p_stats->pin_fallbacks);
+    if (g_config.fifo_priority > 0)
+        printf("SCHED_FIFO %d: %u threads, %u fallbacks to normal scheduling\n", g_config.fifo_priority,
+               p_stats->threads_fifo, p_stats->fifo_fallbacks);
+    printf("Prefaulted: %.1f KiB\n", (double)p_stats->prefaulted_bytes / 1024.0);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Jitter                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Filters a signal block by block, timing every block.
+ *
+ * The blocks are the plan's block length; the report counts the page
+ * faults and involuntary context switches of the calling thread over the
+ * loop and the blocks that started on a different CPU than the previous one.
+ *
+ * @param[in,out] p_plan Plan to run; its history carries across the blocks.
+ * @param[in] p_input Pointer to the input signal array.
+ * @param[in] p_input_len Length of the input signal.
+ * @param[out] p_output Pointer to the output signal array.
+ * @param[out] p_report Block latencies and disturbances.
+ *
+ * @return false if the thread's resource usage could not be read.
+ */
+bool measure_plan_jitter(FIR_plan_t *p_plan, const float32_t *p_input, uint64_t p_input_len,
+                         float32_t *p_output, FIR_jitter_report_t *p_report)
+{
+    struct rusage l_before;
+    struct rusage l_after;
+
+    memset(p_report, 0, sizeof(*p_report));
+    if (getrusage(RUSAGE_THREAD, &l_before) != 0)
+    {
+        printf("Error. Not able to read the thread's resource usage: %s.\n", strerror(errno));
+        return false;
+    }
+
+    int l_cpu = sched_getcpu();
+    for (uint64_t n = 0; n < p_input_len; n += p_plan->block_len)
+    {
+        uint64_t l_len = p_input_len - n;
+        if (l_len > p_plan->block_len)
+            l_len = p_plan->block_len;
+
+        uint64_t l_start = telemetry_now_ns();
+        execute_filter_plan(p_plan, &p_input[n], l_len, &p_output[n]);
+        record_latency(&p_report->histogram, telemetry_now_ns() - l_start);
+
+        int l_now = sched_getcpu();
+        if (l_now != l_cpu)
+            p_report->cpu_changes++;
+        l_cpu = l_now;
+        p_report->blocks++;
+    }
+
+    getrusage(RUSAGE_THREAD, &l_after);
+    p_report->minor_faults = (uint64_t)(l_after.ru_minflt - l_before.ru_minflt);
+    p_report->major_faults = (uint64_t)(l_after.ru_majflt - l_before.ru_majflt);
+    p_report->involuntary_switches = (uint64_t)(l_after.ru_nivcsw - l_before.ru_nivcsw);
+    return true;
+}
@@ -0,0 +1,287 @@
+/**
+ * @file sample_io.c
+ * @brief Reading and writing binary sample files.
+ */
+
+#include "sample_io.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Validates a sample file header.
+ *
+ * @param[in] p_header Pointer to the header read from the file.
+ * @param[in] p_filename File name used in error messages.
+ *
+ * @return true if the header describes a sample file this build can read.
+ */
+bool check_sample_header(const FIR_sample_header_t *p_header, const char *p_filename)
+{
+    if (memcmp(p_header->magic, SAMPLE_FILE_MAGIC, sizeof(p_header->magic)) != 0)
+    {
+        printf("Error. %s is not a sample file.\n", p_filename);
+        return false;
+    }
+    if (p_header->version != SAMPLE_FILE_VERSION || p_header->sample_type >= FIR_SAMPLE_TYPE_COUNT)
+    {
+        printf("Error. %s has unsupported version %u or sample type %u.\n", p_filename,
+               p_header->version, p_header->sample_type);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that a sample file holds all the samples its header announces.
+ *
+ * Bounds sample_count by the bytes after the header, so that sample_count
+ * times the sample size cannot overflow before a buffer is sized from it.
+ *
+ * @param[in] p_header Pointer to a header accepted by check_sample_header().
+ * @param[in] p_file_len Size of the whole file in bytes.
+ * @param[in] p_filename File name used in error messages.
+ *
+ * @return false if the file is shorter than the header says.
+ */
+bool check_sample_count(const FIR_sample_header_t *p_header, uint64_t p_file_len, const char *p_filename)
+{
+    size_t l_size = sample_type_size((FIR_sample_type_t)p_header->sample_type);
+
+    if (p_file_len < sizeof(*p_header) || p_header->sample_count > (p_file_len - sizeof(*p_header)) / l_size)
+    {
+        printf("Error. %s is truncated.\n", p_filename);
+        return false;
+    }
+    return true;
+}
+
+/* check_sample_count() for an open stdio file */
+static bool check_file_sample_count(FILE *p_file, const FIR_sample_header_t *p_header, const char *p_filename)
+{
+    struct stat l_stat;
+
+    if (fstat(fileno(p_file), &l_stat) != 0)
+    {
+        printf("Error. Not able to read the size of %s.\n", p_filename);
+        return false;
+    }
+    return check_sample_count(p_header, (uint64_t)l_stat.st_size, p_filename);
+}
+
+/**
+ * @brief Writes samples of any storage type to a binary sample file.
+ *
+ * @param p_filename The path to the output file. The file will be created or overwritten.
+ * @param p_type Storage type of the samples.
+ * @param p_samples Pointer to the samples.
+ * @param p_sample_count Number of samples.
+ *
+ * @return true on success, false if the file could not be written.
+ */
+bool write_sample_file(const char *p_filename, FIR_sample_type_t p_type, const void *p_samples, uint64_t p_sample_count)
+{
+    FILE *l_file = fopen(p_filename, "wb");
+
+    if (l_file == NULL)
+    {
+        printf("Error. Not able to open file %s for writing.\n", p_filename);
+        return false;
+    }
+
+    FIR_sample_header_t l_header = { .version = SAMPLE_FILE_VERSION, .sample_type = (uint16_t)p_type,
+                                     .sample_count = p_sample_count };
+    memcpy(l_header.magic, SAMPLE_FILE_MAGIC, sizeof(l_header.magic));
+
+    size_t l_size = sample_type_size(p_type);
+    bool l_ok = fwrite(&l_header, sizeof(l_header), 1, l_file) == 1
+                && fwrite(p_samples, l_size, p_sample_count, l_file) == p_sample_count;
+
+    if (fclose(l_file) != 0 || !l_ok)
+    {
+        printf("Error. Not able to write %s.\n", p_filename);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a whole binary sample file into memory.
+ *
+ * @param[in] p_filename The path to the sample file.
+ * @param[out] p_type Storage type of the samples read.
+ * @param[out] p_sample_count Number of samples read.
+ *
+ * @return An arena buffer holding the samples in their stored type, or
+ *         NULL on failure. The caller releases it with arena_free().
+ */
+void *read_sample_file(const char *p_filename, FIR_sample_type_t *p_type, uint64_t *p_sample_count)
+{
+    FILE *l_file = fopen(p_filename, "rb");
+
+    if (l_file == NULL)
+    {
+        printf("Error. Not able to open file %s for reading.\n", p_filename);
+        return NULL;
+    }
+
+    FIR_sample_header_t l_header;
+    if (fread(&l_header, sizeof(l_header), 1, l_file) != 1 || !check_sample_header(&l_header, p_filename)
+        || !check_file_sample_count(l_file, &l_header, p_filename))
+    {
+        fclose(l_file);
+        return NULL;
+    }
+
+    size_t l_size = sample_type_size((FIR_sample_type_t)l_header.sample_type);
+    void *l_samples = arena_alloc(l_header.sample_count ? l_header.sample_count * l_size : 1);
+    if (l_samples == NULL || fread(l_samples, l_size, l_header.sample_count, l_file) != l_header.sample_count)
+    {
+        printf("Error. %s is truncated or too large.\n", p_filename);
+        arena_free(l_samples);
+        fclose(l_file);
+        return NULL;
+    }
+
+    fclose(l_file);
+    *p_type = (FIR_sample_type_t)l_header.sample_type;
+    *p_sample_count = l_header.sample_count;
+    return l_samples;
+}
+
+/**
+ * @brief Makes sure a reusable buffer can hold p_bytes, growing it if needed.
+ *
+ * The capacity doubles until it holds p_bytes, and is p_bytes itself once
+ * doubling would go past it by more than twice or overflow. Used by
+ * load_signal_into(), and by callers sizing its buffer in advance.
+ *
+ * @return false if the buffer could not be grown; it is then unchanged.
+ */
+bool reserve_signal_buffer(void **p_buffer, uint64_t *p_capacity, uint64_t p_bytes)
+{
+    if (p_bytes <= *p_capacity)
+        return true;
+
+    uint64_t l_capacity = (*p_capacity > 0) ? *p_capacity : 4096U;
+    while (l_capacity < p_bytes && l_capacity <= p_bytes / 2U)
+        l_capacity *= 2U;
+    if (l_capacity < p_bytes)
+        l_capacity = p_bytes;
+
+    void *l_buffer = arena_realloc(*p_buffer, l_capacity);
+    if (l_buffer == NULL)
+        return false;
+
+    *p_buffer = l_buffer;
+    *p_capacity = l_capacity;
+    return true;
+}
+
+/**
+ * @brief Parses comma separated float32 values into a reusable buffer.
+ */
+static bool load_csv_into(FILE *p_file, void **p_buffer, uint64_t *p_capacity, uint64_t *p_sample_count)
+{
+    uint64_t l_count = 0;
+    float l_value;
+
+    while (fscanf(p_file, " %f ,", &l_value) == 1)
+    {
+        if (!reserve_signal_buffer(p_buffer, p_capacity, (l_count + 1) * sizeof(float32_t)))
+            return false;
+        ((float32_t *)*p_buffer)[l_count++] = l_value;
+    }
+
+    *p_sample_count = l_count;
+    return feof(p_file) != 0;
+}
+
+/**
+ * @brief Largest buffer load_signal_into() can need for a file, in bytes.
+ *
+ * Exact for a sample file (the bytes after its header); for CSV, which
+ * holds at least two characters per value, two float32 bytes per file byte.
+ *
+ * @return The bound, 0 if the file cannot be opened.
+ */
+uint64_t signal_buffer_bound(const char *p_filename)
+{
+    FILE *l_file = fopen(p_filename, "rb");
+    struct stat l_stat;
+
+    if (l_file == NULL)
+        return 0;
+    if (fstat(fileno(l_file), &l_stat) != 0)
+    {
+        fclose(l_file);
+        return 0;
+    }
+
+    uint64_t l_bytes = (uint64_t)l_stat.st_size;
+    FIR_sample_header_t l_header;
+    bool l_samples = fread(&l_header, sizeof(l_header), 1, l_file) == 1
+                     && memcmp(l_header.magic, SAMPLE_FILE_MAGIC, sizeof(l_header.magic)) == 0;
+    fclose(l_file);
+
+    return l_samples ? l_bytes - sizeof(l_header) : 2U * (l_bytes + 1U);
+}
+
+/**
+ * @brief Reads a signal file of either format into a caller-owned, reusable buffer.
+ *
+ * The format is recognised from the file contents: binary sample files
+ * start with the "FIRS" magic, anything else is parsed as CSV. The buffer is
+ * an arena block, grown with arena_realloc() when it is too small, so a
+ * worker that reads many files keeps a single allocation.
+ *
+ * @param[in] p_filename Path of the signal file.
+ * @param[in,out] p_buffer Arena buffer pointer, may point to NULL on first use.
+ * @param[in,out] p_capacity Size of *p_buffer in bytes.
+ * @param[out] p_type Storage type of the samples (always f32 for CSV).
+ * @param[out] p_sample_count Number of samples read.
+ * @param[out] p_format Format the file was stored in.
+ *
+ * @return true on success, false if the file could not be read.
+ */
+bool load_signal_into(const char *p_filename, void **p_buffer, uint64_t *p_capacity, FIR_sample_type_t *p_type,
+                      uint64_t *p_sample_count, FIR_file_format_t *p_format)
+{
+    FILE *l_file = fopen(p_filename, "rb");
+
+    if (l_file == NULL)
+    {
+        printf("Error. Not able to open file %s for reading.\n", p_filename);
+        return false;
+    }
+
+    FIR_sample_header_t l_header;
+    bool l_ok;
+
+    if (fread(&l_header, sizeof(l_header), 1, l_file) == 1
+        && memcmp(l_header.magic, SAMPLE_FILE_MAGIC, sizeof(l_header.magic)) == 0)
+    {
+        size_t l_size = sample_type_size((FIR_sample_type_t)l_header.sample_type);
+        l_ok = check_sample_header(&l_header, p_filename)
+               && check_file_sample_count(l_file, &l_header, p_filename)
+               && reserve_signal_buffer(p_buffer, p_capacity, l_header.sample_count * l_size)
+               && fread(*p_buffer, l_size, l_header.sample_count, l_file) == l_header.sample_count;
+        *p_type = (FIR_sample_type_t)l_header.sample_type;
+        *p_sample_count = l_header.sample_count;
+        *p_format = FIR_FORMAT_SAMPLES;
+    }
+    else
+    {
+        rewind(l_file);
+        l_ok = load_csv_into(l_file, p_buffer, p_capacity, p_sample_count);
+        *p_type = FIR_SAMPLE_F32;
+        *p_format = FIR_FORMAT_CSV;
+    }
+
+    fclose(l_file);
+    if (!l_ok)
+        printf("Error. Not able to read signal from %s.\n", p_filename);
+    return l_ok;
+}
@@ -0,0 +1,466 @@
+/**
+ * @file stream.c
+ * @brief Window-by-window filtering of sample files larger than memory.
+ */
+
+#define _GNU_SOURCE  /* sync_file_range */
+
+#include "stream.h"
+#include "telemetry.h"
+#include "sample_io.h"
+#include "arena.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Only a bounded part of either file is kept in memory:
+ *
+ * - input:  window w is filtered while windows w+1 .. w+readahead are being
+ *           read in (MADV_WILLNEED / POSIX_FADV_WILLNEED); pages behind the
+ *           window are dropped from the mapping and the page cache.
+ * - output: each window is written from one window-sized buffer; writeback
+ *           of window w is started at once and window w-1 is waited for and
+ *           dropped from the page cache, so dirty pages never pile up.
+ */
+
+typedef struct {
+    int            fd;
+    uint64_t       file_len;
+    const uint8_t *map;       /* NULL in pread() mode */
+    uint64_t       page_len;
+} stream_input_t;
+
+#define STREAM_NAME_MAX  512U
+
+static uint64_t page_floor(uint64_t p_offset, uint64_t p_page_len)
+{
+    return p_offset - p_offset % p_page_len;
+}
+
+/**
+ * @brief Asks the kernel to start reading bytes [p_offset, p_offset + p_len) of the input.
+ */
+static void prefetch_input(const stream_input_t *p_input, uint64_t p_offset, uint64_t p_len)
+{
+    if (p_offset >= p_input->file_len)
+        return;
+    if (p_len > p_input->file_len - p_offset)
+        p_len = p_input->file_len - p_offset;
+
+    if (p_input->map != NULL)
+    {
+        uint64_t l_start = page_floor(p_offset, p_input->page_len);
+        madvise((void *)&p_input->map[l_start], p_offset + p_len - l_start, MADV_WILLNEED);
+    }
+    else
+    {
+        posix_fadvise(p_input->fd, (off_t)p_offset, (off_t)p_len, POSIX_FADV_WILLNEED);
+    }
+}
+
+/**
+ * @brief Drops bytes [p_offset, p_offset + p_len) of the input from the mapping and the page cache.
+ *
+ * p_offset must be page aligned.
+ */
+static void release_input(const stream_input_t *p_input, uint64_t p_offset, uint64_t p_len)
+{
+    if (p_len == 0)
+        return;
+
+    if (p_input->map != NULL)
+        madvise((void *)&p_input->map[p_offset], p_len, MADV_DONTNEED);
+    posix_fadvise(p_input->fd, (off_t)p_offset, (off_t)p_len, POSIX_FADV_DONTNEED);
+}
+
+static bool read_all(int p_fd, void *p_buffer, uint64_t p_len, uint64_t p_offset)
+{
+    uint8_t *l_buffer = p_buffer;
+
+    while (p_len > 0)
+    {
+        ssize_t l_read = pread(p_fd, l_buffer, p_len, (off_t)p_offset);
+        if (l_read < 0 && errno == EINTR)
+            continue;
+        if (l_read <= 0)
+            return false;
+
+        l_buffer += l_read;
+        p_offset += (uint64_t)l_read;
+        p_len -= (uint64_t)l_read;
+    }
+    return true;
+}
+
+static bool write_all(int p_fd, const void *p_buffer, uint64_t p_len)
+{
+    const uint8_t *l_buffer = p_buffer;
+
+    while (p_len > 0)
+    {
+        ssize_t l_written = write(p_fd, l_buffer, p_len);
+        if (l_written < 0 && errno == EINTR)
+            continue;
+        if (l_written <= 0)
+            return false;
+
+        l_buffer += l_written;
+        p_len -= (uint64_t)l_written;
+    }
+    return true;
+}
+
+/**
+ * @brief Starts writeback of [p_offset, p_offset + p_len) and drops everything
+ *        from p_flushed up to p_offset, once it is on disk, from the page cache.
+ */
+static void flush_behind(int p_fd, uint64_t p_flushed, uint64_t p_offset, uint64_t p_len)
+{
+#ifdef __linux__
+    if (p_len > 0)
+        sync_file_range(p_fd, (off64_t)p_offset, (off64_t)p_len, SYNC_FILE_RANGE_WRITE);
+    if (p_offset > p_flushed)
+    {
+        sync_file_range(p_fd, (off64_t)p_flushed, (off64_t)(p_offset - p_flushed),
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(p_fd, (off_t)p_flushed, (off_t)(p_offset - p_flushed), POSIX_FADV_DONTNEED);
+    }
+#else
+    (void)p_fd; (void)p_flushed; (void)p_offset; (void)p_len;
+#endif
+}
+
+/**
+ * @brief Opens the input sample file and maps it if asked to.
+ *
+ * @return true with p_header filled in if the file is a readable sample file
+ *         holding all the samples its header announces.
+ */
+static bool open_input(const char *p_filename, bool p_use_mmap, stream_input_t *p_input, FIR_sample_header_t *p_header)
+{
+    struct stat l_stat;
+
+    p_input->map = NULL;
+    p_input->page_len = (uint64_t)sysconf(_SC_PAGESIZE);
+    p_input->fd = open(p_filename, O_RDONLY);
+    if (p_input->fd < 0)
+    {
+        printf("Error. Not able to open file %s for reading.\n", p_filename);
+        return false;
+    }
+
+    if (fstat(p_input->fd, &l_stat) != 0 || !read_all(p_input->fd, p_header, sizeof(*p_header), 0))
+    {
+        printf("Error. %s is not a sample file.\n", p_filename);
+        return false;
+    }
+    if (!check_sample_header(p_header, p_filename))
+        return false;
+
+    p_input->file_len = (uint64_t)l_stat.st_size;
+    if (!check_sample_count(p_header, p_input->file_len, p_filename))
+        return false;
+
+    if (p_use_mmap && p_input->file_len > 0)
+    {
+        void *l_map = mmap(NULL, p_input->file_len, PROT_READ, MAP_PRIVATE, p_input->fd, 0);
+        if (l_map != MAP_FAILED)
+        {
+            p_input->map = l_map;
+            madvise(l_map, p_input->file_len, MADV_SEQUENTIAL);
+        }
+    }
+    if (p_input->map == NULL)
+        posix_fadvise(p_input->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return true;
+}
+
+/**
+ * @brief Filters a sample file of any length into another, a window at a time.
+ *
+ * The samples are filtered in their stored type with the plan's kernel, as
+ * in a batch job, and the output has the same sample type as the input. The
+ * plan is reset first, so its history starts at zero. Memory use is one
+ * window buffer plus the read-ahead and write-behind windows in the page
+ * cache, independent of the file size.
+ *
+ * @param[in,out] p_plan Plan to filter with.
+ * @param[in] p_input Path of the input sample file.
+ * @param[in] p_output Path of the output sample file, created or overwritten.
+ * @param[in] p_config Window length and read-ahead settings; NULL for the defaults.
+ * @param[out] p_report Filled in with the sample count, timing and peak RSS.
+ *
+ * @return true on success.
+ */
+bool stream_filter_file(FIR_plan_t *p_plan, const char *p_input, const char *p_output,
+                        const FIR_stream_config_t *p_config, FIR_stream_report_t *p_report)
+{
+    FIR_stream_config_t l_config = { STREAM_DEFAULT_WINDOW, STREAM_DEFAULT_READAHEAD, true };
+    stream_input_t l_input;
+    FIR_sample_header_t l_header;
+    uint64_t l_start = telemetry_now_ns();
+    bool l_ok = false;
+
+    if (p_config != NULL)
+        l_config = *p_config;
+    if (l_config.window_len == 0)
+        l_config.window_len = STREAM_DEFAULT_WINDOW;
+
+    memset(p_report, 0, sizeof(*p_report));
+
+    if (!open_input(p_input, l_config.use_mmap, &l_input, &l_header))
+    {
+        if (l_input.fd >= 0)
+            close(l_input.fd);
+        return false;
+    }
+
+    FIR_sample_type_t l_type = (FIR_sample_type_t)l_header.sample_type;
+    uint64_t l_count = l_header.sample_count;
+    size_t l_size = sample_type_size(l_type);
+    uint64_t l_window_bytes = (uint64_t)l_config.window_len * l_size;
+    uint8_t *l_buffer = arena_alloc(l_window_bytes);
+
+    int l_out = open(p_output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (l_out < 0)
+        printf("Error. Not able to open file %s for writing.\n", p_output);
+
+    if (l_buffer != NULL && l_out >= 0 && write_all(l_out, &l_header, sizeof(l_header)))
+    {
+        uint64_t l_released = 0;
+        uint64_t l_flushed = 0;
+
+        reset_filter_plan(p_plan);
+        prefetch_input(&l_input, sizeof(l_header), l_window_bytes * l_config.readahead);
+
+        l_ok = true;
+        for (uint64_t l_done = 0; l_ok && l_done < l_count; p_report->windows++)
+        {
+            uint64_t l_len = l_count - l_done;
+            if (l_len > l_config.window_len)
+                l_len = l_config.window_len;
+
+            uint64_t l_offset = sizeof(l_header) + l_done * l_size;
+            uint64_t l_bytes = l_len * l_size;
+
+            prefetch_input(&l_input, l_offset + l_window_bytes * l_config.readahead, l_window_bytes);
+
+            const void *l_source = l_buffer;
+            if (l_input.map != NULL)
+                l_source = &l_input.map[l_offset];
+            else if (!read_all(l_input.fd, l_buffer, l_bytes, l_offset))
+            {
+                printf("Error. Not able to read %s.\n", p_input);
+                l_ok = false;
+                break;
+            }
+
+            if (l_type == FIR_SAMPLE_F32)
+                execute_filter_plan(p_plan, l_source, l_len, (float32_t *)l_buffer);
+            else
+                execute_filter_plan_narrow(p_plan, l_type, l_source, l_len, l_buffer);
+
+            if (!write_all(l_out, l_buffer, l_bytes))
+            {
+                printf("Error. Not able to write %s.\n", p_output);
+                l_ok = false;
+                break;
+            }
+
+            flush_behind(l_out, l_flushed, l_offset, l_bytes);
+            l_flushed = l_offset;
+
+            uint64_t l_consumed = page_floor(l_offset + l_bytes, l_input.page_len);
+            release_input(&l_input, l_released, l_consumed - l_released);
+            l_released = l_consumed;
+            l_done += l_len;
+        }
+
+        flush_behind(l_out, l_flushed, sizeof(l_header) + l_count * l_size, 0);
+    }
+
+    if (l_out >= 0 && close(l_out) != 0 && l_ok)
+    {
+        printf("Error. Not able to write %s.\n", p_output);
+        l_ok = false;
+    }
+    if (l_input.map != NULL)
+        munmap((void *)l_input.map, l_input.file_len);
+    close(l_input.fd);
+    arena_free(l_buffer);
+
+    struct rusage l_usage;
+    getrusage(RUSAGE_SELF, &l_usage);
+
+    p_report->type = l_type;
+    p_report->samples = l_ok ? l_count : 0;
+    p_report->mapped = l_input.map != NULL;
+    p_report->wall_s = (double)(telemetry_now_ns() - l_start) * 1e-9;
+    p_report->peak_rss_kb = (uint64_t)l_usage.ru_maxrss;
+
+    return l_ok;
+}
+
+/**
+ * @brief Prints the throughput and memory summary of a streamed file.
+ */
+void print_stream_report(const FIR_stream_report_t *p_report)
+{
+    double l_wall = (p_report->wall_s > 0.0) ? p_report->wall_s : 1e-9;
+    double l_bytes = (double)p_report->samples * (double)sample_type_size(p_report->type);
+
+    printf("Stream Summary:\n");
+    printf("Samples: %llu %s in %llu windows (%s)\n", (unsigned long long)p_report->samples,
+           sample_type_name(p_report->type), (unsigned long long)p_report->windows,
+           p_report->mapped ? "mmap" : "pread");
+    printf("Wall time: %.3f s\n", p_report->wall_s);
+    printf("Throughput: %.2f Msamples/s, %.1f MB/s\n", (double)p_report->samples / l_wall * 1e-6,
+           l_bytes / l_wall * 1e-6);
+    printf("Peak RSS: %.1f MB\n", (double)p_report->peak_rss_kb / 1024.0);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Reader                                                                    */
+/* ------------------------------------------------------------------------- */
+
+struct FIR_stream_reader {
+    stream_input_t      input;
+    FIR_sample_header_t header;
+    char                filename[STREAM_NAME_MAX];
+    uint8_t            *buffer;      /* p_max_read samples in their stored type, pread() mode only */
+    uint32_t            max_read;
+    uint64_t            position;    /* samples read so far */
+    uint64_t            prefetched;  /* file offset read-ahead has been requested up to */
+    uint64_t            released;    /* file offset everything before which has been dropped */
+};
+
+/**
+ * @brief Opens a sample file for reading in small steps through the streaming input path.
+ *
+ * @param[in] p_filename Path of the sample file.
+ * @param[in] p_max_read Largest number of samples read_stream_samples() is asked for at once.
+ * @param[in] p_use_mmap Map the file; pread() is used if false or if mapping fails.
+ *
+ * @return The reader, or NULL if the file is not a readable sample file.
+ */
+FIR_stream_reader_t *open_stream_reader(const char *p_filename, uint32_t p_max_read, bool p_use_mmap)
+{
+    FIR_stream_reader_t *l_reader = arena_calloc(1, sizeof(FIR_stream_reader_t));
+    if (l_reader == NULL)
+        return NULL;
+
+    if (!open_input(p_filename, p_use_mmap, &l_reader->input, &l_reader->header))
+    {
+        if (l_reader->input.fd >= 0)
+            close(l_reader->input.fd);
+        arena_free(l_reader);
+        return NULL;
+    }
+
+    snprintf(l_reader->filename, sizeof(l_reader->filename), "%s", p_filename);
+    l_reader->max_read = p_max_read;
+    l_reader->prefetched = sizeof(l_reader->header);
+    if (l_reader->input.map == NULL)
+    {
+        size_t l_size = sample_type_size((FIR_sample_type_t)l_reader->header.sample_type);
+        l_reader->buffer = arena_alloc((size_t)p_max_read * l_size);
+        if (l_reader->buffer == NULL)
+        {
+            close_stream_reader(l_reader);
+            return NULL;
+        }
+    }
+    return l_reader;
+}
+
+/**
+ * @brief Storage type of the samples in the file.
+ */
+FIR_sample_type_t stream_reader_type(const FIR_stream_reader_t *p_reader)
+{
+    return (FIR_sample_type_t)p_reader->header.sample_type;
+}
+
+/**
+ * @brief Number of samples in the file.
+ */
+uint64_t stream_reader_samples(const FIR_stream_reader_t *p_reader)
+{
+    return p_reader->header.sample_count;
+}
+
+/**
+ * @brief Reads the next samples of the file, widened to float32.
+ *
+ * @param[in,out] p_reader Pointer to the reader.
+ * @param[out] p_output Where to store the samples.
+ * @param[in] p_len Number of samples, at most the p_max_read of the reader
+ *            and the number of samples left.
+ *
+ * @return false if the samples could not be read.
+ */
+bool read_stream_samples(FIR_stream_reader_t *p_reader, float32_t *p_output, uint32_t p_len)
+{
+    FIR_sample_type_t l_type = stream_reader_type(p_reader);
+    size_t l_size = sample_type_size(l_type);
+
+    if (p_len > p_reader->max_read || p_len > p_reader->header.sample_count - p_reader->position)
+    {
+        printf("Error. Read past the end of %s.\n", p_reader->filename);
+        return false;
+    }
+
+    uint64_t l_offset = sizeof(p_reader->header) + p_reader->position * l_size;
+    uint64_t l_end = l_offset + (uint64_t)p_len * l_size;
+
+    // Keep between one and two chunks requested ahead of the reader
+    if (p_reader->prefetched < l_end + STREAM_READER_CHUNK)
+    {
+        prefetch_input(&p_reader->input, p_reader->prefetched, 2U * STREAM_READER_CHUNK);
+        p_reader->prefetched += 2U * STREAM_READER_CHUNK;
+    }
+
+    const void *l_source = p_reader->buffer;
+    if (p_reader->input.map != NULL)
+        l_source = &p_reader->input.map[l_offset];
+    else if (!read_all(p_reader->input.fd, p_reader->buffer, l_end - l_offset, l_offset))
+    {
+        printf("Error. Not able to read %s.\n", p_reader->filename);
+        return false;
+    }
+    widen_samples(l_source, p_len, l_type, p_output);
+    p_reader->position += p_len;
+
+    // Drop what has been read a chunk at a time
+    uint64_t l_consumed = page_floor(l_end, p_reader->input.page_len);
+    if (l_consumed - p_reader->released >= STREAM_READER_CHUNK)
+    {
+        release_input(&p_reader->input, p_reader->released, l_consumed - p_reader->released);
+        p_reader->released = l_consumed;
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps and closes the file and frees the reader. Accepts NULL.
+ */
+void close_stream_reader(FIR_stream_reader_t *p_reader)
+{
+    if (p_reader == NULL)
+        return;
+
+    if (p_reader->input.map != NULL)
+        munmap((void *)p_reader->input.map, p_reader->input.file_len);
+    close(p_reader->input.fd);
+    arena_free(p_reader->buffer);
+    arena_free(p_reader);
+}
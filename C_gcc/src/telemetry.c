@@ -0,0 +1,478 @@
+/**
+ * @file telemetry.c
+ * @brief Sharded telemetry registry and Prometheus text exporter.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "telemetry.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TELEMETRY_REQUEST_MAX  4096U
+
+/* Counters of one thread (shard) of one instance, alone on a cache line */
+typedef struct {
+    _Atomic uint64_t samples;
+    _Atomic uint64_t busy_ns;
+    _Atomic uint64_t blocks;
+    _Atomic uint64_t dropped;
+} __attribute__((aligned(64))) telemetry_shard_t;
+
+struct FIR_telemetry {
+    telemetry_shard_t     shards[TELEMETRY_SHARDS];
+    char                  name[TELEMETRY_NAME_MAX];
+    _Atomic(const char *) kernel;
+    _Atomic uint64_t      occupancy_used;
+    _Atomic uint64_t      occupancy_capacity;
+    _Atomic uint32_t      rms_bits;  /* float bit pattern */
+};
+
+/* Instances are never freed; the count is published after the slot is set up */
+static FIR_telemetry_t g_instances[TELEMETRY_MAX_INSTANCES];
+static _Atomic uint32_t g_instance_count = 0;
+static pthread_mutex_t g_register_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic uint32_t g_next_thread = 0;
+static _Thread_local uint32_t t_thread = UINT32_MAX;
+
+static struct {
+    bool        running;
+    pthread_t   thread;
+    int         wake[2];     /* pipe written by stop_telemetry_exporter() */
+    int         listen_fd;
+    char       *file;
+    uint32_t    period_ms;
+} g_exporter = { .listen_fd = -1 };
+
+
+/* ------------------------------------------------------------------------- */
+/* Registry and hot-path updates                                             */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Returns the instance called p_name, registering it on first use.
+ *
+ * @return The instance, or NULL once TELEMETRY_MAX_INSTANCES are registered.
+ */
+FIR_telemetry_t *register_telemetry(const char *p_name)
+{
+    FIR_telemetry_t *l_found = NULL;
+
+    pthread_mutex_lock(&g_register_lock);
+
+    uint32_t l_count = atomic_load_explicit(&g_instance_count, memory_order_relaxed);
+    for (uint32_t i = 0; i < l_count && l_found == NULL; i++)
+    {
+        if (strncmp(g_instances[i].name, p_name, TELEMETRY_NAME_MAX - 1) == 0)
+            l_found = &g_instances[i];
+    }
+
+    if (l_found == NULL && l_count < TELEMETRY_MAX_INSTANCES)
+    {
+        l_found = &g_instances[l_count];
+        strncpy(l_found->name, p_name, TELEMETRY_NAME_MAX - 1);
+        atomic_store_explicit(&l_found->kernel, "none", memory_order_relaxed);
+        atomic_store_explicit(&g_instance_count, l_count + 1, memory_order_release);
+    }
+
+    pthread_mutex_unlock(&g_register_lock);
+    return l_found;
+}
+
+/**
+ * @brief Monotonic time in ns, for timing the work reported to telemetry.
+ */
+uint64_t telemetry_now_ns(void)
+{
+    struct timespec l_ts;
+    clock_gettime(CLOCK_MONOTONIC, &l_ts);
+    return (uint64_t)l_ts.tv_sec * 1000000000ULL + (uint64_t)l_ts.tv_nsec;
+}
+
+static telemetry_shard_t *thread_shard(FIR_telemetry_t *p_telemetry)
+{
+    if (t_thread == UINT32_MAX)
+        t_thread = atomic_fetch_add_explicit(&g_next_thread, 1, memory_order_relaxed);
+    return &p_telemetry->shards[t_thread % TELEMETRY_SHARDS];
+}
+
+/**
+ * @brief Counts filtered blocks on the calling thread's shard.
+ *
+ * @param[in] p_telemetry Instance, or NULL.
+ * @param[in] p_blocks Number of blocks filtered.
+ * @param[in] p_samples Number of samples filtered.
+ * @param[in] p_busy_ns Time spent filtering them.
+ * @param[in] p_output_rms RMS of the most recent output block.
+ */
+void telemetry_record_blocks(FIR_telemetry_t *p_telemetry, uint64_t p_blocks, uint64_t p_samples,
+                             uint64_t p_busy_ns, float p_output_rms)
+{
+    if (p_telemetry == NULL)
+        return;
+
+    telemetry_shard_t *l_shard = thread_shard(p_telemetry);
+    atomic_fetch_add_explicit(&l_shard->blocks, p_blocks, memory_order_relaxed);
+    atomic_fetch_add_explicit(&l_shard->samples, p_samples, memory_order_relaxed);
+    atomic_fetch_add_explicit(&l_shard->busy_ns, p_busy_ns, memory_order_relaxed);
+
+    uint32_t l_bits;
+    memcpy(&l_bits, &p_output_rms, sizeof(l_bits));
+    atomic_store_explicit(&p_telemetry->rms_bits, l_bits, memory_order_relaxed);
+}
+
+/**
+ * @brief Counts blocks (or jobs) that were lost instead of filtered.
+ */
+void telemetry_drop_blocks(FIR_telemetry_t *p_telemetry, uint64_t p_blocks)
+{
+    if (p_telemetry == NULL)
+        return;
+    atomic_fetch_add_explicit(&thread_shard(p_telemetry)->dropped, p_blocks, memory_order_relaxed);
+}
+
+/**
+ * @brief Sets the fill level of the queue or ring buffer feeding the instance.
+ */
+void telemetry_set_occupancy(FIR_telemetry_t *p_telemetry, uint64_t p_used, uint64_t p_capacity)
+{
+    if (p_telemetry == NULL)
+        return;
+    atomic_store_explicit(&p_telemetry->occupancy_used, p_used, memory_order_relaxed);
+    atomic_store_explicit(&p_telemetry->occupancy_capacity, p_capacity, memory_order_relaxed);
+}
+
+/**
+ * @brief Records the kernel the instance runs; p_kernel must be a static string.
+ */
+void telemetry_set_kernel(FIR_telemetry_t *p_telemetry, const char *p_kernel)
+{
+    if (p_telemetry == NULL)
+        return;
+    atomic_store_explicit(&p_telemetry->kernel, p_kernel, memory_order_relaxed);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Exposition                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef enum {
+    SHARD_SAMPLES = 0,
+    SHARD_BUSY,
+    SHARD_BLOCKS,
+    SHARD_DROPPED,
+    SHARD_FIELD_COUNT
+} shard_field_t;
+
+static const struct {
+    const char *name;
+    const char *help;
+} g_shard_metrics[SHARD_FIELD_COUNT] = {
+    { "fir_samples_total",        "Samples filtered." },
+    { "fir_busy_seconds_total",   "Time spent filtering." },
+    { "fir_blocks_total",         "Blocks filtered." },
+    { "fir_blocks_dropped_total", "Blocks or jobs lost instead of filtered." },
+};
+
+static uint64_t shard_value(telemetry_shard_t *p_shard, shard_field_t p_field)
+{
+    switch (p_field)
+    {
+        case SHARD_SAMPLES: return atomic_load_explicit(&p_shard->samples, memory_order_relaxed);
+        case SHARD_BUSY:    return atomic_load_explicit(&p_shard->busy_ns, memory_order_relaxed);
+        case SHARD_BLOCKS:  return atomic_load_explicit(&p_shard->blocks, memory_order_relaxed);
+        default:            return atomic_load_explicit(&p_shard->dropped, memory_order_relaxed);
+    }
+}
+
+static void write_header(FILE *p_file, const char *p_name, const char *p_help, const char *p_type)
+{
+    fprintf(p_file, "# HELP %s %s\n# TYPE %s %s\n", p_name, p_help, p_name, p_type);
+}
+
+/**
+ * @brief Writes every registered instance in the Prometheus text exposition format.
+ *
+ * Counters are per thread shard (label "thread"); shards that never ran are
+ * left out. Gauges are per instance.
+ */
+void write_telemetry(FILE *p_file)
+{
+    uint32_t l_count = atomic_load_explicit(&g_instance_count, memory_order_acquire);
+
+    for (uint32_t f = 0; f < SHARD_FIELD_COUNT; f++)
+    {
+        write_header(p_file, g_shard_metrics[f].name, g_shard_metrics[f].help, "counter");
+        for (uint32_t i = 0; i < l_count; i++)
+        {
+            for (uint32_t s = 0; s < TELEMETRY_SHARDS; s++)
+            {
+                telemetry_shard_t *l_shard = &g_instances[i].shards[s];
+                if (shard_value(l_shard, SHARD_BLOCKS) == 0 && shard_value(l_shard, SHARD_DROPPED) == 0)
+                    continue;
+
+                uint64_t l_value = shard_value(l_shard, (shard_field_t)f);
+                if (f == SHARD_BUSY)
+                    fprintf(p_file, "%s{instance=\"%s\",thread=\"%u\"} %.9f\n", g_shard_metrics[f].name,
+                            g_instances[i].name, s, (double)l_value * 1e-9);
+                else
+                    fprintf(p_file, "%s{instance=\"%s\",thread=\"%u\"} %llu\n", g_shard_metrics[f].name,
+                            g_instances[i].name, s, (unsigned long long)l_value);
+            }
+        }
+    }
+
+    write_header(p_file, "fir_ns_per_sample", "Filtering time per sample over the whole run.", "gauge");
+    for (uint32_t i = 0; i < l_count; i++)
+    {
+        uint64_t l_samples = 0, l_busy = 0;
+        for (uint32_t s = 0; s < TELEMETRY_SHARDS; s++)
+        {
+            l_samples += shard_value(&g_instances[i].shards[s], SHARD_SAMPLES);
+            l_busy += shard_value(&g_instances[i].shards[s], SHARD_BUSY);
+        }
+        fprintf(p_file, "fir_ns_per_sample{instance=\"%s\"} %.3f\n", g_instances[i].name,
+                l_samples ? (double)l_busy / (double)l_samples : 0.0);
+    }
+
+    write_header(p_file, "fir_queue_occupancy", "Entries waiting in the queue or ring buffer feeding the filter.",
+                 "gauge");
+    for (uint32_t i = 0; i < l_count; i++)
+    {
+        fprintf(p_file, "fir_queue_occupancy{instance=\"%s\"} %llu\n", g_instances[i].name,
+                (unsigned long long)atomic_load_explicit(&g_instances[i].occupancy_used, memory_order_relaxed));
+    }
+
+    write_header(p_file, "fir_queue_capacity", "Capacity of the queue or ring buffer feeding the filter.", "gauge");
+    for (uint32_t i = 0; i < l_count; i++)
+    {
+        fprintf(p_file, "fir_queue_capacity{instance=\"%s\"} %llu\n", g_instances[i].name,
+                (unsigned long long)atomic_load_explicit(&g_instances[i].occupancy_capacity, memory_order_relaxed));
+    }
+
+    write_header(p_file, "fir_output_rms", "RMS of the most recent output block.", "gauge");
+    for (uint32_t i = 0; i < l_count; i++)
+    {
+        uint32_t l_bits = atomic_load_explicit(&g_instances[i].rms_bits, memory_order_relaxed);
+        float l_rms;
+        memcpy(&l_rms, &l_bits, sizeof(l_rms));
+        fprintf(p_file, "fir_output_rms{instance=\"%s\"} %g\n", g_instances[i].name, (double)l_rms);
+    }
+
+    write_header(p_file, "fir_kernel_info", "Kernel selected for the filter.", "gauge");
+    for (uint32_t i = 0; i < l_count; i++)
+    {
+        fprintf(p_file, "fir_kernel_info{instance=\"%s\",kernel=\"%s\"} 1\n", g_instances[i].name,
+                atomic_load_explicit(&g_instances[i].kernel, memory_order_relaxed));
+    }
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Exporter                                                                  */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Rewrites the exposition file; readers see either the old or the new one.
+ */
+static void export_file(const char *p_filename)
+{
+    size_t l_len = strlen(p_filename) + 5;
+    char *l_temp = malloc(l_len);
+    if (l_temp == NULL)
+        return;
+
+    snprintf(l_temp, l_len, "%s.tmp", p_filename);
+    FILE *l_file = fopen(l_temp, "w");
+    if (l_file != NULL)
+    {
+        write_telemetry(l_file);
+        if (fclose(l_file) == 0)
+            rename(l_temp, p_filename);
+    }
+    free(l_temp);
+}
+
+/**
+ * @brief Answers one HTTP scrape on the exporter socket.
+ */
+static void export_scrape(int p_listen_fd)
+{
+    int l_fd = accept(p_listen_fd, NULL, NULL);
+    if (l_fd < 0)
+        return;
+
+    // Read (and ignore) the request, giving a slow client 200 ms
+    struct timeval l_timeout = { .tv_sec = 0, .tv_usec = 200000 };
+    setsockopt(l_fd, SOL_SOCKET, SO_RCVTIMEO, &l_timeout, sizeof(l_timeout));
+    char l_request[TELEMETRY_REQUEST_MAX];
+    size_t l_received = 0;
+    while (l_received < sizeof(l_request) - 1)
+    {
+        ssize_t l_read = recv(l_fd, &l_request[l_received], sizeof(l_request) - 1 - l_received, 0);
+        if (l_read <= 0)
+            break;
+        l_received += (size_t)l_read;
+        l_request[l_received] = '\0';
+        if (strstr(l_request, "\r\n\r\n") != NULL)
+            break;
+    }
+
+    char *l_body = NULL;
+    size_t l_body_len = 0;
+    FILE *l_stream = open_memstream(&l_body, &l_body_len);
+    if (l_stream != NULL)
+    {
+        fprintf(l_stream, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n");
+        write_telemetry(l_stream);
+        fclose(l_stream);
+
+        for (size_t l_sent = 0; l_sent < l_body_len; )
+        {
+            ssize_t l_written = send(l_fd, &l_body[l_sent], l_body_len - l_sent, MSG_NOSIGNAL);
+            if (l_written <= 0)
+                break;
+            l_sent += (size_t)l_written;
+        }
+    }
+
+    free(l_body);
+    close(l_fd);
+}
+
+static void *exporter_main(void *p_arg)
+{
+    (void)p_arg;
+    uint64_t l_next = telemetry_now_ns();
+
+    for (;;)
+    {
+        int l_timeout = -1;
+        if (g_exporter.file != NULL)
+        {
+            uint64_t l_now = telemetry_now_ns();
+            if (l_now >= l_next)
+            {
+                export_file(g_exporter.file);
+                l_next = l_now + (uint64_t)g_exporter.period_ms * 1000000ULL;
+            }
+            l_timeout = (int)((l_next - l_now) / 1000000ULL) + 1;
+        }
+
+        struct pollfd l_fds[2] = { { .fd = g_exporter.wake[0], .events = POLLIN },
+                                   { .fd = g_exporter.listen_fd, .events = POLLIN } };
+        int l_ready = poll(l_fds, (g_exporter.listen_fd >= 0) ? 2 : 1, l_timeout);
+
+        if (l_ready > 0 && (l_fds[0].revents & POLLIN))
+            break;
+        if (l_ready > 0 && (l_fds[1].revents & POLLIN))
+            export_scrape(g_exporter.listen_fd);
+    }
+
+    return NULL;
+}
+
+static int open_listen_socket(uint16_t p_port)
+{
+    int l_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (l_fd < 0)
+        return -1;
+
+    int l_reuse = 1;
+    setsockopt(l_fd, SOL_SOCKET, SO_REUSEADDR, &l_reuse, sizeof(l_reuse));
+
+    struct sockaddr_in l_addr = { .sin_family = AF_INET, .sin_port = htons(p_port),
+                                  .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (bind(l_fd, (struct sockaddr *)&l_addr, sizeof(l_addr)) != 0 || listen(l_fd, 8) != 0)
+    {
+        close(l_fd);
+        return -1;
+    }
+    return l_fd;
+}
+
+/**
+ * @brief Starts the exporter thread.
+ *
+ * @param[in] p_config Exposition file and/or loopback port, and the file period.
+ *
+ * @return false if an exporter is already running or the port cannot be bound.
+ */
+bool start_telemetry_exporter(const FIR_telemetry_config_t *p_config)
+{
+    if (g_exporter.running || (p_config->file == NULL && p_config->port == 0))
+        return false;
+
+    g_exporter.period_ms = p_config->period_ms ? p_config->period_ms : TELEMETRY_DEFAULT_PERIOD_MS;
+    g_exporter.file = (p_config->file != NULL) ? strdup(p_config->file) : NULL;
+    g_exporter.listen_fd = -1;
+
+    if (p_config->port != 0)
+    {
+        g_exporter.listen_fd = open_listen_socket(p_config->port);
+        if (g_exporter.listen_fd < 0)
+        {
+            printf("Error. Not able to listen for scrapes on 127.0.0.1:%u.\n", p_config->port);
+            free(g_exporter.file);
+            return false;
+        }
+    }
+
+    if (pipe(g_exporter.wake) != 0)
+    {
+        if (g_exporter.listen_fd >= 0)
+            close(g_exporter.listen_fd);
+        free(g_exporter.file);
+        return false;
+    }
+
+    if (pthread_create(&g_exporter.thread, NULL, exporter_main, NULL) != 0)
+    {
+        close(g_exporter.wake[0]);
+        close(g_exporter.wake[1]);
+        if (g_exporter.listen_fd >= 0)
+            close(g_exporter.listen_fd);
+        free(g_exporter.file);
+        return false;
+    }
+
+    g_exporter.running = true;
+    return true;
+}
+
+/**
+ * @brief Stops the exporter thread, writing the file one last time.
+ */
+void stop_telemetry_exporter(void)
+{
+    if (!g_exporter.running)
+        return;
+
+    char l_byte = 0;
+    while (write(g_exporter.wake[1], &l_byte, 1) != 1)
+        ;
+    pthread_join(g_exporter.thread, NULL);
+
+    if (g_exporter.file != NULL)
+        export_file(g_exporter.file);
+
+    close(g_exporter.wake[0]);
+    close(g_exporter.wake[1]);
+    if (g_exporter.listen_fd >= 0)
+        close(g_exporter.listen_fd);
+    free(g_exporter.file);
+    g_exporter.file = NULL;
+    g_exporter.listen_fd = -1;
+    g_exporter.running = false;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file tick.c
+ * @brief Sample-by-sample tick filters and the push latency histogram.
+ */
+
+#include "tick.h"
+#include "plan.h"
+#include "fir_target.h"
+#include "arena.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *g_tick_form_names[FIR_TICK_FORM_COUNT] = {
+    "direct",
+    "symmetric",
+    "transposed"
+};
+
+/**
+ * @brief Returns the printable name of a tick form.
+ */
+const char *tick_form_name(FIR_tick_form_t p_form)
+{
+    if (p_form >= FIR_TICK_FORM_COUNT)
+        return "unknown";
+    return g_tick_form_names[p_form];
+}
+
+static uint32_t round_tile(uint32_t p_len)
+{
+    return (p_len + FIR_TILE - 1) / FIR_TILE * FIR_TILE;
+}
+
+/**
+ * @brief Creates a tick filter with an empty (zero) history.
+ *
+ * The symmetric form keeps a second double-length line in which the
+ * samples run oldest first, so that both halves of every folded pair are
+ * read forwards.
+ *
+ * @param[in] p_filter Pointer to the FIR filter; its coefficients are copied.
+ * @param[in] p_form How to evaluate each output.
+ *
+ * @return The new tick filter, or NULL if the form does not suit the
+ *         coefficients or memory is short.
+ */
+FIR_tick_filter_t *create_tick_filter(FIR_filter_t *p_filter, FIR_tick_form_t p_form)
+{
+    uint32_t N = p_filter->coeff_b_len;
+
+    if (N == 0 || p_form >= FIR_TICK_FORM_COUNT)
+    {
+        printf("Error. A tick filter needs at least one coefficient and a known form.\n");
+        return NULL;
+    }
+    if (p_form == FIR_TICK_SYMMETRIC
+        && (analyse_coefficients(p_filter->coeff_b_ptr, N) & FIR_COEFF_SYMMETRIC) == 0)
+    {
+        printf("Error. The symmetric tick form needs h[k] == h[N-1-k].\n");
+        return NULL;
+    }
+
+    FIR_tick_filter_t *l_tick = arena_calloc(1, sizeof(FIR_tick_filter_t));
+    if (l_tick == NULL)
+        return NULL;
+
+    uint32_t P = round_tile(N);
+    l_tick->form = p_form;
+    l_tick->coeff_len = N;
+    l_tick->padded_len = P;
+    l_tick->folded_len = round_tile(N / 2);
+
+    // One tile of zeros past every array: the transposed update reads s[k+1] and h[k+1]
+    l_tick->coeffs = arena_calloc(P + FIR_TILE, sizeof(float32_t));
+    l_tick->line = arena_calloc(4 * P + 2 * FIR_TILE, sizeof(float32_t));
+    if (l_tick->coeffs == NULL || l_tick->line == NULL)
+    {
+        printf("Error. Not able to allocate a tick filter of %u taps.\n", N);
+        destroy_tick_filter(l_tick);
+        return NULL;
+    }
+
+    uint32_t l_taps = (p_form == FIR_TICK_SYMMETRIC) ? N / 2 : N;
+    memcpy(l_tick->coeffs, p_filter->coeff_b_ptr, l_taps * sizeof(float32_t));
+    if (p_form == FIR_TICK_SYMMETRIC && N % 2 != 0)
+        l_tick->coeffs[P] = p_filter->coeff_b_ptr[N / 2];  // the centre tap, after the folded ones
+
+    return l_tick;
+}
+
+/* Sums the FIR_TILE lanes in ascending order */
+static inline __attribute__((always_inline)) float32_t sum_lanes(const float32_t *p_acc)
+{
+    float32_t l_sum = 0.0f;
+    for (uint32_t j = 0; j < FIR_TILE; j++)
+    {
+        l_sum += p_acc[j];
+    }
+    return l_sum;
+}
+
+/**
+ * @brief Filters one sample and returns its output.
+ *
+ * The work per call depends only on the number of taps.
+ *
+ * @param[in,out] p_tick Pointer to the tick filter.
+ * @param[in] p_sample The newest input sample.
+ *
+ * @return The output for p_sample.
+ */
+FIR_MULTIVERSION
+float32_t push_tick_sample(FIR_tick_filter_t *p_tick, float32_t p_sample)
+{
+    uint32_t P = p_tick->padded_len;
+    const float32_t *h = p_tick->coeffs;
+    float32_t l_acc[FIR_TILE] = { 0.0f };
+
+    if (p_tick->form == FIR_TICK_TRANSPOSED)
+    {
+        float32_t *s = p_tick->line;
+        float32_t l_y = h[0] * p_sample + s[0];
+
+        // s[k] = s[k+1] + h[k+1] * x; a tile reads s[k+1] before the next tile overwrites it
+        for (uint32_t k = 0; k < P; k += FIR_TILE)
+        {
+            const float32_t *l_s = &s[k + 1];
+            const float32_t *l_h = &h[k + 1];
+            float32_t l_next[FIR_TILE];
+            for (uint32_t j = 0; j < FIR_TILE; j++)
+            {
+                l_next[j] = l_s[j] + l_h[j] * p_sample;
+            }
+            float32_t *l_out = &s[k];
+            for (uint32_t j = 0; j < FIR_TILE; j++)
+            {
+                l_out[j] = l_next[j];
+            }
+        }
+        return l_y;
+    }
+
+    uint32_t l_pos = (p_tick->pos == 0) ? P - 1 : p_tick->pos - 1;
+    p_tick->pos = l_pos;
+    p_tick->line[l_pos] = p_sample;
+    p_tick->line[l_pos + P] = p_sample;
+
+    const float32_t *l_new = &p_tick->line[l_pos];  // l_new[k] = x[n-k]
+
+    if (p_tick->form == FIR_TICK_DIRECT)
+    {
+        for (uint32_t k = 0; k < P; k += FIR_TILE)
+        {
+            const float32_t *l_x = &l_new[k];
+            const float32_t *l_h = &h[k];
+            for (uint32_t j = 0; j < FIR_TILE; j++)
+            {
+                l_acc[j] += l_x[j] * l_h[j];
+            }
+        }
+        return sum_lanes(l_acc);
+    }
+
+    // Symmetric: the second line is written at mirrored positions, so its window runs oldest first
+    uint32_t N = p_tick->coeff_len;
+    float32_t *l_reverse = &p_tick->line[2 * P];
+    uint32_t l_rpos = P - 1 - l_pos;
+    l_reverse[l_rpos] = p_sample;
+    l_reverse[l_rpos + P] = p_sample;
+
+    const float32_t *l_old = &l_reverse[l_rpos + P - (N - 1)];  // l_old[k] = x[n-(N-1)+k]
+    for (uint32_t k = 0; k < p_tick->folded_len; k += FIR_TILE)
+    {
+        const float32_t *l_x = &l_new[k];
+        const float32_t *l_y = &l_old[k];
+        const float32_t *l_h = &h[k];
+        for (uint32_t j = 0; j < FIR_TILE; j++)
+        {
+            l_acc[j] += (l_x[j] + l_y[j]) * l_h[j];
+        }
+    }
+
+    float32_t l_y = sum_lanes(l_acc);
+    if (N % 2 != 0)
+        l_y += l_new[N / 2] * h[P];
+    return l_y;
+}
+
+/**
+ * @brief Clears the history so the next sample starts a new signal.
+ */
+void reset_tick_filter(FIR_tick_filter_t *p_tick)
+{
+    memset(p_tick->line, 0, (4 * p_tick->padded_len + 2 * FIR_TILE) * sizeof(float32_t));
+    p_tick->pos = 0;
+}
+
+/**
+ * @brief Releases a tick filter. Accepts NULL.
+ */
+void destroy_tick_filter(FIR_tick_filter_t *p_tick)
+{
+    if (p_tick == NULL)
+        return;
+
+    arena_free(p_tick->coeffs);
+    arena_free(p_tick->line);
+    arena_free(p_tick);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Latency histogram                                                         */
+/* ------------------------------------------------------------------------- */
+
+/* Exact below TICK_EXACT_NS, then TICK_SUB_BUCKETS buckets per power of two */
+static uint32_t latency_bucket(uint64_t p_ns)
+{
+    if (p_ns < TICK_EXACT_NS)
+        return (uint32_t)p_ns;
+
+    uint32_t l_exp = 63U - (uint32_t)__builtin_clzll(p_ns);  // 6 or more
+    uint32_t l_sub = (uint32_t)(p_ns >> (l_exp - 5)) & (TICK_SUB_BUCKETS - 1);
+    uint32_t l_bucket = TICK_EXACT_NS + (l_exp - 6) * TICK_SUB_BUCKETS + l_sub;
+
+    return (l_bucket < TICK_BUCKETS) ? l_bucket : TICK_BUCKETS - 1;
+}
+
+/* Largest latency that falls into a bucket */
+static uint64_t bucket_limit(uint32_t p_bucket)
+{
+    if (p_bucket < TICK_EXACT_NS)
+        return p_bucket;
+
+    uint32_t l_exp = 6 + (p_bucket - TICK_EXACT_NS) / TICK_SUB_BUCKETS;
+    uint64_t l_sub = (p_bucket - TICK_EXACT_NS) % TICK_SUB_BUCKETS;
+
+    return ((TICK_SUB_BUCKETS + l_sub + 1) << (l_exp - 5)) - 1;
+}
+
+/**
+ * @brief Adds one latency to a histogram.
+ */
+void record_latency(FIR_latency_histogram_t *p_histogram, uint64_t p_ns)
+{
+    p_histogram->buckets[latency_bucket(p_ns)]++;
+    p_histogram->count++;
+    p_histogram->sum_ns += p_ns;
+    if (p_ns > p_histogram->max_ns)
+        p_histogram->max_ns = p_ns;
+}
+
+/**
+ * @brief Latency below which p_percent of the recorded ones fall.
+ *
+ * Rounded up to the end of its bucket, so the value is never optimistic,
+ * and never above the largest latency recorded.
+ *
+ * @return The latency in ns, 0 for an empty histogram.
+ */
+uint64_t latency_percentile(const FIR_latency_histogram_t *p_histogram, double p_percent)
+{
+    uint64_t l_rank = (uint64_t)((double)p_histogram->count * p_percent / 100.0 + 0.5);
+    uint64_t l_seen = 0;
+
+    if (l_rank == 0)
+        l_rank = 1;
+
+    for (uint32_t b = 0; b < TICK_BUCKETS; b++)
+    {
+        l_seen += p_histogram->buckets[b];
+        if (l_seen >= l_rank)
+        {
+            uint64_t l_limit = bucket_limit(b);
+            return (l_limit < p_histogram->max_ns) ? l_limit : p_histogram->max_ns;
+        }
+    }
+    return p_histogram->max_ns;
+}
+
+/**
+ * @brief Pushes a signal through a tick filter, timing every sample.
+ *
+ * Each latency includes one read of the monotonic clock; time an empty
+ * interval the same way to know that floor.
+ *
+ * @param[in,out] p_tick Pointer to the tick filter.
+ * @param[in] p_input Pointer to the input signal array.
+ * @param[in] p_input_len Length of the input signal.
+ * @param[out] p_output Pointer to the output signal array.
+ * @param[in,out] p_histogram Histogram the latencies are added to.
+ */
+void measure_tick_latency(FIR_tick_filter_t *p_tick, const float32_t *p_input, uint64_t p_input_len,
+                          float32_t *p_output, FIR_latency_histogram_t *p_histogram)
+{
+    for (uint64_t n = 0; n < p_input_len; n++)
+    {
+        uint64_t l_start = telemetry_now_ns();
+        p_output[n] = push_tick_sample(p_tick, p_input[n]);
+        record_latency(p_histogram, telemetry_now_ns() - l_start);
+    }
+}